@@ -0,0 +1,140 @@
+// Input parsing: the original getline/stringstream/stoi reader behind
+// read_csv_pair, the CsvSource parser read by pairs, by lines and through
+// the read-ahead thread, and the binary scan replay. For the CSV parsers
+// bytes/s counts the text read, for the replay the pixels.
+#include "bench_util.h"
+#include "csv_source.h"
+#include "scan_file.h"
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+const int CSV_M = 64;
+
+// The CSV input of one benchmark, written once per input size.
+struct CsvInput {
+    explicit CsvInput(size_t pixels) : file(".csv"), pixel_count(pixels) {
+        bytes = write_csv(file.path(), synthetic_pixels(pixels), CSV_M);
+    }
+
+    TempFile file;
+    size_t pixel_count;
+    size_t bytes;
+};
+
+// The baseline parser of read_csv_pair as it was before CsvSource: one
+// std::string per line, a stringstream per line and std::stoi per cell,
+// handed out two pixels at a time.
+class LegacyCsvReader {
+public:
+    LegacyCsvReader(const std::string& path, int m) : file_(path), m_(m), next_(0) {}
+
+    bool read_pair(uint8_t* values) {
+        while (row_.size() - next_ < 2) {
+            std::string line;
+            if (!std::getline(file_, line)) {
+                return false;
+            }
+            row_.erase(row_.begin(), row_.begin() + static_cast<std::ptrdiff_t>(next_));
+            next_ = 0;
+            std::stringstream ss(line);
+            std::string cell;
+            int count = 0;
+            while (std::getline(ss, cell, ',')) {
+                if (count < m_ || m_ <= 0) {
+                    try {
+                        row_.push_back(static_cast<uint8_t>(std::stoi(cell)));
+                    } catch (const std::exception&) {
+                        // Skip malformed cell
+                    }
+                }
+                count++;
+            }
+        }
+        values[0] = row_[next_++];
+        values[1] = row_[next_++];
+        return true;
+    }
+
+private:
+    std::ifstream file_;
+    int m_;
+    std::vector<uint8_t> row_;
+    size_t next_;
+};
+
+void BM_CsvLegacyPairs(benchmark::State& state) {
+    CsvInput input(static_cast<size_t>(state.range(0)));
+    for (auto _ : state) {
+        LegacyCsvReader reader(input.file.path(), CSV_M);
+        uint8_t values[2];
+        while (reader.read_pair(values)) {
+            benchmark::DoNotOptimize(values);
+        }
+    }
+    set_throughput(state, input.pixel_count, 1);
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * input.bytes));
+}
+BENCHMARK(BM_CsvLegacyPairs)->RangeMultiplier(8)->Range(1 << 12, 1 << 21);
+
+// CsvSource with a read size of range(1): 2 for today's read_csv_pair, m for
+// read_csv_batch. range(2) is the read-ahead depth (0 = mapped file).
+void BM_CsvSource(benchmark::State& state) {
+    CsvInput input(static_cast<size_t>(state.range(0)));
+    const size_t read_size = static_cast<size_t>(state.range(1));
+    PrefetchConfig prefetch;
+    prefetch.depth = static_cast<size_t>(state.range(2));
+    std::vector<uint8_t> out(read_size);
+    for (auto _ : state) {
+        CsvSource source(CSV_M);
+        source.set_prefetch(prefetch);
+        if (!source.open(input.file.path())) {
+            state.SkipWithError("cannot open the CSV input");
+            return;
+        }
+        while (source.read_pixels(out.data(), read_size) > 0) {
+            benchmark::DoNotOptimize(out.data());
+        }
+    }
+    set_throughput(state, input.pixel_count, 1);
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * input.bytes));
+}
+BENCHMARK(BM_CsvSource)
+    ->ArgNames({"pixels", "read", "prefetch"})
+    ->ArgsProduct({benchmark::CreateRange(1 << 12, 1 << 21, 8), {2, CSV_M}, {0}})
+    ->Args({1 << 21, CSV_M, 4});
+
+// Scan recording replay, copying out (read_pixels) or zero-copy (next_span).
+void BM_ScanReplay(benchmark::State& state) {
+    const size_t pixels = static_cast<size_t>(state.range(0));
+    const bool zero_copy = state.range(1) != 0;
+    TempFile file(".scan");
+    {
+        std::vector<uint8_t> data = synthetic_pixels(pixels);
+        ScanWriter writer;
+        writer.open(file.path(), CSV_M, 0, CSV_M, false);
+        writer.write(data.data(), data.size());
+        writer.close();
+    }
+    std::vector<uint8_t> out(CSV_M);
+    for (auto _ : state) {
+        ScanReader reader;
+        if (!reader.open(file.path())) {
+            state.SkipWithError("cannot open the scan recording");
+            return;
+        }
+        uint8_t* span = out.data();
+        size_t count;
+        while ((count = zero_copy ? reader.next_span(span, CSV_M) : reader.read_pixels(out.data(), CSV_M)) > 0) {
+            benchmark::DoNotOptimize(span[count - 1]);
+            benchmark::DoNotOptimize(out[count - 1]);
+        }
+    }
+    set_throughput(state, pixels, 1);
+}
+BENCHMARK(BM_ScanReplay)
+    ->ArgNames({"pixels", "zero_copy"})
+    ->ArgsProduct({benchmark::CreateRange(1 << 12, 1 << 21, 8), {0, 1}});
+
+} // namespace
@@ -0,0 +1,88 @@
+// Filtering: FilterThreshold per engine (the Reference engine is the
+// process_element loop), row mode, and the bare convolution loops for
+// several kernel lengths. Results go to a NullSink.
+#include "bench_util.h"
+#include "filter_kernel.h"
+#include "filter_threshold.h"
+#include "pixel_batch.h"
+#include "result_sink.h"
+#include "row_filter.h"
+
+namespace {
+
+const double BENCH_TV = 100.0;
+
+FilterEngine engine_arg(int64_t value) {
+    switch (value) {
+    case 0: return FilterEngine::Reference;
+    case 1: return FilterEngine::Simd;
+    default: return FilterEngine::Fixed;
+    }
+}
+
+const char* engine_label(FilterEngine engine) {
+    switch (engine) {
+    case FilterEngine::Reference: return "reference";
+    case FilterEngine::Simd: return "simd";
+    default: return "fixed";
+    }
+}
+
+// One stage-mode filter fed the same batch of range(1) pixels over and
+// over; range(2) > 0 filters rows of that width instead of a flat stream.
+void BM_FilterBatch(benchmark::State& state) {
+    const FilterEngine engine = engine_arg(state.range(0));
+    const size_t size = static_cast<size_t>(state.range(1));
+    const int row_width = static_cast<int>(state.range(2));
+    BatchPool pool(1, size);
+    FilterThreshold filter(pool, BENCH_TV, 0);
+    NullSink sink;
+    filter.set_sink(sink);
+    filter.set_engine(engine);
+    if (row_width > 0) {
+        filter.set_row_mode(row_width, RowFilterConfig());
+    }
+    PixelBatch* batch = pool.acquire();
+    std::vector<uint8_t> pixels = synthetic_pixels(size);
+    std::copy(pixels.begin(), pixels.end(), batch->data);
+    batch->size = size;
+    for (auto _ : state) {
+        filter.process_batch(*batch);
+        batch->first_index += size;
+    }
+    pool.release(batch);
+    state.SetLabel(engine_label(engine));
+    set_throughput(state, size, 1);
+}
+BENCHMARK(BM_FilterBatch)
+    ->ArgNames({"engine", "pixels", "rows"})
+    ->ArgsProduct({{0, 1, 2}, benchmark::CreateRange(64, 1 << 16, 16), {0}})
+    ->Args({1, 1 << 16, BENCH_WIDTH})
+    ->Args({0, 1 << 16, BENCH_WIDTH});
+
+// ConvolutionKernel alone on range(1) outputs with a kernel of range(0)
+// taps (binomial, so symmetric).
+void BM_ConvolutionKernel(benchmark::State& state) {
+    const size_t length = static_cast<size_t>(state.range(0));
+    const size_t count = static_cast<size_t>(state.range(1));
+    std::vector<double> taps(length, 1.0);
+    for (size_t i = 1; i < length; ++i) {
+        for (size_t k = i; k > 0; --k) {
+            taps[k] += taps[k - 1];
+        }
+    }
+    ConvolutionKernel kernel(taps);
+    std::vector<uint8_t> in = synthetic_pixels(count + length - 1);
+    std::vector<float> out(count);
+    for (auto _ : state) {
+        kernel.apply(in.data(), count, out.data());
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetLabel(kernel.description());
+    set_throughput(state, count, 1);
+}
+BENCHMARK(BM_ConvolutionKernel)
+    ->ArgNames({"taps", "pixels"})
+    ->ArgsProduct({{3, 5, 9, 11, 15}, {1 << 10, 1 << 16}});
+
+} // namespace
@@ -0,0 +1,117 @@
+// Queue push/pop cost: uncontended, one producer and one consumer thread, and
+// several producers contending for one BlockingQueue.
+#include "bench_util.h"
+#include "blocking_queue.h"
+#include "spsc_ring_queue.h"
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using Pair = std::pair<uint8_t, uint8_t>;
+
+// Push and pop on one thread: the bare cost of the queue operations.
+void BM_BlockingQueuePushPop(benchmark::State& state) {
+    const size_t count = static_cast<size_t>(state.range(0));
+    BlockingQueue<Pair> queue(count);
+    Pair item;
+    for (auto _ : state) {
+        for (size_t i = 0; i < count; ++i) {
+            queue.push({static_cast<uint8_t>(i), 0});
+        }
+        for (size_t i = 0; i < count; ++i) {
+            queue.try_pop(item);
+        }
+        benchmark::DoNotOptimize(item);
+    }
+    set_throughput(state, count, sizeof(Pair));
+}
+BENCHMARK(BM_BlockingQueuePushPop)->RangeMultiplier(8)->Range(64, 1 << 15);
+
+void BM_SpscRingPushPop(benchmark::State& state) {
+    const size_t count = static_cast<size_t>(state.range(0));
+    SpscRingQueue<Pair> queue(count);
+    Pair item;
+    for (auto _ : state) {
+        for (size_t i = 0; i < count; ++i) {
+            queue.push({static_cast<uint8_t>(i), 0});
+        }
+        for (size_t i = 0; i < count; ++i) {
+            queue.try_pop(item);
+        }
+        benchmark::DoNotOptimize(item);
+    }
+    set_throughput(state, count, sizeof(Pair));
+}
+BENCHMARK(BM_SpscRingPushPop)->RangeMultiplier(8)->Range(64, 1 << 15);
+
+// A producer thread pushes count pairs while the benchmark thread pops them,
+// the way the generator and filter stages use the queue.
+template <typename Q>
+std::unique_ptr<Q> make_queue();
+
+template <>
+std::unique_ptr<BlockingQueue<Pair>> make_queue() {
+    return std::make_unique<BlockingQueue<Pair>>(1024);
+}
+
+template <>
+std::unique_ptr<SpscRingQueue<Pair>> make_queue() {
+    return std::make_unique<SpscRingQueue<Pair>>(1024);
+}
+
+template <typename Q>
+void BM_QueueSpsc(benchmark::State& state) {
+    const size_t count = static_cast<size_t>(state.range(0));
+    for (auto _ : state) {
+        std::unique_ptr<Q> queue = make_queue<Q>();
+        std::thread producer([&queue, count] {
+            for (size_t i = 0; i < count; ++i) {
+                queue->push({static_cast<uint8_t>(i), 0});
+            }
+            queue->close();
+        });
+        Pair item;
+        size_t popped = 0;
+        while (queue->pop(item)) {
+            ++popped;
+        }
+        producer.join();
+        benchmark::DoNotOptimize(popped);
+    }
+    set_throughput(state, count, sizeof(Pair));
+}
+BENCHMARK_TEMPLATE(BM_QueueSpsc, BlockingQueue<Pair>)->RangeMultiplier(8)->Range(1 << 12, 1 << 18)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_QueueSpsc, SpscRingQueue<Pair>)->RangeMultiplier(8)->Range(1 << 12, 1 << 18)->UseRealTime();
+
+// range(0) producers share count pushes into one BlockingQueue; the
+// benchmark thread is the single consumer.
+void BM_BlockingQueueContended(benchmark::State& state) {
+    const size_t producers = static_cast<size_t>(state.range(0));
+    const size_t count = static_cast<size_t>(state.range(1)) / producers * producers;
+    for (auto _ : state) {
+        BlockingQueue<Pair> queue(1024);
+        std::vector<std::thread> threads;
+        for (size_t p = 0; p < producers; ++p) {
+            threads.emplace_back([&queue, count, producers] {
+                for (size_t i = 0; i < count / producers; ++i) {
+                    queue.push({static_cast<uint8_t>(i), 0});
+                }
+            });
+        }
+        Pair item;
+        for (size_t i = 0; i < count; ++i) {
+            queue.pop(item);
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+        benchmark::DoNotOptimize(item);
+    }
+    set_throughput(state, count, sizeof(Pair));
+}
+BENCHMARK(BM_BlockingQueueContended)->ArgsProduct({{1, 2, 4, 8}, {1 << 16}})->UseRealTime();
+
+} // namespace
@@ -0,0 +1,62 @@
+// Random pixel generation: a pair of next() calls per item, as in
+// generate_random_pair, and whole-batch fill(), for each engine, plus the
+// synthetic web source.
+#include "bench_util.h"
+
+namespace {
+
+RandomEngine engine_arg(int64_t value) {
+    return value == 0 ? RandomEngine::Mt19937 : RandomEngine::Xoshiro256pp;
+}
+
+void BM_RandomPairs(benchmark::State& state) {
+    RandomPixelSource random;
+    random.set_engine(engine_arg(state.range(0)));
+    random.seed(1);
+    const size_t pairs = static_cast<size_t>(state.range(1)) / 2;
+    for (auto _ : state) {
+        for (size_t i = 0; i < pairs; ++i) {
+            uint8_t val1 = random.next();
+            uint8_t val2 = random.next();
+            benchmark::DoNotOptimize(val1);
+            benchmark::DoNotOptimize(val2);
+        }
+    }
+    state.SetLabel(RandomPixelSource::engine_name(random.engine()));
+    set_throughput(state, pairs * 2, 1);
+}
+BENCHMARK(BM_RandomPairs)
+    ->ArgNames({"engine", "pixels"})
+    ->ArgsProduct({{0, 1}, benchmark::CreateRange(1 << 10, 1 << 20, 32)});
+
+void BM_RandomFill(benchmark::State& state) {
+    RandomPixelSource random;
+    random.set_engine(engine_arg(state.range(0)));
+    random.seed(1);
+    std::vector<uint8_t> out(static_cast<size_t>(state.range(1)));
+    for (auto _ : state) {
+        random.fill(out.data(), out.size());
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetLabel(RandomPixelSource::engine_name(random.engine()));
+    set_throughput(state, out.size(), 1);
+}
+BENCHMARK(BM_RandomFill)
+    ->ArgNames({"engine", "pixels"})
+    ->ArgsProduct({{0, 1}, benchmark::CreateRange(64, 1 << 20, 16)});
+
+void BM_SyntheticFill(benchmark::State& state) {
+    RandomPixelSource random;
+    random.set_engine(RandomEngine::Xoshiro256pp);
+    random.seed(1);
+    SyntheticSource source(random, BENCH_WIDTH, SyntheticConfig());
+    std::vector<uint8_t> out(static_cast<size_t>(state.range(0)));
+    for (auto _ : state) {
+        source.fill(out.data(), out.size());
+        benchmark::DoNotOptimize(out.data());
+    }
+    set_throughput(state, out.size(), 1);
+}
+BENCHMARK(BM_SyntheticFill)->RangeMultiplier(16)->Range(64, 1 << 20);
+
+} // namespace
@@ -0,0 +1,77 @@
+// Batch handoff between a producer and a consumer thread: pooled batch
+// pointers through the in-process SPSC ring against copies through a
+// shared-memory ring (both ends mapped in this process, as two processes
+// would map it).
+#include "bench_util.h"
+#include "pixel_batch.h"
+#include "shm_ring.h"
+#include "spsc_ring_queue.h"
+#include <string>
+#include <thread>
+#include <unistd.h> // For getpid
+#include <vector>
+
+namespace {
+
+const size_t HANDOFF_BATCHES = 1 << 14;
+const size_t HANDOFF_SLOTS = 64;
+
+void BM_BatchHandoffInProcess(benchmark::State& state) {
+    const size_t batch_size = static_cast<size_t>(state.range(0));
+    BatchPool pool(HANDOFF_SLOTS + 2, batch_size);
+    for (auto _ : state) {
+        SpscRingQueue<PixelBatch*> queue(HANDOFF_SLOTS);
+        std::thread producer([&queue, &pool, batch_size] {
+            for (size_t i = 0; i < HANDOFF_BATCHES; ++i) {
+                PixelBatch* batch = pool.acquire();
+                batch->size = batch_size;
+                batch->first_index = i * batch_size;
+                queue.push(batch);
+            }
+            queue.close();
+        });
+        PixelBatch* batch = nullptr;
+        uint64_t pixels = 0;
+        while (queue.pop(batch)) {
+            pixels += batch->size;
+            pool.release(batch);
+        }
+        producer.join();
+        benchmark::DoNotOptimize(pixels);
+    }
+    set_throughput(state, HANDOFF_BATCHES, batch_size);
+}
+BENCHMARK(BM_BatchHandoffInProcess)->RangeMultiplier(4)->Range(64, 4096)->UseRealTime();
+
+void BM_BatchHandoffShm(benchmark::State& state) {
+    const size_t batch_size = static_cast<size_t>(state.range(0));
+    const std::string name = "pipeline_bench_" + std::to_string(getpid());
+    std::vector<uint8_t> source = synthetic_pixels(batch_size);
+    std::vector<uint8_t> target(batch_size);
+    for (auto _ : state) {
+        ShmRing producer_end;
+        ShmRing consumer_end;
+        if (!producer_end.create(name, HANDOFF_SLOTS, batch_size, BENCH_WIDTH, 0) ||
+            !consumer_end.attach(name, 0)) {
+            state.SkipWithError("no shared-memory ring");
+            break;
+        }
+        std::thread producer([&producer_end, &source, batch_size] {
+            for (size_t i = 0; i < HANDOFF_BATCHES; ++i) {
+                producer_end.write(source.data(), batch_size, i * batch_size, true);
+            }
+            producer_end.close();
+        });
+        uint64_t pixels = 0;
+        size_t count = 0;
+        while ((count = consumer_end.read_pixels(target.data(), batch_size)) > 0) {
+            pixels += count;
+        }
+        producer.join();
+        benchmark::DoNotOptimize(pixels);
+    }
+    set_throughput(state, HANDOFF_BATCHES, batch_size);
+}
+BENCHMARK(BM_BatchHandoffShm)->RangeMultiplier(4)->Range(64, 4096)->UseRealTime();
+
+} // namespace
@@ -0,0 +1,50 @@
+// Result sinks: the cost of write() per result, including the final flush,
+// for every sink the filter can feed. The results threshold a synthetic web
+// directly, so the defects are the blobs of SyntheticSource.
+#include "bench_util.h"
+#include "result_sink.h"
+#include <memory>
+
+namespace {
+
+// Between the synthetic background (40) and a defect (160).
+const int BENCH_DEFECT_LEVEL = 100;
+
+enum class SinkKind { Null, Text, Sampled, Bitmap, Rle, Events, Regions };
+
+std::unique_ptr<ResultSink> make_sink(SinkKind kind, std::ostream& text, const std::string& path) {
+    switch (kind) {
+    case SinkKind::Null: return std::make_unique<NullSink>();
+    case SinkKind::Text: return std::make_unique<TextSink>(text);
+    case SinkKind::Sampled: return std::make_unique<TextSink>(text, 1000);
+    case SinkKind::Bitmap: return std::make_unique<BitmapSink>(path, BENCH_WIDTH);
+    case SinkKind::Rle: return std::make_unique<RleSink>(path, BENCH_WIDTH);
+    case SinkKind::Events: return std::make_unique<EventSink>(path, BENCH_WIDTH);
+    default: return std::make_unique<RegionSink>(path, BENCH_WIDTH);
+    }
+}
+
+// One sink per iteration takes range(0) results and is finished.
+void BM_Sink(benchmark::State& state, SinkKind kind) {
+    const size_t count = static_cast<size_t>(state.range(0));
+    const std::vector<uint8_t> pixels = synthetic_pixels(count);
+    TempFile file(".out");
+    std::ofstream text("/dev/null");
+    for (auto _ : state) {
+        std::unique_ptr<ResultSink> sink = make_sink(kind, text, file.path());
+        for (size_t i = 0; i < count; ++i) {
+            sink->write(i, pixels[i], pixels[i], pixels[i] >= BENCH_DEFECT_LEVEL);
+        }
+        sink->finish();
+    }
+    set_throughput(state, count, 1);
+}
+BENCHMARK_CAPTURE(BM_Sink, null, SinkKind::Null)->RangeMultiplier(16)->Range(1 << 12, 1 << 20);
+BENCHMARK_CAPTURE(BM_Sink, text, SinkKind::Text)->RangeMultiplier(16)->Range(1 << 12, 1 << 20);
+BENCHMARK_CAPTURE(BM_Sink, sampled, SinkKind::Sampled)->RangeMultiplier(16)->Range(1 << 12, 1 << 20);
+BENCHMARK_CAPTURE(BM_Sink, bitmap, SinkKind::Bitmap)->RangeMultiplier(16)->Range(1 << 12, 1 << 20);
+BENCHMARK_CAPTURE(BM_Sink, rle, SinkKind::Rle)->RangeMultiplier(16)->Range(1 << 12, 1 << 20);
+BENCHMARK_CAPTURE(BM_Sink, events, SinkKind::Events)->RangeMultiplier(16)->Range(1 << 12, 1 << 20);
+BENCHMARK_CAPTURE(BM_Sink, regions, SinkKind::Regions)->RangeMultiplier(16)->Range(1 << 12, 1 << 20);
+
+} // namespace
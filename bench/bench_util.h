@@ -0,0 +1,79 @@
+#ifndef BENCH_UTIL_H
+#define BENCH_UTIL_H
+
+#include "random_source.h"
+#include "synthetic_source.h"
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <cstdio>   // For std::remove
+#include <cstdlib>  // For mkstemp
+#include <fstream>
+#include <string>
+#include <unistd.h> // For close
+#include <vector>
+
+// Helpers shared by the microbenchmarks in bench/.
+
+// Row width of the synthetic web the benchmarks work on.
+const int BENCH_WIDTH = 1024;
+
+// Report items/s and bytes/s for items_per_iteration items of bytes_per_item
+// bytes each, so every benchmark reads the same way. The time per item is
+// items/s inverted.
+inline void set_throughput(benchmark::State& state, uint64_t items_per_iteration, uint64_t bytes_per_item) {
+    const uint64_t items = static_cast<uint64_t>(state.iterations()) * items_per_iteration;
+    state.SetItemsProcessed(static_cast<int64_t>(items));
+    state.SetBytesProcessed(static_cast<int64_t>(items * bytes_per_item));
+}
+
+// count pixels of a reproducible synthetic web: noisy background with about
+// defects_per_mpixel round defects per million pixels.
+inline std::vector<uint8_t> synthetic_pixels(size_t count, double defects_per_mpixel = 2000.0) {
+    RandomPixelSource random;
+    random.set_engine(RandomEngine::Xoshiro256pp);
+    random.seed(42);
+    SyntheticConfig config;
+    config.defects_per_mpixel = defects_per_mpixel;
+    SyntheticSource source(random, BENCH_WIDTH, config);
+    std::vector<uint8_t> pixels(count);
+    source.fill(pixels.data(), pixels.size());
+    return pixels;
+}
+
+// A file in /tmp, removed again when the object goes out of scope.
+class TempFile {
+public:
+    explicit TempFile(const char* suffix = "") {
+        char name[] = "/tmp/pipeline_bench_XXXXXX";
+        int fd = mkstemp(name);
+        if (fd >= 0) {
+            close(fd);
+            std::remove(name);
+        }
+        path_ = std::string(name) + suffix;
+    }
+    ~TempFile() { std::remove(path_.c_str()); }
+
+    TempFile(const TempFile&) = delete;
+    TempFile& operator=(const TempFile&) = delete;
+
+    const std::string& path() const { return path_; }
+
+private:
+    std::string path_;
+};
+
+// Write pixels as a CSV of m columns per line; returns the file size.
+inline size_t write_csv(const std::string& path, const std::vector<uint8_t>& pixels, int m) {
+    std::string text;
+    text.reserve(pixels.size() * 4);
+    for (size_t i = 0; i < pixels.size(); ++i) {
+        text += std::to_string(pixels[i]);
+        text += ((i + 1) % static_cast<size_t>(m) == 0 || i + 1 == pixels.size()) ? '\n' : ',';
+    }
+    std::ofstream file(path, std::ios::binary);
+    file.write(text.data(), static_cast<std::streamsize>(text.size()));
+    return text.size();
+}
+
+#endif // BENCH_UTIL_H
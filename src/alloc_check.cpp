@@ -0,0 +1,96 @@
+#include "alloc_check.h"
+
+#ifdef PIPELINE_ALLOC_CHECK
+
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+
+// glibc's own entry points; the definitions below interpose the public names
+// for the whole process (libstdc++'s operator new included).
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* pointer, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+}
+
+namespace {
+
+std::atomic<bool> armed{false};
+std::atomic<uint64_t> violations{0};
+std::atomic<size_t> first_size{0};
+// Initial-exec TLS in the executable: reading it never allocates.
+thread_local bool steady = false;
+
+inline void note(size_t bytes) {
+    if (steady && armed.load(std::memory_order_relaxed)) {
+        if (violations.fetch_add(1, std::memory_order_relaxed) == 0) {
+            first_size.store(bytes, std::memory_order_relaxed);
+        }
+        alloc_check_hit(bytes);
+    }
+}
+
+} // namespace
+
+void alloc_check_arm(bool on) {
+    armed.store(on, std::memory_order_relaxed);
+}
+
+void alloc_check_set_steady(bool on) {
+    steady = on;
+}
+
+uint64_t alloc_check_violations() {
+    return violations.load(std::memory_order_relaxed);
+}
+
+size_t alloc_check_first_size() {
+    return first_size.load(std::memory_order_relaxed);
+}
+
+void __attribute__((noinline)) alloc_check_hit(size_t bytes) {
+    asm volatile("" : : "r"(bytes) : "memory"); // Keep the call for the breakpoint
+}
+
+extern "C" {
+
+void* malloc(size_t size) {
+    note(size);
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) {
+    note(count * size);
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* pointer, size_t size) {
+    note(size);
+    return __libc_realloc(pointer, size);
+}
+
+void* memalign(size_t alignment, size_t size) {
+    note(size);
+    return __libc_memalign(alignment, size);
+}
+
+void* aligned_alloc(size_t alignment, size_t size) {
+    note(size);
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void** pointer, size_t alignment, size_t size) {
+    note(size);
+    void* block = __libc_memalign(alignment, size);
+    if (!block) {
+        return ENOMEM;
+    }
+    *pointer = block;
+    return 0;
+}
+
+} // extern "C"
+
+#endif // PIPELINE_ALLOC_CHECK
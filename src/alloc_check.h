@@ -0,0 +1,80 @@
+#ifndef ALLOC_CHECK_H
+#define ALLOC_CHECK_H
+
+#include <cstddef> // For size_t
+#include <cstdint>
+
+// Debug check that the pipeline's hot loops never call the allocator.
+//
+// Built with ALLOC_CHECK=1 (-DPIPELINE_ALLOC_CHECK), malloc, calloc, realloc
+// and the aligned variants are interposed (operator new ends up in malloc as
+// well) and counted while two conditions hold: the check is armed
+// (alloc_check_arm(), from --alloc-check), and the calling thread is in its
+// steady state. A stage thread enters the steady state through a
+// SteadyStateScope once it has handled its warm-up items, and leaves it when
+// its loop ends, so setup, warm-up growth and the end-of-run reports are not
+// counted. main() fails the run if anything was.
+//
+// Without ALLOC_CHECK every function here is an empty inline and the
+// allocator is left alone.
+
+#ifdef PIPELINE_ALLOC_CHECK
+constexpr bool ALLOC_CHECK_AVAILABLE = true;
+#else
+constexpr bool ALLOC_CHECK_AVAILABLE = false;
+#endif
+
+// Items a stage handles before its allocations count.
+const uint64_t ALLOC_CHECK_WARMUP_ITEMS = 4096;
+
+#ifdef PIPELINE_ALLOC_CHECK
+
+void alloc_check_arm(bool armed);
+void alloc_check_set_steady(bool steady); // Calling thread only
+
+// Allocations counted so far, and the size of the first one. To find where
+// it comes from, break on alloc_check_hit in a debugger.
+uint64_t alloc_check_violations();
+size_t alloc_check_first_size();
+
+// Called on every counted allocation; a convenient breakpoint.
+void alloc_check_hit(size_t bytes);
+
+#else
+
+inline void alloc_check_arm(bool) {}
+inline void alloc_check_set_steady(bool) {}
+inline uint64_t alloc_check_violations() { return 0; }
+inline size_t alloc_check_first_size() { return 0; }
+
+#endif
+
+// Marks the calling stage thread as steady once tick() has been called
+// warmup_items times; leave() (or the destructor) ends it before the thread
+// starts reporting.
+class SteadyStateScope {
+public:
+    explicit SteadyStateScope(uint64_t warmup_items = ALLOC_CHECK_WARMUP_ITEMS)
+        : warmup_items_(warmup_items), items_(0) {}
+    ~SteadyStateScope() { leave(); }
+
+    SteadyStateScope(const SteadyStateScope&) = delete;
+    SteadyStateScope& operator=(const SteadyStateScope&) = delete;
+
+    void tick() {
+        if (ALLOC_CHECK_AVAILABLE && ++items_ == warmup_items_) {
+            alloc_check_set_steady(true);
+        }
+    }
+    void leave() {
+        if (ALLOC_CHECK_AVAILABLE && items_ >= warmup_items_) {
+            alloc_check_set_steady(false);
+        }
+    }
+
+private:
+    uint64_t warmup_items_;
+    uint64_t items_;
+};
+
+#endif // ALLOC_CHECK_H
@@ -0,0 +1,84 @@
+#include "arena.h"
+#include <cstring>  // For std::memset
+#include <iomanip>
+#include <iostream> // For std::cerr
+#include <sstream>
+#include <sys/mman.h>
+
+Arena::Arena(size_t bytes, bool hugepages)
+    : base_(nullptr),
+      size_(0),
+      used_(0),
+      backing_(Backing::None) {
+    if (bytes == 0) {
+        return;
+    }
+    void* block = MAP_FAILED;
+    if (hugepages) {
+        size_t rounded = (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+        block = mmap(nullptr, rounded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (block != MAP_FAILED) {
+            size_ = rounded;
+            backing_ = Backing::Huge;
+        }
+    }
+    if (block == MAP_FAILED) {
+        block = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (block == MAP_FAILED) {
+            std::cerr << "Arena Error: Could not map " << bytes << " bytes." << std::endl;
+            return;
+        }
+        size_ = bytes;
+        backing_ = Backing::Pages;
+        if (hugepages && madvise(block, bytes, MADV_HUGEPAGE) == 0) {
+            backing_ = Backing::TransparentHuge;
+        }
+    }
+    base_ = static_cast<uint8_t*>(block);
+    // Fault every page in now (on the calling thread's node), not on the
+    // first batch of the run.
+    std::memset(base_, 0, size_);
+}
+
+Arena::~Arena() {
+    if (base_) {
+        munmap(base_, size_);
+    }
+}
+
+void* Arena::allocate(size_t bytes, size_t align) {
+    size_t start = (used_ + align - 1) & ~(align - 1);
+    if (!base_ || start + bytes > size_) {
+        return nullptr;
+    }
+    used_ = start + bytes;
+    return base_ + start;
+}
+
+namespace {
+
+std::string format_bytes(size_t bytes) {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1);
+    if (bytes >= 1024 * 1024) {
+        out << static_cast<double>(bytes) / (1024.0 * 1024.0) << " MiB";
+    } else {
+        out << static_cast<double>(bytes) / 1024.0 << " KiB";
+    }
+    return out.str();
+}
+
+} // namespace
+
+std::string Arena::describe() const {
+    return format_bytes(size_) + " on " + backing_name(backing_) + ", " + format_bytes(used_) + " used";
+}
+
+const char* Arena::backing_name(Backing backing) {
+    switch (backing) {
+    case Backing::Pages: return "ordinary pages";
+    case Backing::TransparentHuge: return "transparent hugepages";
+    case Backing::Huge: return "hugepages";
+    default: return "nothing";
+    }
+}
@@ -0,0 +1,54 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef> // For size_t
+#include <cstdint>
+#include <string>
+
+// One fixed-size block of memory mapped at startup, handed out by a bump
+// pointer and released only as a whole. A lane sizes its arena from m, the
+// batch size and the queue capacity, so the batch payloads never touch the
+// allocator again and sit on as few pages (and TLB entries) as possible.
+//
+// With hugepages, the block is first requested as explicit 2 MiB pages
+// (MAP_HUGETLB, needs pages reserved in /proc/sys/vm/nr_hugepages). If none
+// are available it falls back to ordinary pages with a transparent-hugepage
+// hint (madvise MADV_HUGEPAGE). backing() tells which one was granted.
+class Arena {
+public:
+    enum class Backing {
+        None,            // Not mapped (size 0 or mmap failed)
+        Pages,           // Ordinary 4 KiB pages
+        TransparentHuge, // Ordinary pages with MADV_HUGEPAGE
+        Huge             // Explicit MAP_HUGETLB pages
+    };
+
+    static const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+    Arena(size_t bytes, bool hugepages);
+    ~Arena();
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // bytes from the block, aligned to align (a power of two); nullptr once
+    // the block is exhausted. The memory is zeroed and already faulted in.
+    void* allocate(size_t bytes, size_t align = 64);
+
+    size_t size() const { return size_; }
+    size_t used() const { return used_; }
+    Backing backing() const { return backing_; }
+
+    // "2.0 MiB on hugepages, 1.5 MiB used" and the like.
+    std::string describe() const;
+
+    static const char* backing_name(Backing backing);
+
+private:
+    uint8_t* base_;
+    size_t size_;
+    size_t used_;
+    Backing backing_;
+};
+
+#endif // ARENA_H
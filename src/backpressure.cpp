@@ -0,0 +1,96 @@
+#include "backpressure.h"
+#include <iomanip>
+#include <sstream>
+
+BackpressureController::BackpressureController(const BackpressureConfig& config)
+    : config_(config),
+      overloaded_(false),
+      depth_(0),
+      lines_seen_(0),
+      overload_episodes_(0),
+      shed_items_(0),
+      shed_pixels_(0),
+      throttle_ns_(0) {
+    configure(config);
+}
+
+void BackpressureController::configure(const BackpressureConfig& config) {
+    config_ = config;
+    if (config_.low_watermark == 0 || config_.low_watermark >= config_.high_watermark) {
+        config_.low_watermark = config_.high_watermark / 2;
+    }
+    if (config_.decimate_keep == 0) {
+        config_.decimate_keep = 1;
+    }
+}
+
+void BackpressureController::observe(size_t depth) {
+    depth_ = depth;
+    if (!overloaded_ && depth >= config_.high_watermark) {
+        overloaded_ = true;
+        lines_seen_ = 0;
+        ++overload_episodes_;
+        live_overloads.set(overload_episodes_);
+    } else if (overloaded_ && depth <= config_.low_watermark) {
+        overloaded_ = false;
+    }
+}
+
+bool BackpressureController::admit_line() {
+    if (!overloaded_) {
+        return true;
+    }
+    switch (config_.policy) {
+    case OverloadPolicy::DropLines:
+        return false;
+    case OverloadPolicy::Decimate:
+        // Decimation only divides the input rate by N; if the filter is
+        // slower still, stop pushing altogether once the queue has grown
+        // another half of the hysteresis band past the high watermark.
+        if (depth_ >= config_.high_watermark + (config_.high_watermark - config_.low_watermark) / 2) {
+            return false;
+        }
+        return lines_seen_++ % config_.decimate_keep == 0;
+    default:
+        return true;
+    }
+}
+
+void BackpressureController::record_shed(size_t pixels) {
+    ++shed_items_;
+    shed_pixels_ += pixels;
+    live_shed_items.set(shed_items_);
+    live_shed_pixels.set(shed_pixels_);
+}
+
+void BackpressureController::record_throttle(int64_t ns) {
+    throttle_ns_ += ns;
+    live_throttle_ns.set(static_cast<uint64_t>(throttle_ns_));
+}
+
+std::string BackpressureController::describe() const {
+    std::ostringstream out;
+    out << policy_name(config_.policy);
+    if (config_.policy == OverloadPolicy::Decimate) {
+        out << " (keep 1 line in " << config_.decimate_keep << ")";
+    }
+    out << " above " << config_.high_watermark << " queued items, resume at " << config_.low_watermark;
+    return out.str();
+}
+
+std::string BackpressureController::summary() const {
+    std::ostringstream out;
+    out << overload_episodes_ << " overload episodes, " << shed_items_ << " items shed ("
+        << shed_pixels_ << " pixels), throttled " << std::fixed << std::setprecision(3)
+        << static_cast<double>(throttle_ns_) / 1e6 << " ms";
+    return out.str();
+}
+
+const char* BackpressureController::policy_name(OverloadPolicy policy) {
+    switch (policy) {
+    case OverloadPolicy::Throttle: return "throttle";
+    case OverloadPolicy::DropLines: return "drop lines";
+    case OverloadPolicy::Decimate: return "decimate";
+    default: return "none";
+    }
+}
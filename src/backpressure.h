@@ -0,0 +1,92 @@
+#ifndef BACKPRESSURE_H
+#define BACKPRESSURE_H
+
+#include "metrics.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// What the producer does while the queue to the filter is overloaded.
+enum class OverloadPolicy {
+    None,      // Push regardless (the original behaviour)
+    Throttle,  // Stop producing until the queue has drained to the low watermark
+    DropLines, // Discard whole lines until the queue has drained to the low watermark
+    Decimate   // Keep one line in decimate_keep; drop all if the queue still grows
+};
+
+struct BackpressureConfig {
+    OverloadPolicy policy = OverloadPolicy::None;
+    size_t high_watermark = 0;    // Queue items (pairs or batches); 0 = chosen by the lane
+    size_t low_watermark = 0;     // 0 = high_watermark / 2
+    size_t decimate_keep = 2;     // Decimate: one line in N is kept
+};
+
+// Producer-side backpressure for one queue: depth watermarks with hysteresis
+// and the shedding decision per line.
+//
+// The producer calls observe() with the queue depth after every iteration.
+// The queue counts as overloaded from the moment its depth reaches the high
+// watermark until it has drained to the low one, so the policy does not
+// flap around a single threshold. While overloaded, admit_line() tells the
+// producer whether to push the line it is about to send; a shed line is
+// still read from the source (the camera does not wait), only not queued.
+//
+// Single-threaded (the producer's); the live counters can be read from any
+// thread like the other stage metrics.
+class BackpressureController {
+public:
+    explicit BackpressureController(const BackpressureConfig& config = BackpressureConfig());
+
+    // Replace the configuration (before the producer starts); fills in the
+    // low watermark.
+    void configure(const BackpressureConfig& config);
+
+    bool enabled() const { return config_.policy != OverloadPolicy::None && config_.high_watermark > 0; }
+    const BackpressureConfig& config() const { return config_; }
+
+    // Queue depth seen after the latest push (or shed line).
+    void observe(size_t depth);
+    bool overloaded() const { return overloaded_; }
+
+    // Throttle policy: the producer should wait for the queue to drain.
+    bool should_throttle() const { return overloaded_ && config_.policy == OverloadPolicy::Throttle; }
+    bool drained(size_t depth) const { return depth <= config_.low_watermark; }
+
+    // Decide whether the next line is pushed (true) or shed (false).
+    bool admit_line();
+
+    // Account a shed item of the given size, and time spent throttled.
+    void record_shed(size_t pixels);
+    void record_throttle(int64_t ns);
+
+    // Totals for the end-of-run report (kept without STATS as well).
+    uint64_t overload_episodes() const { return overload_episodes_; }
+    uint64_t shed_items() const { return shed_items_; }
+    uint64_t shed_pixels() const { return shed_pixels_; }
+    int64_t throttle_ns() const { return throttle_ns_; }
+
+    // Live mirrors of the totals, for the periodic stats dump.
+    MetricCounter live_overloads;
+    MetricCounter live_shed_items;
+    MetricCounter live_shed_pixels;
+    MetricCounter live_throttle_ns;
+
+    // "drop lines above 48 items (resume at 24)" and the like.
+    std::string describe() const;
+    // "3 overload episodes, 120 lines shed (7680 pixels), throttled 1.2 ms"
+    std::string summary() const;
+
+    static const char* policy_name(OverloadPolicy policy);
+
+private:
+    BackpressureConfig config_;
+    bool overloaded_;
+    size_t depth_;
+    uint64_t lines_seen_;    // Lines offered while overloaded (decimation phase)
+    uint64_t overload_episodes_;
+    uint64_t shed_items_;
+    uint64_t shed_pixels_;
+    int64_t throttle_ns_;
+};
+
+#endif // BACKPRESSURE_H
@@ -1,59 +1,88 @@
 #ifndef BLOCKING_QUEUE_H
 #define BLOCKING_QUEUE_H
 
-#include <queue>
+#include "pipeline_queue.h"
+#include "ring_buffer.h"
 #include <mutex>
 #include <condition_variable>
 
+// Unbounded FIFO guarded by a mutex. The items live in a RingBuffer that only
+// allocates when the queue grows past its deepest point so far; pass the
+// expected depth to start with enough room.
 template <typename T>
-class BlockingQueue {
+class BlockingQueue : public PipelineQueue<T> {
 public:
-    BlockingQueue() = default;
+    explicit BlockingQueue(size_t initial_capacity = 16) : queue_(initial_capacity) {}
 
     // Push an item to the queue.
-    void push(T item) {
+    void push(T item) override {
         std::unique_lock<std::mutex> lock(mutex_);
-        queue_.push(std::move(item));
+        queue_.push_back(std::move(item));
         // Notify one waiting thread that an item is available.
         cond_var_.notify_one();
     }
 
     // Pop an item from the queue. Blocks if the queue is empty.
-    T pop() {
+    T pop() override {
         std::unique_lock<std::mutex> lock(mutex_);
         // Wait until the queue is not empty.
         cond_var_.wait(lock, [this] { return !queue_.empty(); });
         T item = std::move(queue_.front());
-        queue_.pop();
+        queue_.pop_front();
         return item;
     }
 
+    // Pop an item, or return false once the queue is closed and drained.
+    bool pop(T& item) override {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cond_var_.wait(lock, [this] { return !queue_.empty() || closed_; });
+        if (queue_.empty()) {
+            return false;
+        }
+        item = std::move(queue_.front());
+        queue_.pop_front();
+        return true;
+    }
+
     // Try to pop an item from the queue without blocking.
     // Returns true if an item was popped, false otherwise.
-    bool try_pop(T& item) {
+    bool try_pop(T& item) override {
         std::unique_lock<std::mutex> lock(mutex_);
         if (queue_.empty()) {
             return false;
         }
         item = std::move(queue_.front());
-        queue_.pop();
+        queue_.pop_front();
         return true;
     }
 
     // Check if the queue is empty.
-    bool empty() const {
+    bool empty() const override {
         std::unique_lock<std::mutex> lock(mutex_);
         return queue_.empty();
     }
 
     // Get the current size of the queue.
-    size_t size() const {
+    size_t size() const override {
         std::unique_lock<std::mutex> lock(mutex_);
         return queue_.size();
     }
 
+    // Mark the end of the stream and wake every waiting consumer.
+    void close() override {
+        std::unique_lock<std::mutex> lock(mutex_);
+        closed_ = true;
+        cond_var_.notify_all();
+    }
+
+    bool closed() const override {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return closed_;
+    }
+
 private:
-    std::queue<T> queue_;
+    RingBuffer<T> queue_;
+    bool closed_ = false;
     mutable std::mutex mutex_; // mutable to allow locking in const methods like empty() and size()
     std::condition_variable cond_var_;
 };
@@ -0,0 +1,17 @@
+#ifndef CPU_RELAX_H
+#define CPU_RELAX_H
+
+// Hint to the CPU that we are in a spin-wait loop. On x86 this is the PAUSE
+// instruction, which lowers power use and avoids a memory-order pipeline flush
+// when the spun-on cache line finally changes. On ARM it is YIELD.
+inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    asm volatile("yield" ::: "memory");
+#else
+    asm volatile("" ::: "memory");
+#endif
+}
+
+#endif // CPU_RELAX_H
@@ -0,0 +1,17 @@
+#ifndef CPU_TIME_H
+#define CPU_TIME_H
+
+#include <ctime> // For clock_gettime, CLOCK_THREAD_CPUTIME_ID
+
+// CPU time consumed so far by the calling thread, in nanoseconds. Unlike wall
+// time this excludes time spent sleeping, blocked, or preempted, so the
+// difference between two calls is what a stage actually cost.
+inline long long thread_cpu_time_ns() {
+    timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) {
+        return 0;
+    }
+    return static_cast<long long>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+
+#endif // CPU_TIME_H
@@ -0,0 +1,395 @@
+#include "csv_source.h"
+#include <algorithm>    // For std::max
+#include <iostream>     // For std::cerr
+#include <cstring>      // For std::memmove, std::strerror
+#include <cerrno>       // For errno
+#include <fcntl.h>      // For open
+#include <unistd.h>     // For read, close
+#include <sys/mman.h>   // For mmap, madvise
+#include <sys/stat.h>   // For fstat
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CSV_SOURCE_X86 1
+#endif
+
+namespace {
+
+// Bit i of each mask describes byte i of a 32-byte block.
+struct CsvMasks {
+    uint32_t comma;
+    uint32_t newline;
+    uint32_t digit;
+};
+
+#if !defined(CSV_SOURCE_X86)
+
+void classify32_scalar(const char* p, CsvMasks& masks) {
+    masks.comma = masks.newline = masks.digit = 0;
+    for (unsigned i = 0; i < 32; ++i) {
+        masks.comma |= static_cast<uint32_t>(p[i] == ',') << i;
+        masks.newline |= static_cast<uint32_t>(p[i] == '\n') << i;
+        masks.digit |= static_cast<uint32_t>(static_cast<unsigned char>(p[i] - '0') <= 9) << i;
+    }
+}
+
+#endif
+
+#if defined(CSV_SOURCE_X86)
+
+// SSE2 is part of x86-64, so this is the baseline x86 path.
+void classify32_sse2(const char* p, CsvMasks& masks) {
+    const __m128i comma = _mm_set1_epi8(',');
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i zero_char = _mm_set1_epi8('0');
+    const __m128i nine = _mm_set1_epi8(9);
+    uint32_t result[3] = {0, 0, 0};
+    for (int half = 0; half < 2; ++half) {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16 * half));
+        // A byte is a digit if (byte - '0') <= 9 as an unsigned value.
+        const __m128i offset = _mm_sub_epi8(bytes, zero_char);
+        const __m128i is_digit = _mm_cmpeq_epi8(_mm_min_epu8(offset, nine), offset);
+        const int shift = 16 * half;
+        result[0] |= static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, comma))) << shift;
+        result[1] |= static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, newline))) << shift;
+        result[2] |= static_cast<uint32_t>(_mm_movemask_epi8(is_digit)) << shift;
+    }
+    masks.comma = result[0];
+    masks.newline = result[1];
+    masks.digit = result[2];
+}
+
+__attribute__((target("avx2")))
+void classify32_avx2(const char* p, CsvMasks& masks) {
+    const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    const __m256i offset = _mm256_sub_epi8(bytes, _mm256_set1_epi8('0'));
+    const __m256i nine = _mm256_set1_epi8(9);
+    const __m256i is_digit = _mm256_cmpeq_epi8(_mm256_min_epu8(offset, nine), offset);
+    masks.comma = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(','))));
+    masks.newline = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('\n'))));
+    masks.digit = static_cast<uint32_t>(_mm256_movemask_epi8(is_digit));
+}
+
+#endif
+
+using Classify32Fn = void (*)(const char*, CsvMasks&);
+
+Classify32Fn select_classify32() {
+#if defined(CSV_SOURCE_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return classify32_avx2;
+    }
+    return classify32_sse2;
+#else
+    return classify32_scalar;
+#endif
+}
+
+const Classify32Fn classify32 = select_classify32();
+
+} // namespace
+
+CsvSource::CsvSource(int m)
+    : m_(m),
+      fd_(-1),
+      data_(nullptr),
+      pos_(nullptr),
+      end_(nullptr),
+      mapped_(nullptr),
+      mapped_size_(0),
+      stream_eof_(false),
+      in_line_(false),
+      line_number_(0),
+      cells_in_line_(0),
+      error_count_(0) {
+    errors_.reserve(MAX_RECORDED_ERRORS);
+}
+
+CsvSource::~CsvSource() {
+    close();
+}
+
+bool CsvSource::open(const std::string& filepath) {
+    close();
+    if (prefetch_config_.depth > 0) {
+        // Stream mode, but the bytes come from chunks read ahead on the I/O thread.
+        prefetch_ = std::make_unique<PrefetchReader>(prefetch_config_);
+        if (!prefetch_->open(filepath)) {
+            prefetch_.reset();
+            return false;
+        }
+        chunk_.resize(std::max(STREAM_CHUNK_SIZE, prefetch_config_.chunk_bytes));
+        data_ = pos_ = end_ = chunk_.data();
+        stream_eof_ = false;
+        return true;
+    }
+    fd_ = ::open(filepath.c_str(), O_RDONLY);
+    if (fd_ < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd_, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void* mapping = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd_, 0);
+        if (mapping != MAP_FAILED) {
+            madvise(mapping, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+            mapped_ = static_cast<char*>(mapping);
+            mapped_size_ = static_cast<size_t>(st.st_size);
+            data_ = pos_ = mapped_;
+            end_ = mapped_ + mapped_size_;
+            stream_eof_ = true; // Everything is already visible
+            return true;
+        }
+    }
+
+    // Not mappable (pipe, FIFO, empty or special file): stream it with read().
+    chunk_.resize(STREAM_CHUNK_SIZE);
+    data_ = pos_ = end_ = chunk_.data();
+    stream_eof_ = false;
+    return true;
+}
+
+void CsvSource::close() {
+    prefetch_.reset(); // Stops the I/O thread
+    if (mapped_) {
+        munmap(mapped_, mapped_size_);
+        mapped_ = nullptr;
+        mapped_size_ = 0;
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+    data_ = pos_ = end_ = nullptr;
+    stream_eof_ = false;
+    in_line_ = false;
+    line_number_ = 0;
+    cells_in_line_ = 0;
+    errors_.clear();
+    error_count_ = 0;
+}
+
+bool CsvSource::eof() const {
+    return stream_eof_ && pos_ == end_;
+}
+
+bool CsvSource::refill() {
+    // Stream mode only: keep the unparsed tail and read more behind it.
+    if (mapped_ || stream_eof_ || !is_open()) {
+        return false;
+    }
+    size_t tail = static_cast<size_t>(end_ - pos_);
+    if (tail == chunk_.size()) {
+        chunk_.resize(chunk_.size() * 2); // A single cell larger than the chunk
+    }
+    std::memmove(chunk_.data(), pos_, tail);
+    data_ = pos_ = chunk_.data();
+    end_ = data_ + tail;
+
+    if (prefetch_) {
+        size_t got = prefetch_->read(chunk_.data() + tail, chunk_.size() - tail);
+        end_ += got;
+        stream_eof_ = got == 0;
+        return got > 0;
+    }
+    while (true) {
+        ssize_t got = ::read(fd_, chunk_.data() + tail, chunk_.size() - tail);
+        if (got > 0) {
+            end_ += got;
+            return true;
+        }
+        if (got == 0) {
+            stream_eof_ = true;
+            return false;
+        }
+        if (errno != EINTR) {
+            std::cerr << "CSV Error: read failed: " << std::strerror(errno) << std::endl;
+            stream_eof_ = true;
+            return false;
+        }
+    }
+}
+
+bool CsvSource::next_cell(const char*& cell_begin, const char*& cell_end, bool& line_end) {
+    // Find the next complete cell at pos_, terminated by ',' or '\n' (or the
+    // end of the file). Returns false when no input is left.
+    size_t scanned = 0;
+    while (true) {
+        const char* p = pos_ + scanned;
+        while (p < end_ && *p != ',' && *p != '\n') {
+            ++p;
+        }
+        if (p < end_) {
+            cell_begin = pos_;
+            cell_end = p;
+            line_end = (*p == '\n');
+            pos_ = p + 1;
+            return true;
+        }
+        scanned = static_cast<size_t>(p - pos_);
+        if (!refill()) {
+            break;
+        }
+    }
+    if (pos_ == end_) {
+        return false;
+    }
+    // Last line without a trailing newline.
+    cell_begin = pos_;
+    cell_end = end_;
+    line_end = true;
+    pos_ = end_;
+    return true;
+}
+
+CsvSource::CellStatus CsvSource::parse_cell(const char* begin, const char* end, uint8_t& value) {
+    while (begin < end && (*begin == ' ' || *begin == '\t')) {
+        ++begin;
+    }
+    while (end > begin && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r')) {
+        --end;
+    }
+    if (begin == end) {
+        return CellStatus::Invalid;
+    }
+    unsigned result = 0;
+    bool overflow = false;
+    for (const char* p = begin; p < end; ++p) {
+        unsigned digit = static_cast<unsigned>(*p - '0');
+        if (digit > 9) {
+            return CellStatus::Invalid;
+        }
+        result = result * 10 + digit;
+        if (result > 255) {
+            overflow = true;
+            result = 256; // Keep scanning for garbage without overflowing
+        }
+    }
+    if (overflow) {
+        return CellStatus::OutOfRange;
+    }
+    value = static_cast<uint8_t>(result);
+    return CellStatus::Ok;
+}
+
+void CsvSource::report_cell_error(CellStatus status, const char* begin, const char* end) {
+    ++error_count_;
+    if (errors_.size() < MAX_RECORDED_ERRORS) {
+        errors_.push_back({line_number_, cells_in_line_ + 1, status == CellStatus::OutOfRange});
+    }
+    std::cerr << (status == CellStatus::Invalid ? "CSV Error: Invalid argument in CSV line "
+                                                : "CSV Error: Out of range in CSV line ")
+              << line_number_ << ": ";
+    std::cerr.write(begin, end - begin);
+    std::cerr << std::endl;
+}
+
+void CsvSource::finish_line() {
+    if (m_ > 0 && cells_in_line_ < m_) {
+        std::cerr << "CSV Warning: Line " << line_number_ << " has fewer than m=" << m_ << " columns. (" << cells_in_line_ << ")" << std::endl;
+    }
+    in_line_ = false;
+}
+
+void CsvSource::handle_cell(const char* begin, const char* end, bool line_end, int known_value,
+                            uint8_t* out, size_t& written) {
+    // known_value is the already converted cell (0-255), or -1 if the cell
+    // still has to go through parse_cell().
+    if (!in_line_) {
+        in_line_ = true;
+        ++line_number_;
+        cells_in_line_ = 0;
+    }
+    // An empty cell that ends the line is an empty line or a trailing
+    // comma; getline() never yielded a cell for either.
+    if (begin != end || !line_end) {
+        if (m_ <= 0 || cells_in_line_ < m_) { // Respect m if m > 0
+            if (known_value >= 0) {
+                out[written++] = static_cast<uint8_t>(known_value);
+            } else {
+                uint8_t value;
+                CellStatus status = parse_cell(begin, end, value);
+                if (status == CellStatus::Ok) {
+                    out[written++] = value;
+                } else {
+                    report_cell_error(status, begin, end); // Skip malformed cell
+                }
+            }
+        }
+        ++cells_in_line_;
+    }
+    if (line_end) {
+        finish_line();
+    }
+}
+
+bool CsvSource::tokenize_block(uint8_t* out, size_t max_count, size_t& written) {
+    // Handle every cell that ends inside the 32 bytes at pos_. Returns false
+    // (consuming nothing) if the first cell does not end in this block.
+    const char* block = pos_;
+    CsvMasks masks;
+    classify32(block, masks);
+    uint32_t separators = masks.comma | masks.newline;
+    if (separators == 0) {
+        return false;
+    }
+
+    unsigned start = 0; // Offset of the current cell in the block
+    while (separators != 0 && written < max_count) {
+        unsigned sep = static_cast<unsigned>(__builtin_ctz(separators));
+        separators &= separators - 1;
+        unsigned length = sep - start;
+        int value = -1;
+        // Fast path: 1-3 characters, all digits according to the mask.
+        uint32_t field_bits = (1u << length) - 1;
+        if (length - 1 < 3 && ((masks.digit >> start) & field_bits) == field_bits) {
+            const char* c = block + start;
+            unsigned v = static_cast<unsigned>(c[0] - '0');
+            if (length > 1) {
+                v = v * 10 + static_cast<unsigned>(c[1] - '0');
+            }
+            if (length > 2) {
+                v = v * 10 + static_cast<unsigned>(c[2] - '0');
+            }
+            if (v <= 255) {
+                value = static_cast<int>(v);
+            }
+        }
+        bool line_end = (masks.newline >> sep) & 1u;
+        if (value >= 0 && in_line_ && (m_ <= 0 || cells_in_line_ < m_)) {
+            // Common case inline: a valid pixel in the middle of a row.
+            out[written++] = static_cast<uint8_t>(value);
+            ++cells_in_line_;
+            if (line_end) {
+                finish_line();
+            }
+        } else {
+            handle_cell(block + start, block + sep, line_end, value, out, written);
+        }
+        start = sep + 1;
+    }
+    pos_ = block + start;
+    return true;
+}
+
+size_t CsvSource::read_pixels(uint8_t* out, size_t max_count) {
+    size_t written = 0;
+    const char* cell_begin;
+    const char* cell_end;
+    bool line_end;
+
+    while (written < max_count) {
+        if (end_ - pos_ >= 32 && tokenize_block(out, max_count, written)) {
+            continue;
+        }
+        if (!next_cell(cell_begin, cell_end, line_end)) {
+            if (in_line_) {
+                finish_line();
+            }
+            break;
+        }
+        handle_cell(cell_begin, cell_end, line_end, -1, out, written);
+    }
+    return written;
+}
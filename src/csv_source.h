@@ -0,0 +1,119 @@
+#ifndef CSV_SOURCE_H
+#define CSV_SOURCE_H
+
+#include "prefetch_reader.h"
+#include <cstdint> // For uint8_t
+#include <cstddef> // For size_t
+#include <memory>
+#include <string>
+#include <vector>
+
+// Zero-copy CSV pixel reader.
+//
+// Regular files are memory-mapped and tokenized straight out of the mapped
+// bytes; anything that cannot be mapped (pipes, FIFOs, ...) is read with
+// read() into one reusable chunk buffer. With set_prefetch(), that buffer is
+// filled from chunks a PrefetchReader read ahead on its I/O thread instead, so
+// a slow disk never stalls the parsing thread. Cells are parsed by a hand-rolled
+// uint8 parser and written directly into the caller's buffer, so steady-state
+// reading performs no allocation at all.
+//
+// Semantics follow the original getline/stringstream/stoi reader:
+//  * rows are flattened into one pixel stream, row by row;
+//  * with m > 0 only the first m cells of a row are used;
+//  * malformed cells are skipped with a line-numbered "CSV Error" on stderr,
+//    and rows with fewer than m cells produce a "CSV Warning".
+// Unlike std::stoi, a cell must be a plain non-negative integer (surrounding
+// blanks allowed) and values above 255 are reported as out of range instead
+// of silently wrapping.
+//
+// Separators, newlines and digits are located 32 bytes at a time with SIMD
+// comparison masks (AVX2 or SSE2, picked at runtime), and 1-3 digit fields are
+// converted straight from those masks. Anything else (blanks, '\r', long or
+// malformed cells, the last bytes of the input) goes through the scalar parser.
+// Malformed cells never throw: they are recorded in errors() as well as being
+// reported on stderr.
+
+// One rejected CSV cell.
+struct CsvCellError {
+    int line;          // 1-based line number
+    int column;        // 1-based cell index within the line
+    bool out_of_range; // true: value > 255, false: not a number
+};
+
+class CsvSource {
+public:
+    explicit CsvSource(int m);
+    ~CsvSource();
+
+    CsvSource(const CsvSource&) = delete;
+    CsvSource& operator=(const CsvSource&) = delete;
+
+    // Read ahead on an I/O thread instead of mapping the file (depth 0 = off),
+    // so a slow disk never blocks the parsing thread. Applies to the next open().
+    void set_prefetch(const PrefetchConfig& config) { prefetch_config_ = config; }
+    const PrefetchReader* prefetch() const { return prefetch_.get(); }
+
+    // Open a CSV file. Returns false if it cannot be opened.
+    bool open(const std::string& filepath);
+    void close();
+    bool is_open() const { return fd_ >= 0 || prefetch_ != nullptr; }
+
+    // Parse up to max_count pixels into out. Returns the number written;
+    // fewer than max_count means the end of the file was reached.
+    size_t read_pixels(uint8_t* out, size_t max_count);
+
+    // True once every byte of the file has been consumed.
+    bool eof() const;
+
+    // True if the file is memory-mapped, false when using the read() fallback.
+    bool is_mapped() const { return mapped_ != nullptr; }
+
+    // Number of the line currently being parsed (1-based), for diagnostics.
+    int line_number() const { return line_number_; }
+
+    // The first MAX_RECORDED_ERRORS rejected cells, and the total count.
+    const std::vector<CsvCellError>& errors() const { return errors_; }
+    uint64_t error_count() const { return error_count_; }
+
+    static const size_t MAX_RECORDED_ERRORS = 1024;
+
+private:
+    enum class CellStatus { Ok, Invalid, OutOfRange };
+
+    bool next_cell(const char*& cell_begin, const char*& cell_end, bool& line_end);
+    bool tokenize_block(uint8_t* out, size_t max_count, size_t& written);
+    void handle_cell(const char* begin, const char* end, bool line_end, int known_value,
+                     uint8_t* out, size_t& written);
+    bool refill();
+    void finish_line();
+    static CellStatus parse_cell(const char* begin, const char* end, uint8_t& value);
+    void report_cell_error(CellStatus status, const char* begin, const char* end);
+
+    static const size_t STREAM_CHUNK_SIZE = 1 << 20;
+
+    int m_;
+    int fd_;
+
+    // Current view of the input: the whole mapping, or the filled part of chunk_.
+    const char* data_;
+    const char* pos_;
+    const char* end_;
+
+    char* mapped_;            // mmap base, or nullptr in stream mode
+    size_t mapped_size_;
+    std::vector<char> chunk_; // read() buffer for the stream fallback
+    bool stream_eof_;
+    PrefetchConfig prefetch_config_;
+    std::unique_ptr<PrefetchReader> prefetch_; // Stream mode fed by the I/O thread
+
+    // Parser state, kept across read_pixels() calls so a row may span batches.
+    bool in_line_;
+    int line_number_;
+    int cells_in_line_;
+
+    std::vector<CsvCellError> errors_;
+    uint64_t error_count_;
+};
+
+#endif // CSV_SOURCE_H
@@ -1,24 +1,59 @@
 #include "data_generator.h"
+#include "cpu_time.h"
+#include <algorithm> // For std::max
 #include <vector>
 #include <iostream> // For std::cout, std::cerr
 
 DataGenerator::DataGenerator(
-    BlockingQueue<std::pair<uint8_t, uint8_t>>& output_queue,
+    PipelineQueue<std::pair<uint8_t, uint8_t>>& output_queue,
     int m,
     long long t_ns,
-    const std::string& csv_filepath)
-    : output_queue_(output_queue),
+    const std::string& csv_filepath,
+    const PrefetchConfig& prefetch,
+    long long shm_wait_ms)
+    : DataGenerator(&output_queue, nullptr, nullptr, m, t_ns, csv_filepath, prefetch, shm_wait_ms) {}
+
+DataGenerator::DataGenerator(
+    PipelineQueue<PixelBatch*>& output_queue,
+    BatchPool& batch_pool,
+    int m,
+    long long t_ns,
+    const std::string& csv_filepath,
+    const PrefetchConfig& prefetch,
+    long long shm_wait_ms)
+    : DataGenerator(nullptr, &output_queue, &batch_pool, m, t_ns, csv_filepath, prefetch, shm_wait_ms) {}
+
+DataGenerator::DataGenerator(
+    PipelineQueue<std::pair<uint8_t, uint8_t>>* pair_queue,
+    PipelineQueue<PixelBatch*>* batch_queue,
+    BatchPool* batch_pool,
+    int m,
+    long long t_ns,
+    const std::string& csv_filepath,
+    const PrefetchConfig& prefetch,
+    long long shm_wait_ms)
+    : pair_queue_(pair_queue),
+      batch_queue_(batch_queue),
+      batch_pool_(batch_pool),
+      pixels_emitted_(0),
+      pixels_lost_(0),
+      pixel_limit_(0),
+      items_pushed_(0),
+      cpu_time_ns_(0),
+      admitting_(true),
       m_(m),
       t_ns_(t_ns),
+      pacer_(t_ns),
       csv_filepath_(csv_filepath),
       use_csv_mode_(!csv_filepath.empty()),
       running_(true),
-      random_engine_(std::random_device{}()), // Seed with a real random device
-      uint8_distribution_(0, 255),
-      current_row_idx_(0),
-      line_number_(0) {
+      csv_source_(m),
+      prefetch_config_(prefetch),
+      shm_wait_ms_(shm_wait_ms),
+      source_open_(false) {
     if (use_csv_mode_) {
-        if (!open_csv()) {
+        source_open_ = open_csv();
+        if (!source_open_) {
             // Error opening CSV, could throw or switch to random mode.
             // For now, let's print an error and it will likely fail in run() or do nothing.
             std::cerr << "Error: Could not open CSV file: " << csv_filepath_ << std::endl;
@@ -28,141 +63,305 @@ DataGenerator::DataGenerator(
     }
 }
 
+void DataGenerator::set_pacing(const PacerConfig& config) {
+    pacer_ = Pacer(t_ns_, config);
+}
+
+void DataGenerator::set_random_engine(RandomEngine engine) {
+    random_source_.set_engine(engine);
+}
+
+void DataGenerator::set_synthetic(const SyntheticConfig& config, int width) {
+    synthetic_ = std::make_unique<SyntheticSource>(random_source_, width, config);
+}
+
+void DataGenerator::set_seed(uint64_t seed, uint64_t stream) {
+    random_source_.seed(seed, stream);
+}
+
 void DataGenerator::stop() {
-    running_ = false;
-    // Note: If the run loop is blocked on queue push (if queue had max size)
-    // or sleep, this flag alone might not be immediate.
-    // For this problem, queue push is unlikely to block indefinitely.
-    // If CSV is open, it should be closed.
-    if (csv_file_stream_.is_open()) {
-        csv_file_stream_.close();
+    // Only the flag is touched here, so stop() is safe from any thread. The
+    // run loop sees it before its next iteration, then closes the CSV file and
+    // the queue itself.
+    running_.store(false, std::memory_order_relaxed);
+    if (shm_) {
+        shm_->interrupt(); // Blocked in a read waiting for the publisher
     }
 }
 
 bool DataGenerator::open_csv() {
-    if (!csv_filepath_.empty()) {
-        csv_file_stream_.open(csv_filepath_);
-        if (!csv_file_stream_.is_open()) {
-            return false; // Failed to open
+    if (csv_filepath_.empty()) {
+        return false; // No CSV path provided
+    }
+    std::string shm_name;
+    if (parse_shm_source(csv_filepath_, shm_name)) {
+        shm_ = std::make_unique<ShmRing>();
+        if (!shm_->attach(shm_name, shm_wait_ms_)) {
+            shm_.reset();
+            return false;
+        }
+        if (shm_->m() != m_) {
+            std::cerr << "ShmRing Warning: " << shm_name << " is published with m = " << shm_->m()
+                      << ", reading it with m = " << m_ << "." << std::endl;
         }
         return true;
     }
-    return false; // No CSV path provided
+    if (ScanReader::is_scan_file(csv_filepath_)) {
+        replay_ = std::make_unique<ScanReader>();
+        replay_->set_prefetch(prefetch_config_);
+        return replay_->open(csv_filepath_);
+    }
+    csv_source_.set_prefetch(prefetch_config_);
+    return csv_source_.open(csv_filepath_); // False if the file cannot be opened
+}
+
+void DataGenerator::report_prefetch() const {
+    const PrefetchReader* prefetch = replay_ ? replay_->prefetch() : csv_source_.prefetch();
+    if (prefetch) {
+        std::cout << "DataGenerator: Read-ahead " << prefetch->chunks_read() << " chunks, "
+                  << prefetch->stalls() << " waits for the disk, slowest read "
+                  << prefetch->max_read_ns() / 1000 << "us" << std::endl;
+    }
+}
+
+void DataGenerator::record(const uint8_t* pixels, size_t count) {
+    if (recorder_) {
+        recorder_->write(pixels, count);
+    }
+}
+
+size_t DataGenerator::next_batch_size(size_t capacity) const {
+    if (pixel_limit_ > 0 && pixel_limit_ - pixels_emitted_ < capacity) {
+        return static_cast<size_t>(pixel_limit_ - pixels_emitted_);
+    }
+    return capacity;
+}
+
+bool DataGenerator::limit_reached() const {
+    return pixel_limit_ > 0 && pixels_emitted_ >= pixel_limit_;
+}
+
+bool DataGenerator::admit(size_t count) {
+    // Counts the item as shed when it is not to be pushed.
+    if (!backpressure_.enabled()) {
+        return true;
+    }
+    if (m_ <= 0 || stream_index() % static_cast<uint64_t>(m_) == 0) {
+        admitting_ = backpressure_.admit_line();
+    }
+    if (!admitting_) {
+        backpressure_.record_shed(count);
+    }
+    return admitting_;
+}
+
+void DataGenerator::throttle() {
+    // Hold the source until the filter has caught up to the low watermark,
+    // then start a fresh schedule instead of bursting to catch up.
+    auto start = std::chrono::steady_clock::now();
+    auto step = std::chrono::nanoseconds(std::max(t_ns_, 20000LL));
+    for (;;) {
+        size_t depth = batch_queue_ ? batch_queue_->size() : pair_queue_->size();
+        if (backpressure_.drained(depth) || !running_.load(std::memory_order_relaxed)) {
+            backpressure_.observe(depth);
+            break;
+        }
+        std::this_thread::sleep_for(step);
+    }
+    backpressure_.record_throttle(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count());
+    pacer_.reset();
 }
 
 void DataGenerator::generate_random_pair() {
-    uint8_t val1 = static_cast<uint8_t>(uint8_distribution_(random_engine_));
-    uint8_t val2 = static_cast<uint8_t>(uint8_distribution_(random_engine_));
-    output_queue_.push({val1, val2});
+    uint8_t val1 = synthetic_ ? synthetic_->next() : random_source_.next();
+    uint8_t val2 = synthetic_ ? synthetic_->next() : random_source_.next();
+    if (admit(2)) {
+        if (recorder_) {
+            const uint8_t values[2] = {val1, val2};
+            record(values, 2);
+        }
+        pair_queue_->push({val1, val2});
+        ++items_pushed_;
+    }
+    pixels_emitted_ += 2;
     // std::cout << "Generated: (" << (int)val1 << ", " << (int)val2 << ")" << std::endl;
 }
 
+void DataGenerator::generate_random_batch() {
+    PixelBatch* batch = batch_pool_->acquire();
+    batch->size = next_batch_size(batch->capacity);
+    if (synthetic_) {
+        synthetic_->fill(batch->data, batch->size);
+    } else {
+        random_source_.fill(batch->data, batch->size);
+    }
+    if (!admit(batch->size)) {
+        pixels_emitted_ += batch->size;
+        batch_pool_->release(batch);
+        return;
+    }
+    record(batch->data, batch->size);
+    batch->first_index = stream_index();
+    batch->created_ns = metrics_now_ns(); // Start of the end-to-end latency
+    pixels_emitted_ += batch->size;
+    ++items_pushed_;
+    batch_queue_->push(batch);
+}
+
+size_t DataGenerator::read_shm(uint8_t* out, size_t count) {
+    // Keep the stream index in step with the publisher across dropped slots.
+    // A read stops short of a gap, so the lost pixels all precede out[0].
+    uint64_t lost = shm_->lost_pixels();
+    size_t read = shm_->read_pixels(out, count);
+    pixels_lost_ += shm_->lost_pixels() - lost;
+    return read;
+}
+
 bool DataGenerator::read_csv_pair() {
-    if (!csv_file_stream_.is_open() && !open_csv()) {
-        std::cerr << "CSV Error: File stream not open and cannot be reopened." << std::endl;
+    if (!replay_ && !shm_ && !csv_source_.is_open()) {
+        std::cerr << "CSV Error: CSV source is not open." << std::endl;
         return false; // Cannot proceed
     }
 
-    // Fill the buffer if it has less than 2 elements
-    while (csv_buffer_.size() < 2) {
-        // Try to read more from the current row
-        if (current_row_idx_ < current_row_values_.size()) {
-            csv_buffer_.push_back(current_row_values_[current_row_idx_++]);
-        } else {
-            // Current row is exhausted, try to read a new line from CSV
-            std::string line;
-            if (std::getline(csv_file_stream_, line)) {
-                line_number_++;
-                current_row_values_.clear();
-                current_row_idx_ = 0;
-                std::stringstream ss(line);
-                std::string cell;
-                int count = 0;
-                while (std::getline(ss, cell, ',')) {
-                    if (count < m_ || m_ <= 0) { // Respect m if m > 0
-                        try {
-                            current_row_values_.push_back(static_cast<uint8_t>(std::stoi(cell)));
-                        } catch (const std::invalid_argument& ia) {
-                            std::cerr << "CSV Error: Invalid argument in CSV line " << line_number_ << ": " << cell << std::endl;
-                            // Skip malformed cell
-                        } catch (const std::out_of_range& oor) {
-                            std::cerr << "CSV Error: Out of range in CSV line " << line_number_ << ": " << cell << std::endl;
-                            // Skip malformed cell
-                        }
-                    }
-                    count++;
-                }
-                if (m_ > 0 && count < m_) {
-                     std::cerr << "CSV Warning: Line " << line_number_ << " has fewer than m=" << m_ << " columns. (" << count << ")" << std::endl;
-                }
-
-
-                // After reading a new line, try to fill the buffer again from this new line
-                if (current_row_idx_ < current_row_values_.size()) {
-                     csv_buffer_.push_back(current_row_values_[current_row_idx_++]);
-                } else if (csv_file_stream_.eof() && current_row_values_.empty()) {
-                    // No more data in the file and current_row_values is also empty
-                    break;
-                }
-
-            } else {
-                // EOF or error reading line
-                break;
-            }
+    uint8_t values[2];
+    size_t count = replay_ ? replay_->read_pixels(values, 2)
+                 : shm_    ? read_shm(values, 2)
+                           : csv_source_.read_pixels(values, 2);
+    if (count == 2) {
+        if (admit(2)) {
+            record(values, 2);
+            pair_queue_->push({values[0], values[1]});
+            ++items_pushed_;
         }
-    }
-
-    if (csv_buffer_.size() >= 2) {
-        uint8_t val1 = csv_buffer_[0];
-        uint8_t val2 = csv_buffer_[1];
-        csv_buffer_.erase(csv_buffer_.begin(), csv_buffer_.begin() + 2); // Remove the two used elements
-        output_queue_.push({val1, val2});
-        // std::cout << "CSV Read: (" << (int)val1 << ", " << (int)val2 << ")" << std::endl;
+        pixels_emitted_ += 2;
+        // std::cout << "CSV Read: (" << (int)values[0] << ", " << (int)values[1] << ")" << std::endl;
         return true;
-    } else if (!csv_buffer_.empty() && (csv_file_stream_.eof() && current_row_idx_ >= current_row_values_.size())) {
+    } else if (count == 1) {
         // Handle the case where only one element is left at the end of the file
         // The problem asks for pairs. This design will discard the last single element.
         // Alternatively, it could pad with a zero or send a special marker.
         // For now, we only send full pairs.
-        std::cerr << "CSV Info: End of file reached. One element (" << (int)csv_buffer_[0] << ") left in buffer, discarded as pairs are required." << std::endl;
-        csv_buffer_.clear();
-        return false; // No full pair to send
+        std::cerr << "CSV Info: End of file reached. One element (" << (int)values[0] << ") left in buffer, discarded as pairs are required." << std::endl;
+    }
+
+    return false; // No pair was read (EOF)
+}
+
+bool DataGenerator::read_csv_batch() {
+    if (!replay_ && !shm_ && !csv_source_.is_open()) {
+        std::cerr << "CSV Error: CSV source is not open." << std::endl;
+        return false; // Cannot proceed
     }
 
-    return false; // No pair was read (either EOF or not enough elements for a pair)
+    // Parse straight into the batch. Rows are consumed consecutively, so with
+    // batch size == m and complete rows every batch is exactly one scan line.
+    PixelBatch* batch = batch_pool_->acquire();
+    size_t wanted = next_batch_size(batch->capacity);
+    if (replay_ && replay_->zero_copy()) {
+        // The batch points straight into the mapped recording; the pool gives
+        // it its own storage back on the next acquire().
+        batch->size = replay_->next_span(batch->data, wanted);
+    } else if (replay_) {
+        batch->size = replay_->read_pixels(batch->data, wanted);
+    } else if (shm_) {
+        batch->size = read_shm(batch->data, wanted);
+    } else {
+        batch->size = csv_source_.read_pixels(batch->data, wanted);
+    }
+
+    if (batch->size == 0) {
+        batch_pool_->release(batch);
+        return false; // No data left
+    }
+    if (!admit(batch->size)) {
+        pixels_emitted_ += batch->size;
+        batch_pool_->release(batch);
+        return true;
+    }
+    // A short final batch is sent as-is; unlike the pair mode, no element is discarded.
+    record(batch->data, batch->size);
+    batch->first_index = stream_index();
+    batch->created_ns = metrics_now_ns(); // Start of the end-to-end latency
+    pixels_emitted_ += batch->size;
+    ++items_pushed_;
+    batch_queue_->push(batch);
+    return true;
 }
 
 
 void DataGenerator::run() {
-    if (use_csv_mode_ && !csv_file_stream_.is_open()) {
+    long long cpu_start = thread_cpu_time_ns();
+    if (use_csv_mode_ && !csv_source_.is_open() && !(replay_ && replay_->is_open()) && !shm_) {
         std::cerr << "DataGenerator: CSV mode selected but file not open. Exiting run loop." << std::endl;
-        running_ = false; // Ensure it stops
+        stop(); // Ensure it stops
     }
 
-    while (running_) {
+    SteadyStateScope steady_state;
+    while (running_.load(std::memory_order_relaxed)) {
+        metrics_.enter_busy();
         if (use_csv_mode_) {
-            if (!read_csv_pair()) {
+            bool sent = batch_queue_ ? read_csv_batch() : read_csv_pair();
+            if (!sent) {
                 // End of CSV file or error
                 std::cout << "DataGenerator: End of CSV data or error reading file." << std::endl;
                 stop(); // Signal to stop
             }
+        } else if (batch_queue_) {
+            generate_random_batch();
         } else {
             generate_random_pair();
         }
 
-        if (running_) { // Check running_ again in case stop() was called by read_csv_pair
-             // Ensure the loop iteration takes at least t_ns
-            std::this_thread::sleep_for(std::chrono::nanoseconds(t_ns_));
+        if (running_.load(std::memory_order_relaxed) && limit_reached()) {
+            std::cout << "DataGenerator: Pixel limit of " << pixel_limit_ << " reached." << std::endl;
+            stop();
+        }
+
+        metrics_.items.set(items_pushed_);
+        metrics_.pixels.set(pixels_emitted_);
+        if (batch_queue_) {
+            queue_depth_.sample(*batch_queue_);
+        } else {
+            queue_depth_.sample(*pair_queue_);
+        }
+        if (backpressure_.enabled()) {
+            backpressure_.observe(batch_queue_ ? batch_queue_->size() : pair_queue_->size());
         }
+        metrics_.enter_idle();
+
+        if (backpressure_.should_throttle() && running_.load(std::memory_order_relaxed)) {
+            throttle();
+        }
+
+        if (running_.load(std::memory_order_relaxed)) { // Check running_ again in case stop() was called by read_csv_pair
+            // Wait for the next absolute deadline, so iterations start T apart
+            // no matter how long generating or pushing took.
+            if (!pacer_.wait()) {
+                metrics_.deadline_misses.add(1);
+            }
+        }
+        steady_state.tick();
     }
+    steady_state.leave();
 
-    if (csv_file_stream_.is_open()) {
-        csv_file_stream_.close();
+    report_prefetch();
+    if (csv_source_.is_open()) {
+        if (csv_source_.error_count() > 0) {
+            std::cerr << "CSV Info: " << csv_source_.error_count() << " malformed cell(s) skipped." << std::endl;
+        }
+        csv_source_.close();
+    }
+    // A replayed recording stays mapped until the generator is destroyed:
+    // zero-copy batches still in the queue point into it.
+    // Signal end of data: the consumer drains what is queued, then its pop()
+    // reports the queue closed. This happens after the last push, on this thread.
+    if (batch_queue_) {
+        batch_queue_->close();
+    } else {
+        pair_queue_->close();
     }
-    // Signal end of data if necessary, e.g. by pushing a special pair.
-    // For this problem, the consumer will just stop when the queue is empty and
-    // the producer has finished. Or, for continuous random, it runs indefinitely.
-    // If it was CSV mode, we can push a "poison pill" or rely on filter knowing producer is done.
-    // For now, we won't push a poison pill. Filter will try to pop and eventually block or main will terminate threads.
+    cpu_time_ns_ = thread_cpu_time_ns() - cpu_start;
+    std::cout << "DataGenerator: " << pacer_.summary() << std::endl;
     std::cout << "DataGenerator: Exiting run loop." << std::endl;
 }
@@ -1,7 +1,19 @@
 #ifndef DATA_GENERATOR_H
 #define DATA_GENERATOR_H
 
-#include "blocking_queue.h"
+#include "pipeline_queue.h"
+#include "pixel_batch.h"
+#include "pacer.h"
+#include "backpressure.h"
+#include "csv_source.h"
+#include "scan_file.h"
+#include "shm_ring.h"
+#include "metrics.h"
+#include "alloc_check.h"
+#include "random_source.h"
+#include "synthetic_source.h"
+#include <memory>
+#include <atomic>
 #include <string>
 #include <vector>
 #include <cstdint> // For uint8_t
@@ -9,49 +21,165 @@
 #include <thread>    // For std::this_thread
 #include <chrono>    // For std::chrono
 #include <random>    // For random number generation
-#include <fstream>   // For file operations
-#include <sstream>   // For string stream operations
 #include <iostream>  // For std::cerr
 
 // Forward declaration if DataGenerator needs to be a friend of another class, not needed here.
 
 class DataGenerator {
 public:
-    DataGenerator(BlockingQueue<std::pair<uint8_t, uint8_t>>& output_queue,
+    // Pair transport: pushes two consecutive elements per message.
+    //
+    // With a prefetch depth, the input file (CSV or scan recording) is read
+    // ahead on an I/O thread, so the paced loop never waits for the disk.
+    // Replays then copy out of the read-ahead chunks instead of mapping the file.
+    // A "shm:<name>" source waits up to shm_wait_ms for its publisher.
+    DataGenerator(PipelineQueue<std::pair<uint8_t, uint8_t>>& output_queue,
                   int m,
                   long long t_ns, // Process time T in nanoseconds
-                  const std::string& csv_filepath = "");
+                  const std::string& csv_filepath = "",
+                  const PrefetchConfig& prefetch = PrefetchConfig(),
+                  long long shm_wait_ms = SHM_ATTACH_WAIT_MS);
+
+    // Batch transport: pushes spans of up to batch_pool.batch_capacity() pixels
+    // taken from batch_pool. One batch is pushed every T.
+    DataGenerator(PipelineQueue<PixelBatch*>& output_queue,
+                  BatchPool& batch_pool,
+                  int m,
+                  long long t_ns,
+                  const std::string& csv_filepath = "",
+                  const PrefetchConfig& prefetch = PrefetchConfig(),
+                  long long shm_wait_ms = SHM_ATTACH_WAIT_MS);
 
     // The main loop for the data generator, to be run in a thread.
     void run();
 
-    // Signal to stop the generator.
+    // Signal to stop the generator; safe to call from any thread. run() then
+    // returns after its current iteration and closes the queue.
     void stop();
 
+    // Choose how iterations are spaced T apart (default: hybrid sleep-then-spin
+    // against absolute deadlines). Call before run().
+    void set_pacing(const PacerConfig& config);
+    const Pacer& pacer() const { return pacer_; }
+
+    // Pick the random generator (default mt19937, seeded from std::random_device).
+    // Call before set_seed() and run().
+    void set_random_engine(RandomEngine engine);
+    const RandomPixelSource& random_source() const { return random_source_; }
+
+    // Replace uniform random data with a synthetic web: rows of width pixels,
+    // a noisy background and rare defect blobs. Draws its randomness from the
+    // random source, so set_seed() makes it reproducible. Call before run().
+    void set_synthetic(const SyntheticConfig& config, int width);
+    const SyntheticSource* synthetic() const { return synthetic_.get(); }
+
+    // Reseed the random source for reproducible runs. With xoshiro, stream k
+    // gives a sequence that does not overlap the other streams of the same
+    // seed (one per lane). Call before run().
+    void set_seed(uint64_t seed, uint64_t stream = 0);
+
+    const PrefetchConfig& prefetch_config() const { return prefetch_config_; }
+
+    // Also write every pixel pushed to recorder (must outlive run(); the caller
+    // opens and closes it). Call before run().
+    void set_recorder(ScanWriter* recorder) { recorder_ = recorder; }
+
+    // Header of the scan file being replayed, or nullptr when the input is CSV
+    // (or random). A path given as CSV is replayed when it starts with the scan
+    // file magic.
+    const ScanHeader* replay_header() const { return replay_ ? &replay_->header() : nullptr; }
+    bool replay_zero_copy() const { return replay_ && replay_->zero_copy(); }
+
+    // The shared-memory ring being read, or nullptr. A path "shm:<name>"
+    // takes its pixels from another process publishing the ring <name>; it
+    // arrives paced by the publisher and ends when the publisher closes it.
+    // Pixels the publisher dropped are skipped in the stream index.
+    const ShmRing* shm_source() const { return shm_.get(); }
+
+    // The input file or ring could not be opened; run() then pushes nothing.
+    bool source_failed() const { return use_csv_mode_ && !source_open_; }
+
+    // Stop after pixel_limit pixels have been pushed (0 = no limit). The last
+    // batch is shortened to land exactly on the limit. Call before run().
+    void set_pixel_limit(uint64_t pixel_limit) { pixel_limit_ = pixel_limit; }
+
+    // React to the output queue filling up (default: never). Shed lines are
+    // still generated or read, so the source keeps its pace and the stream
+    // index advances, but they are neither pushed nor recorded. A line is
+    // decided where an item starts on a line boundary (every item without
+    // m), so only whole lines are dropped when the batch size divides m or is
+    // a multiple of it. The kept batches keep their stream index, and the
+    // filter restarts at the gap. Call before run().
+    void set_backpressure(const BackpressureConfig& config) { backpressure_.configure(config); }
+    const BackpressureController& backpressure() const { return backpressure_; }
+
+    // Counters for benchmark reporting; read them after the thread has joined.
+    uint64_t pixels_emitted() const { return pixels_emitted_; }
+    uint64_t items_pushed() const { return items_pushed_; }
+    long long cpu_time_ns() const { return cpu_time_ns_; } // Thread CPU time spent in run()
+
+    // Live instrumentation (empty when built with STATS=0); safe to read while running.
+    const StageMetrics& metrics() const { return metrics_; }
+    const QueueDepthGauge& queue_depth() const { return queue_depth_; } // Sampled after each push
+
 private:
+    // Shared constructor body for both transports; exactly one queue is non-null.
+    DataGenerator(PipelineQueue<std::pair<uint8_t, uint8_t>>* pair_queue,
+                  PipelineQueue<PixelBatch*>* batch_queue,
+                  BatchPool* batch_pool,
+                  int m,
+                  long long t_ns,
+                  const std::string& csv_filepath,
+                  const PrefetchConfig& prefetch,
+                  long long shm_wait_ms);
+
     void generate_random_pair();
     bool read_csv_pair();
+    void generate_random_batch();
+    bool read_csv_batch();
+    size_t read_shm(uint8_t* out, size_t count);
     bool open_csv();
+    void report_prefetch() const;
+    void record(const uint8_t* pixels, size_t count);
+    size_t next_batch_size(size_t capacity) const;
+    bool limit_reached() const;
+    bool admit(size_t count);
+    void throttle();
+    uint64_t stream_index() const { return pixels_emitted_ + pixels_lost_; } // Of the next pixel
 
-    BlockingQueue<std::pair<uint8_t, uint8_t>>& output_queue_;
+    PipelineQueue<std::pair<uint8_t, uint8_t>>* pair_queue_;  // Set in pair transport
+    PipelineQueue<PixelBatch*>* batch_queue_;                // Set in batch transport
+    BatchPool* batch_pool_;
+    uint64_t pixels_emitted_; // Pixels generated or read (shed ones included)
+    uint64_t pixels_lost_;    // Skipped in the stream index: dropped by a shm publisher
+    uint64_t pixel_limit_;    // 0 = unlimited
+    uint64_t items_pushed_;   // Pairs or batches pushed to the queue
+    long long cpu_time_ns_;
+    StageMetrics metrics_;
+    QueueDepthGauge queue_depth_;
+    BackpressureController backpressure_;
+    bool admitting_; // Decision for the line in progress
     int m_; // Number of columns, relevant for CSV structure
     long long t_ns_; // Process time T in nanoseconds
+    Pacer pacer_;    // Spaces iterations T apart
     std::string csv_filepath_;
     bool use_csv_mode_;
-    bool running_;
+    std::atomic<bool> running_; // Stop token, cleared by stop()
 
     // For random number generation
-    std::mt19937 random_engine_;
-    std::uniform_int_distribution<int> uint8_distribution_;
-
-    // For CSV reading
-    std::ifstream csv_file_stream_;
-    std::vector<uint8_t> current_row_values_;
-    size_t current_row_idx_;
-    int line_number_; // For error reporting
+    RandomPixelSource random_source_;
+    std::unique_ptr<SyntheticSource> synthetic_; // Set: synthetic data instead of uniform noise
 
-    // Buffer for holding elements when reading CSV to form pairs
-    std::vector<uint8_t> csv_buffer_;
+    // For CSV reading (memory-mapped, parses straight into the outgoing buffers)
+    CsvSource csv_source_;
+    // Set when the input file is a binary scan recording instead of CSV
+    std::unique_ptr<ScanReader> replay_;
+    // Set when the input is a shared-memory ring ("shm:<name>")
+    std::unique_ptr<ShmRing> shm_;
+    PrefetchConfig prefetch_config_; // Applied by open_csv()
+    long long shm_wait_ms_;          // Used by open_csv()
+    bool source_open_;
+    ScanWriter* recorder_ = nullptr;
 };
 
 #endif // DATA_GENERATOR_H
@@ -0,0 +1,560 @@
+#include "filter_kernel.h"
+#include <cfloat>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define FILTER_KERNEL_X86 1
+#elif defined(__aarch64__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define FILTER_KERNEL_NEON 1
+#endif
+
+// NOTE: this file must be compiled without floating-point contraction
+// (-ffp-contract=off, see the Makefile) so the scalar loop is not turned into
+// FMAs and stays bit-identical to the vector paths.
+
+void filter9_symmetric_scalar(const uint8_t* in, size_t count, const float taps[5], float* out) {
+    for (size_t i = 0; i < count; ++i) {
+        float acc = static_cast<float>(in[i] + in[i + 8]) * taps[0];
+        acc = acc + static_cast<float>(in[i + 1] + in[i + 7]) * taps[1];
+        acc = acc + static_cast<float>(in[i + 2] + in[i + 6]) * taps[2];
+        acc = acc + static_cast<float>(in[i + 3] + in[i + 5]) * taps[3];
+        acc = acc + static_cast<float>(in[i + 4]) * taps[4];
+        out[i] = acc;
+    }
+}
+
+void filter9_symmetric_i16_scalar(const uint8_t* in, size_t count, const int16_t taps[5], int16_t* out) {
+    for (size_t i = 0; i < count; ++i) {
+        int acc = (in[i] + in[i + 8]) * taps[0];
+        acc += (in[i + 1] + in[i + 7]) * taps[1];
+        acc += (in[i + 2] + in[i + 6]) * taps[2];
+        acc += (in[i + 3] + in[i + 5]) * taps[3];
+        acc += in[i + 4] * taps[4];
+        out[i] = static_cast<int16_t>(acc);
+    }
+}
+
+bool make_fixed_point_window(const std::vector<double>& window,
+                             FixedPointWindow& fixed,
+                             int max_denominator) {
+    const double tolerance = 1e-9;
+    for (int denominator = 1; denominator <= max_denominator; ++denominator) {
+        std::vector<int16_t> taps;
+        long long magnitude = 0;
+        double deviation = 0.0;
+        bool exact = true;
+        for (double coefficient : window) {
+            double scaled = coefficient * denominator;
+            double rounded = std::round(scaled);
+            if (std::fabs(scaled - rounded) > tolerance * std::fmax(1.0, std::fabs(scaled))) {
+                exact = false;
+                break;
+            }
+            deviation += std::fabs(scaled - rounded);
+            magnitude += std::llabs(static_cast<long long>(rounded));
+            if (255 * magnitude > 32767) {
+                exact = false;
+                break;
+            }
+            taps.push_back(static_cast<int16_t>(rounded));
+        }
+        if (exact) {
+            fixed.taps = taps;
+            fixed.denominator = denominator;
+            fixed.max_error = 255.0 * deviation;
+            return true;
+        }
+    }
+    return false;
+}
+
+namespace {
+
+#if defined(FILTER_KERNEL_X86)
+
+__attribute__((target("avx2")))
+inline __m256 widen_to_float_avx2(__m128i pair_sums) {
+    return _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(pair_sums));
+}
+
+// 16 outputs per iteration: uint8 -> int16 in one 256-bit register per tap.
+__attribute__((target("avx2")))
+void filter9_symmetric_avx2(const uint8_t* in, size_t count, const float taps[5], float* out) {
+    const __m256 c0 = _mm256_set1_ps(taps[0]);
+    const __m256 c1 = _mm256_set1_ps(taps[1]);
+    const __m256 c2 = _mm256_set1_ps(taps[2]);
+    const __m256 c3 = _mm256_set1_ps(taps[3]);
+    const __m256 c4 = _mm256_set1_ps(taps[4]);
+
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m256i w[9];
+        for (int k = 0; k < 9; ++k) {
+            w[k] = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i + k)));
+        }
+        // Symmetric taps: add mirrored pixels first, so 5 multiplies instead of 9.
+        const __m256i p0 = _mm256_add_epi16(w[0], w[8]);
+        const __m256i p1 = _mm256_add_epi16(w[1], w[7]);
+        const __m256i p2 = _mm256_add_epi16(w[2], w[6]);
+        const __m256i p3 = _mm256_add_epi16(w[3], w[5]);
+        const __m256i p4 = w[4];
+
+        for (int half = 0; half < 2; ++half) {
+            const __m128i q0 = half ? _mm256_extracti128_si256(p0, 1) : _mm256_castsi256_si128(p0);
+            const __m128i q1 = half ? _mm256_extracti128_si256(p1, 1) : _mm256_castsi256_si128(p1);
+            const __m128i q2 = half ? _mm256_extracti128_si256(p2, 1) : _mm256_castsi256_si128(p2);
+            const __m128i q3 = half ? _mm256_extracti128_si256(p3, 1) : _mm256_castsi256_si128(p3);
+            const __m128i q4 = half ? _mm256_extracti128_si256(p4, 1) : _mm256_castsi256_si128(p4);
+            __m256 acc = _mm256_mul_ps(widen_to_float_avx2(q0), c0);
+            acc = _mm256_add_ps(acc, _mm256_mul_ps(widen_to_float_avx2(q1), c1));
+            acc = _mm256_add_ps(acc, _mm256_mul_ps(widen_to_float_avx2(q2), c2));
+            acc = _mm256_add_ps(acc, _mm256_mul_ps(widen_to_float_avx2(q3), c3));
+            acc = _mm256_add_ps(acc, _mm256_mul_ps(widen_to_float_avx2(q4), c4));
+            _mm256_storeu_ps(out + i + 8 * half, acc);
+        }
+    }
+    filter9_symmetric_scalar(in + i, count - i, taps, out + i);
+}
+
+// 8 outputs per iteration.
+__attribute__((target("sse4.1")))
+void filter9_symmetric_sse41(const uint8_t* in, size_t count, const float taps[5], float* out) {
+    const __m128 c0 = _mm_set1_ps(taps[0]);
+    const __m128 c1 = _mm_set1_ps(taps[1]);
+    const __m128 c2 = _mm_set1_ps(taps[2]);
+    const __m128 c3 = _mm_set1_ps(taps[3]);
+    const __m128 c4 = _mm_set1_ps(taps[4]);
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i w[9];
+        for (int k = 0; k < 9; ++k) {
+            w[k] = _mm_cvtepu8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(in + i + k)));
+        }
+        const __m128i p[5] = {
+            _mm_add_epi16(w[0], w[8]),
+            _mm_add_epi16(w[1], w[7]),
+            _mm_add_epi16(w[2], w[6]),
+            _mm_add_epi16(w[3], w[5]),
+            w[4]
+        };
+        const __m128 c[5] = {c0, c1, c2, c3, c4};
+
+        for (int half = 0; half < 2; ++half) {
+            __m128 acc = _mm_setzero_ps();
+            for (int k = 0; k < 5; ++k) {
+                const __m128i lanes = half ? _mm_srli_si128(p[k], 8) : p[k];
+                const __m128 value = _mm_cvtepi32_ps(_mm_cvtepi16_epi32(lanes));
+                const __m128 term = _mm_mul_ps(value, c[k]);
+                acc = (k == 0) ? term : _mm_add_ps(acc, term);
+            }
+            _mm_storeu_ps(out + i + 4 * half, acc);
+        }
+    }
+    filter9_symmetric_scalar(in + i, count - i, taps, out + i);
+}
+
+// 16 outputs per iteration, all in int16 lanes.
+__attribute__((target("avx2")))
+void filter9_symmetric_i16_avx2(const uint8_t* in, size_t count, const int16_t taps[5], int16_t* out) {
+    __m256i c[5];
+    for (int k = 0; k < 5; ++k) {
+        c[k] = _mm256_set1_epi16(taps[k]);
+    }
+
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m256i w[9];
+        for (int k = 0; k < 9; ++k) {
+            w[k] = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i + k)));
+        }
+        __m256i acc = _mm256_mullo_epi16(_mm256_add_epi16(w[0], w[8]), c[0]);
+        acc = _mm256_add_epi16(acc, _mm256_mullo_epi16(_mm256_add_epi16(w[1], w[7]), c[1]));
+        acc = _mm256_add_epi16(acc, _mm256_mullo_epi16(_mm256_add_epi16(w[2], w[6]), c[2]));
+        acc = _mm256_add_epi16(acc, _mm256_mullo_epi16(_mm256_add_epi16(w[3], w[5]), c[3]));
+        acc = _mm256_add_epi16(acc, _mm256_mullo_epi16(w[4], c[4]));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), acc);
+    }
+    filter9_symmetric_i16_scalar(in + i, count - i, taps, out + i);
+}
+
+// 8 outputs per iteration.
+__attribute__((target("sse4.1")))
+void filter9_symmetric_i16_sse41(const uint8_t* in, size_t count, const int16_t taps[5], int16_t* out) {
+    __m128i c[5];
+    for (int k = 0; k < 5; ++k) {
+        c[k] = _mm_set1_epi16(taps[k]);
+    }
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i w[9];
+        for (int k = 0; k < 9; ++k) {
+            w[k] = _mm_cvtepu8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(in + i + k)));
+        }
+        __m128i acc = _mm_mullo_epi16(_mm_add_epi16(w[0], w[8]), c[0]);
+        acc = _mm_add_epi16(acc, _mm_mullo_epi16(_mm_add_epi16(w[1], w[7]), c[1]));
+        acc = _mm_add_epi16(acc, _mm_mullo_epi16(_mm_add_epi16(w[2], w[6]), c[2]));
+        acc = _mm_add_epi16(acc, _mm_mullo_epi16(_mm_add_epi16(w[3], w[5]), c[3]));
+        acc = _mm_add_epi16(acc, _mm_mullo_epi16(w[4], c[4]));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), acc);
+    }
+    filter9_symmetric_i16_scalar(in + i, count - i, taps, out + i);
+}
+
+#elif defined(FILTER_KERNEL_NEON)
+
+// 8 outputs per iteration.
+void filter9_symmetric_i16_neon(const uint8_t* in, size_t count, const int16_t taps[5], int16_t* out) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        uint8x8_t w[9];
+        for (int k = 0; k < 9; ++k) {
+            w[k] = vld1_u8(in + i + k);
+        }
+        int16x8_t acc = vmulq_n_s16(vreinterpretq_s16_u16(vaddl_u8(w[0], w[8])), taps[0]);
+        acc = vmlaq_n_s16(acc, vreinterpretq_s16_u16(vaddl_u8(w[1], w[7])), taps[1]);
+        acc = vmlaq_n_s16(acc, vreinterpretq_s16_u16(vaddl_u8(w[2], w[6])), taps[2]);
+        acc = vmlaq_n_s16(acc, vreinterpretq_s16_u16(vaddl_u8(w[3], w[5])), taps[3]);
+        acc = vmlaq_n_s16(acc, vreinterpretq_s16_u16(vmovl_u8(w[4])), taps[4]);
+        vst1q_s16(out + i, acc);
+    }
+    filter9_symmetric_i16_scalar(in + i, count - i, taps, out + i);
+}
+
+// 8 outputs per iteration. NEON is baseline on AArch64, so no runtime check.
+void filter9_symmetric_neon(const uint8_t* in, size_t count, const float taps[5], float* out) {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        uint8x8_t w[9];
+        for (int k = 0; k < 9; ++k) {
+            w[k] = vld1_u8(in + i + k);
+        }
+        const uint16x8_t p[5] = {
+            vaddl_u8(w[0], w[8]),
+            vaddl_u8(w[1], w[7]),
+            vaddl_u8(w[2], w[6]),
+            vaddl_u8(w[3], w[5]),
+            vmovl_u8(w[4])
+        };
+        float32x4_t lo = vdupq_n_f32(0.0f);
+        float32x4_t hi = vdupq_n_f32(0.0f);
+        for (int k = 0; k < 5; ++k) {
+            // vmulq + vaddq rather than vmlaq/vfmaq to keep the scalar rounding.
+            const float32x4_t term_lo = vmulq_n_f32(vcvtq_f32_u32(vmovl_u16(vget_low_u16(p[k]))), taps[k]);
+            const float32x4_t term_hi = vmulq_n_f32(vcvtq_f32_u32(vmovl_u16(vget_high_u16(p[k]))), taps[k]);
+            lo = (k == 0) ? term_lo : vaddq_f32(lo, term_lo);
+            hi = (k == 0) ? term_hi : vaddq_f32(hi, term_hi);
+        }
+        vst1q_f32(out + i, lo);
+        vst1q_f32(out + i + 4, hi);
+    }
+    filter9_symmetric_scalar(in + i, count - i, taps, out + i);
+}
+
+#endif
+
+using Filter9Fn = void (*)(const uint8_t*, size_t, const float*, float*);
+using Filter9I16Fn = void (*)(const uint8_t*, size_t, const int16_t*, int16_t*);
+
+struct Filter9Impl {
+    Filter9Fn fn;
+    Filter9I16Fn i16_fn;
+    const char* name;
+};
+
+Filter9Impl select_filter9() {
+#if defined(FILTER_KERNEL_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return {filter9_symmetric_avx2, filter9_symmetric_i16_avx2, "avx2"};
+    }
+    if (__builtin_cpu_supports("sse4.1")) {
+        return {filter9_symmetric_sse41, filter9_symmetric_i16_sse41, "sse4.1"};
+    }
+#elif defined(FILTER_KERNEL_NEON)
+    return {filter9_symmetric_neon, filter9_symmetric_i16_neon, "neon"};
+#endif
+    return {filter9_symmetric_scalar, filter9_symmetric_i16_scalar, "scalar"};
+}
+
+const Filter9Impl& filter9_impl() {
+    static const Filter9Impl impl = select_filter9();
+    return impl;
+}
+
+} // namespace
+
+void filter9_symmetric(const uint8_t* in, size_t count, const float taps[5], float* out) {
+    filter9_impl().fn(in, count, taps, out);
+}
+
+void filter9_symmetric_i16(const uint8_t* in, size_t count, const int16_t taps[5], int16_t* out) {
+    filter9_impl().i16_fn(in, count, taps, out);
+}
+
+const char* filter9_symmetric_isa() {
+    return filter9_impl().name;
+}
+
+// --- Kernels of any length -------------------------------------------------
+
+namespace {
+
+// N is the window length when known at compile time (the tap loops unroll
+// completely), or 0 for the generic loop over the runtime length.
+template <size_t N, bool Symmetric>
+void convolve_scalar(const uint8_t* in, size_t count, const float* taps, size_t length, float* out) {
+    const size_t n = N ? N : length;
+    const size_t pairs = n / 2;
+    for (size_t i = 0; i < count; ++i) {
+        const uint8_t* w = in + i;
+        float acc;
+        if (Symmetric) {
+            if (pairs == 0) {
+                out[i] = static_cast<float>(w[0]) * taps[0];
+                continue;
+            }
+            acc = static_cast<float>(w[0] + w[n - 1]) * taps[0];
+            for (size_t k = 1; k < pairs; ++k) {
+                acc = acc + static_cast<float>(w[k] + w[n - 1 - k]) * taps[k];
+            }
+            if (n % 2 == 1) {
+                acc = acc + static_cast<float>(w[pairs]) * taps[pairs];
+            }
+        } else {
+            acc = static_cast<float>(w[0]) * taps[0];
+            for (size_t k = 1; k < n; ++k) {
+                acc = acc + static_cast<float>(w[k]) * taps[k];
+            }
+        }
+        out[i] = acc;
+    }
+}
+
+#if defined(FILTER_KERNEL_X86)
+
+// 16 pixels at in, widened to int16.
+__attribute__((target("avx2")))
+inline __m256i load16_avx2(const uint8_t* in) {
+    return _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in)));
+}
+
+// Add term * tap to the two 8-lane float accumulators (first: acc = term * tap).
+__attribute__((target("avx2")))
+inline void accumulate_avx2(__m256i term, __m256 tap, bool first, __m256& lo, __m256& hi) {
+    const __m256 term_lo = _mm256_mul_ps(widen_to_float_avx2(_mm256_castsi256_si128(term)), tap);
+    const __m256 term_hi = _mm256_mul_ps(widen_to_float_avx2(_mm256_extracti128_si256(term, 1)), tap);
+    lo = first ? term_lo : _mm256_add_ps(lo, term_lo);
+    hi = first ? term_hi : _mm256_add_ps(hi, term_hi);
+}
+
+// Same operations as convolve_scalar, 16 outputs per iteration.
+template <size_t N, bool Symmetric>
+__attribute__((target("avx2")))
+void convolve_avx2(const uint8_t* in, size_t count, const float* taps, size_t length, float* out) {
+    const size_t n = N ? N : length;
+    const size_t pairs = n / 2;
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const uint8_t* w = in + i;
+        __m256 lo = _mm256_setzero_ps();
+        __m256 hi = _mm256_setzero_ps();
+        if (Symmetric) {
+            for (size_t k = 0; k < pairs; ++k) {
+                accumulate_avx2(_mm256_add_epi16(load16_avx2(w + k), load16_avx2(w + n - 1 - k)),
+                                _mm256_set1_ps(taps[k]), k == 0, lo, hi);
+            }
+            if (n % 2 == 1) {
+                accumulate_avx2(load16_avx2(w + pairs), _mm256_set1_ps(taps[pairs]), pairs == 0, lo, hi);
+            }
+        } else {
+            for (size_t k = 0; k < n; ++k) {
+                accumulate_avx2(load16_avx2(w + k), _mm256_set1_ps(taps[k]), k == 0, lo, hi);
+            }
+        }
+        _mm256_storeu_ps(out + i, lo);
+        _mm256_storeu_ps(out + i + 8, hi);
+    }
+    convolve_scalar<N, Symmetric>(in + i, count - i, taps, length, out + i);
+}
+
+#endif
+
+// Adapter so the original 9-tap kernel fits the general signature.
+void convolve_filter9(const uint8_t* in, size_t count, const float* taps, size_t, float* out) {
+    filter9_symmetric(in, count, taps, out);
+}
+
+bool use_avx2() {
+#if defined(FILTER_KERNEL_X86)
+    static const bool available = [] {
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") != 0;
+    }();
+    return available;
+#else
+    return false;
+#endif
+}
+
+template <size_t N, bool Symmetric>
+ConvolutionKernel::Function pick_convolution() {
+#if defined(FILTER_KERNEL_X86)
+    if (use_avx2()) {
+        return convolve_avx2<N, Symmetric>;
+    }
+#endif
+    return convolve_scalar<N, Symmetric>;
+}
+
+template <bool Symmetric>
+ConvolutionKernel::Function pick_convolution(size_t length, bool& specialized) {
+    specialized = true;
+    switch (length) {
+    case 3: return pick_convolution<3, Symmetric>();
+    case 5: return pick_convolution<5, Symmetric>();
+    case 7: return pick_convolution<7, Symmetric>();
+    case 9: return pick_convolution<9, Symmetric>();
+    case 15: return pick_convolution<15, Symmetric>();
+    default:
+        specialized = false;
+        return pick_convolution<0, Symmetric>();
+    }
+}
+
+bool parse_taps(const std::string& text, KernelSpec& spec, std::string& error) {
+    // Strip blanks, split off "@center", then read comma-separated doubles.
+    std::string compact;
+    for (char c : text) {
+        if (c != ' ' && c != '\t' && c != '\r' && c != '\n') {
+            compact += c;
+        }
+    }
+    std::string taps_text = compact;
+    bool has_center = false;
+    long center = 0;
+    size_t at = compact.find('@');
+    if (at != std::string::npos) {
+        taps_text = compact.substr(0, at);
+        std::string center_text = compact.substr(at + 1);
+        char* end = nullptr;
+        center = std::strtol(center_text.c_str(), &end, 10);
+        if (center_text.empty() || *end != '\0' || center < 0) {
+            error = "invalid center '" + center_text + "'";
+            return false;
+        }
+        has_center = true;
+    }
+    std::vector<double> taps;
+    size_t start = 0;
+    while (start <= taps_text.size()) {
+        size_t comma = taps_text.find(',', start);
+        std::string cell = taps_text.substr(start, comma == std::string::npos ? std::string::npos : comma - start);
+        char* end = nullptr;
+        double tap = std::strtod(cell.c_str(), &end);
+        if (cell.empty() || *end != '\0' || !std::isfinite(tap)) {
+            error = "invalid tap '" + cell + "'";
+            return false;
+        }
+        taps.push_back(tap);
+        if (comma == std::string::npos) {
+            break;
+        }
+        start = comma + 1;
+    }
+    if (has_center && static_cast<size_t>(center) >= taps.size()) {
+        error = "center " + std::to_string(center) + " is outside the " + std::to_string(taps.size()) + " taps";
+        return false;
+    }
+    spec.taps = taps;
+    spec.center = has_center ? static_cast<size_t>(center) : (taps.size() - 1) / 2;
+    return true;
+}
+
+} // namespace
+
+bool KernelSpec::symmetric() const {
+    for (size_t k = 0; k < taps.size() / 2; ++k) {
+        if (taps[k] != taps[taps.size() - 1 - k]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+KernelSpec default_kernel_spec() {
+    KernelSpec spec;
+    spec.taps = {0.05, 0.1, 0.15, 0.2, 0.25, 0.2, 0.15, 0.1, 0.05};
+    spec.center = 4;
+    return spec;
+}
+
+bool parse_kernel_spec(const std::string& text, KernelSpec& spec, std::string& error) {
+    return parse_taps(text, spec, error);
+}
+
+bool load_kernel_spec(const std::string& path, KernelSpec& spec, std::string& error) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        error = "cannot open " + path;
+        return false;
+    }
+    std::string text;
+    std::string line;
+    while (std::getline(file, line)) {
+        size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos || line[first] == '#') {
+            continue;
+        }
+        // Lines continue the tap list; a line break between taps counts as a comma.
+        if (!text.empty() && text.back() != ',' && line[first] != ',' && line[first] != '@') {
+            text += ',';
+        }
+        text += line;
+    }
+    if (!parse_taps(text, spec, error)) {
+        error = path + ": " + error;
+        return false;
+    }
+    return true;
+}
+
+ConvolutionKernel::ConvolutionKernel(const std::vector<double>& taps)
+    : length_(taps.size()) {
+    KernelSpec spec;
+    spec.taps = taps;
+    symmetric_ = spec.symmetric();
+    // Symmetric kernels only need the outer-to-center half.
+    size_t stored = symmetric_ ? (length_ + 1) / 2 : length_;
+    for (size_t k = 0; k < stored; ++k) {
+        taps_.push_back(static_cast<float>(taps[k]));
+    }
+    // Every loop adds its terms in one float accumulator: a symmetric window
+    // has (length + 1) / 2 of them (mirrored pixels are summed exactly), any
+    // other one length. Each term's value is at most 255 * |tap| (both taps
+    // of a pair), and it carries the rounding of its tap, its product and
+    // every later sum, so the error stays below (terms + 1) * FLT_EPSILON / 2
+    // of 255 * sum(|taps|). The bound returned is twice that.
+    double magnitude = 0.0;
+    for (double tap : taps) {
+        magnitude += std::fabs(tap);
+    }
+    error_bound_ = static_cast<double>(stored + 1) * FLT_EPSILON * 255.0 * magnitude;
+
+    const std::string isa = use_avx2() ? "avx2" : "scalar";
+    const std::string shape = std::to_string(length_) + "-tap" + (symmetric_ ? " symmetric" : "");
+    if (length_ == 9 && symmetric_) {
+        function_ = convolve_filter9;
+        description_ = "9-tap symmetric (" + std::string(filter9_symmetric_isa()) + ")";
+        return;
+    }
+    bool specialized = false;
+    function_ = symmetric_ ? pick_convolution<true>(length_, specialized)
+                           : pick_convolution<false>(length_, specialized);
+    description_ = (specialized ? "specialized " : "generic ") + shape + " (" + isa + ")";
+}
@@ -0,0 +1,126 @@
+#ifndef FILTER_KERNEL_H
+#define FILTER_KERNEL_H
+
+#include <cstdint> // For uint8_t
+#include <cstddef> // For size_t
+#include <string>
+#include <vector>
+
+// Vectorized 9-tap symmetric convolution over a contiguous block of pixels.
+//
+// taps[0..4] are the outer-to-center coefficients of a symmetric 9-tap
+// window, i.e. the full window is
+//     taps[0] taps[1] taps[2] taps[3] taps[4] taps[3] taps[2] taps[1] taps[0]
+// For every i in [0, count):
+//     out[i] = taps[0]*(in[i]   + in[i+8]) + taps[1]*(in[i+1] + in[i+7])
+//            + taps[2]*(in[i+2] + in[i+6]) + taps[3]*(in[i+3] + in[i+5])
+//            + taps[4]* in[i+4]
+// so `in` must hold count + 8 pixels and out[i] is the filtered value of the
+// pixel in[i + 4].
+//
+// Pixel pairs are added as exact integers, then converted to float and
+// accumulated left to right with separate multiplies and adds (no FMA). Every
+// implementation does exactly these operations in this order, so the SIMD
+// paths are bit-identical to the scalar fallback.
+void filter9_symmetric(const uint8_t* in, size_t count, const float taps[5], float* out);
+
+// Scalar reference implementation of filter9_symmetric (always available).
+void filter9_symmetric_scalar(const uint8_t* in, size_t count, const float taps[5], float* out);
+
+// Integer variant of filter9_symmetric with int16 taps and int16 sums
+// (twice the lanes of the float kernel). The caller guarantees that
+// 255 * sum(|taps of the full window|) fits in int16, so no lane can overflow;
+// make_fixed_point_window() checks this. Exact, so all paths agree trivially.
+void filter9_symmetric_i16(const uint8_t* in, size_t count, const int16_t taps[5], int16_t* out);
+
+// Scalar reference implementation of filter9_symmetric_i16.
+void filter9_symmetric_i16_scalar(const uint8_t* in, size_t count, const int16_t taps[5], int16_t* out);
+
+// Name of the implementation selected at runtime: "avx2", "sse4.1", "neon" or "scalar".
+const char* filter9_symmetric_isa();
+
+// A filter window of any length, as loaded from the configuration.
+//
+// taps[k] multiplies the pixel k - center positions away from the filtered
+// one, so center is the number of past pixels in the window and
+// taps.size() - 1 - center the number of future pixels.
+struct KernelSpec {
+    std::vector<double> taps;
+    size_t center = 0;
+
+    size_t size() const { return taps.size(); }
+    size_t past() const { return center; }
+    size_t future() const { return taps.size() - 1 - center; }
+    bool symmetric() const;
+};
+
+// The original window: 0.05 0.1 0.15 0.2 0.25 0.2 0.15 0.1 0.05, centered.
+KernelSpec default_kernel_spec();
+
+// Parse "t0,t1,...,tn-1" with an optional "@center" suffix (default: the
+// middle tap, (n - 1) / 2). Blanks are ignored. On failure returns false and
+// describes the problem in error.
+bool parse_kernel_spec(const std::string& text, KernelSpec& spec, std::string& error);
+
+// Read a kernel from a file holding the same syntax; blank lines and lines
+// starting with '#' are skipped, and the taps may span several lines.
+bool load_kernel_spec(const std::string& path, KernelSpec& spec, std::string& error);
+
+// Float convolution with any window, dispatched once at construction:
+//     out[i] = taps[0] * in[i] + ... + taps[n - 1] * in[i + n - 1]
+// for i in [0, count), so `in` must hold count + n - 1 pixels.
+//
+//  * 9-tap symmetric windows use filter9_symmetric (the original fast path).
+//  * 3/5/7/9/15 taps, symmetric or not, use loops instantiated for that
+//    length, so every tap loop is fully unrolled.
+//  * Any other length takes a generic loop over the runtime length.
+// The specialized and generic loops have an AVX2 version (16 outputs per
+// iteration) and a scalar one. Symmetric windows add mirrored pixels as exact
+// integers first, outer pair to center; other windows accumulate taps in
+// order. No FMA, so every implementation of a kernel gives the same bits.
+class ConvolutionKernel {
+public:
+    ConvolutionKernel() = default;
+    explicit ConvolutionKernel(const std::vector<double>& taps);
+
+    void apply(const uint8_t* in, size_t count, float* out) const {
+        function_(in, count, taps_.data(), length_, out);
+    }
+
+    size_t length() const { return length_; }
+    bool symmetric() const { return symmetric_; }
+    // "9-tap symmetric (avx2)", "specialized 5-tap (scalar)", "generic 11-tap symmetric (avx2)", ...
+    const std::string& description() const { return description_; }
+    // Bound on |out[i] - the double dot product| for any uint8 input, twice
+    // the worst case of the loop's float roundings (taps, products and sums).
+    double error_bound() const { return error_bound_; }
+
+    using Function = void (*)(const uint8_t* in, size_t count, const float* taps, size_t length, float* out);
+
+private:
+    Function function_ = nullptr;
+    std::vector<float> taps_; // Symmetric: outer-to-center half; otherwise all taps
+    size_t length_ = 0;
+    bool symmetric_ = false;
+    double error_bound_ = 0.0;
+    std::string description_;
+};
+
+// Integer form of a floating-point filter window:
+//     window[k] == taps[k] / denominator   (up to rounding of the doubles)
+struct FixedPointWindow {
+    std::vector<int16_t> taps;
+    int denominator = 1;
+    // Largest |sum(pixel[k] * window[k]) * denominator - sum(pixel[k] * taps[k])|
+    // over uint8 pixels: 255 * sum(|window[k] * denominator - taps[k]|).
+    double max_error = 0.0;
+};
+
+// Find the smallest denominator (up to max_denominator) that turns every
+// coefficient into an integer and keeps 255 * sum(|taps|) within int16.
+// Returns false if the window cannot be represented exactly that way.
+bool make_fixed_point_window(const std::vector<double>& window,
+                             FixedPointWindow& fixed,
+                             int max_denominator = 1000);
+
+#endif // FILTER_KERNEL_H
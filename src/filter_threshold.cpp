@@ -1,115 +1,840 @@
 #include "filter_threshold.h"
+#include "filter_kernel.h"
+#include "cpu_time.h"
 #include <iostream>     // For std::cout, std::cerr
 #include <vector>
 #include <numeric>      // For std::inner_product or manual sum
 #include <algorithm>    // For std::copy
 #include <iomanip>      // For std::fixed, std::setprecision
+#include <cfloat>       // For DBL_EPSILON
+#include <cmath>        // For std::ceil, std::floor
 
 // Define the static filter window
-const std::vector<double> FilterThreshold::FILTER_WINDOW = {0.05, 0.1, 0.15, 0.2, 0.25, 0.2, 0.15, 0.1, 0.05};
+const std::vector<double> FilterThreshold::FILTER_WINDOW = default_kernel_spec().taps;
 
 FilterThreshold::FilterThreshold(
-    BlockingQueue<std::pair<uint8_t, uint8_t>>& input_queue,
+    PipelineQueue<std::pair<uint8_t, uint8_t>>& input_queue,
     double tv,
-    long long t_ns,
-    bool& producer_finished_flag)
-    : input_queue_(input_queue),
+    long long t_ns)
+    : FilterThreshold(&input_queue, nullptr, nullptr, tv, t_ns) {}
+
+FilterThreshold::FilterThreshold(
+    PipelineQueue<PixelBatch*>& input_queue,
+    BatchPool& batch_pool,
+    double tv,
+    long long t_ns)
+    : FilterThreshold(nullptr, &input_queue, &batch_pool, tv, t_ns) {}
+
+FilterThreshold::FilterThreshold(
+    BatchPool& batch_pool,
+    double tv,
+    long long t_ns)
+    : FilterThreshold(nullptr, nullptr, &batch_pool, tv, t_ns) {}
+
+FilterThreshold::FilterThreshold(
+    PipelineQueue<std::pair<uint8_t, uint8_t>>* pair_queue,
+    PipelineQueue<PixelBatch*>* batch_queue,
+    BatchPool* batch_pool,
+    double tv,
+    long long t_ns)
+    : pair_queue_(pair_queue),
+      batch_queue_(batch_queue),
+      batch_pool_(batch_pool),
       threshold_value_(tv),
       t_ns_(t_ns),
+      pacer_(t_ns),
       running_(true),
-      producer_finished_flag_(producer_finished_flag) {
-    if (FILTER_WINDOW.size() != WINDOW_SIZE) {
-        // This should ideally be a compile-time check or an exception
-        std::cerr << "Error: Filter window size mismatch!" << std::endl;
-        // Potentially throw an error or set running_ to false
+      default_sink_(new TextSink(std::cout)),
+      sink_(default_sink_.get()),
+      pixels_filtered_(0),
+      defects_found_(0),
+      items_popped_(0),
+      cpu_time_ns_(0),
+      low_threshold_(tv),
+      in_defect_(false),
+      run_confirmed_(false),
+      next_index_(0),
+      window_(FILTER_WINDOW),
+      window_size_(FILTER_WINDOW.size()),
+      past_(4),
+      future_(4),
+      next_batch_index_(0),
+      index_offset_(0),
+      row_width_(0),
+      rows_received_(0),
+      first_row_(0),
+      rows_before_gaps_(0),
+      row_skip_(0),
+      chunk_size_(0),
+      engine_(FilterEngine::Reference),
+      float_kernel_(FILTER_WINDOW),
+      simd_margin_(0.0),
+      simd_clear_below_(0.0),
+      simd_defect_from_(0.0),
+      fixed_available_(false),
+      fixed_taps_{0, 0, 0, 0, 0},
+      fixed_denominator_(1),
+      fixed_error_(0.0),
+      fixed_clear_below_(0),
+      fixed_defect_from_(0),
+      windows_expected_(0) {
+    if (batch_pool_) {
+        // Room for one full batch behind the history, so steady state never reallocates.
+        data_buffer_.reserve(batch_pool_->batch_capacity() + window_size_);
+    }
+    setup_fixed_point();
+    setup_simd_band();
+}
+
+bool FilterThreshold::set_kernel(const KernelSpec& spec) {
+    if (spec.taps.empty() || spec.center >= spec.taps.size()) {
+        std::cerr << "FilterThreshold: Invalid filter kernel, keeping the " << window_size_ << "-tap window." << std::endl;
+        return false;
     }
+    window_ = spec.taps;
+    window_size_ = spec.size();
+    past_ = spec.past();
+    future_ = spec.future();
+    float_kernel_ = ConvolutionKernel(window_);
+    if (batch_pool_) {
+        data_buffer_.reserve(batch_pool_->batch_capacity() + window_size_);
+    }
+    fixed_available_ = false;
+    setup_fixed_point();
+    setup_simd_band();
+    return true;
+}
+
+void FilterThreshold::setup_fixed_point() {
+    // Precompute the integer taps and the scaled integer threshold once.
+    FixedPointWindow fixed;
+    if (window_size_ != 9 || !make_fixed_point_window(window_, fixed)) {
+        return; // The int16 kernel only exists for 9 taps
+    }
+    for (size_t i = 0; i < 4; ++i) {
+        if (fixed.taps[i] != fixed.taps[8 - i]) {
+            return; // The int16 kernel is symmetric-only
+        }
+    }
+    for (size_t i = 0; i <= 4; ++i) {
+        fixed_taps_[i] = fixed.taps[i];
+    }
+    fixed_denominator_ = fixed.denominator;
+
+    // In scaled units the double path differs from S by at most the taps'
+    // accepted rounding plus its own: 9 products and 8 sums, each rounded by
+    // DBL_EPSILON / 2 of at most 255 * sum(|window|). Only sums within twice
+    // that of TV * denominator can be decided differently.
+    double magnitude = 0.0;
+    for (double tap : window_) {
+        magnitude += std::fabs(tap);
+    }
+    double rounding = (window_size_ + 1) * DBL_EPSILON / 2.0 * 255.0 * magnitude * fixed_denominator_;
+    const double margin = 2.0 * (fixed.max_error + rounding);
+    fixed_error_ = margin / fixed_denominator_;
+    const double limit = 65536.0; // Beyond any int16 sum
+    double scaled_tv = threshold_value_ * fixed_denominator_;
+    double clear_below = std::ceil(scaled_tv - margin);
+    double defect_from = std::floor(scaled_tv + margin) + 1.0;
+    fixed_clear_below_ = static_cast<int>(std::max(-limit, std::min(limit, clear_below)));
+    fixed_defect_from_ = static_cast<int>(std::max(-limit, std::min(limit, defect_from)));
+    fixed_available_ = true;
+}
+
+void FilterThreshold::setup_simd_band() {
+    // Twice the float kernel's worst-case error, which also covers the double
+    // path's own (far smaller) one.
+    simd_margin_ = float_kernel_.error_bound();
+    simd_clear_below_ = threshold_value_ - simd_margin_;
+    simd_defect_from_ = threshold_value_ + simd_margin_;
+}
+
+void FilterThreshold::set_pacing(const PacerConfig& config) {
+    pacer_ = Pacer(t_ns_, config);
 }
 
 void FilterThreshold::stop() {
-    running_ = false;
+    running_.store(false, std::memory_order_relaxed);
+}
+
+void FilterThreshold::set_engine(FilterEngine engine) {
+    if (engine == FilterEngine::Fixed && !fixed_available_) {
+        // Not Simd: the fallback keeps the exact decisions Fixed promises.
+        std::cerr << "FilterThreshold: Filter window is not 9 symmetric taps with an exact int16 form, falling back to the reference engine." << std::endl;
+        engine_ = FilterEngine::Reference;
+        return;
+    }
+    engine_ = engine;
+}
+
+void FilterThreshold::report_result(uint8_t center_value, double filtered_value, bool defect) {
+    // Results arrive in stream order; the first window is centered on pixel past_.
+    report_result_at(past_ + pixels_filtered_ + index_offset_, center_value, filtered_value, defect);
+}
+
+void FilterThreshold::report_result_at(uint64_t index, uint8_t center_value, double filtered_value, bool defect) {
+    ++pixels_filtered_;
+    verifier_.match(index, filtered_value, defect);
+    if (hysteresis_.enabled()) {
+        apply_hysteresis(index, center_value, filtered_value, defect);
+    } else {
+        deliver(index, center_value, filtered_value, defect);
+    }
+}
+
+void FilterThreshold::deliver(uint64_t index, uint8_t center_value, double filtered_value, bool defect) {
+    sink_->write(index, center_value, filtered_value, defect);
+    defects_found_ += defect ? 1 : 0;
+}
+
+void FilterThreshold::set_hysteresis(const HysteresisConfig& config) {
+    hysteresis_ = config;
+    if (hysteresis_.band < 0.0) {
+        hysteresis_.band = 0.0;
+    }
+    low_threshold_ = threshold_value_ - hysteresis_.band;
+    pending_run_.clear();
+    pending_run_.reserve(hysteresis_.min_run);
+}
+
+void FilterThreshold::apply_hysteresis(uint64_t index, uint8_t center_value, double filtered_value, bool defect) {
+    // defect is the engine's (exact) decision against TV, the high threshold.
+    // The engines re-evaluate values near low_threshold_ with the double path,
+    // so the comparison below is exact too.
+    if (index != next_index_) {
+        flush_pending_run(false);
+        in_defect_ = false;
+    }
+    next_index_ = index + 1;
+    in_defect_ = in_defect_ ? filtered_value >= low_threshold_ : defect;
+
+    if (!in_defect_) {
+        flush_pending_run(false);
+        deliver(index, center_value, filtered_value, false);
+    } else if (run_confirmed_ || hysteresis_.min_run <= 1) {
+        deliver(index, center_value, filtered_value, true);
+    } else {
+        pending_run_.push_back(PendingResult{index, center_value, filtered_value});
+        if (pending_run_.size() >= hysteresis_.min_run) {
+            flush_pending_run(true);
+            run_confirmed_ = true;
+        }
+    }
+}
+
+void FilterThreshold::flush_pending_run(bool defect) {
+    // Hand the held-back results of the current run on, decided either way;
+    // the next defect starts a new run.
+    for (const PendingResult& result : pending_run_) {
+        deliver(result.index, result.center_value, result.filtered_value, defect);
+    }
+    pending_run_.clear();
+    run_confirmed_ = false;
 }
 
 void FilterThreshold::process_element() {
-    // This function is called when data_buffer_ has enough elements (WINDOW_SIZE)
-    // The element to be filtered is at index PAST_ELEMENTS (e.g., 4th index for 0-indexed)
-    if (data_buffer_.size() < WINDOW_SIZE) {
+    // This function is called when data_buffer_ has enough elements (window_size_)
+    // The element to be filtered is at index past_ (e.g., 4th index for 0-indexed)
+    if (data_buffer_.size() < window_size_) {
         return; // Not enough data to form a full window
     }
 
-    double filtered_value = 0.0;
-    for (size_t i = 0; i < WINDOW_SIZE; ++i) {
-        filtered_value += static_cast<double>(data_buffer_[i]) * FILTER_WINDOW[i];
-    }
+    double filtered_value = reference_filter(data_buffer_.data());
 
-    // The original element that was filtered is data_buffer_[PAST_ELEMENTS]
+    // The original element that was filtered is data_buffer_[past_]
     // We can now remove the oldest element from the buffer as it has been processed
     // (either as part of a window, or it's now past the "past elements" section for the newest center)
-    // uint8_t processed_original_element = data_buffer_[PAST_ELEMENTS]; // This is the element that was at the center
+    // uint8_t processed_original_element = data_buffer_[past_]; // This is the element that was at the center
 
     // Apply threshold
     bool defect = (filtered_value >= threshold_value_);
 
     // Output the result for the element that was at the center of this window
-    std::cout << "Filtered Output for element value " << static_cast<int>(data_buffer_[PAST_ELEMENTS])
-              << " (window center): "
-              << "Filtered val = " << std::fixed << std::setprecision(4) << filtered_value
-              << ", Thresholded = " << (defect ? "1 (Defect)" : "0 (No Defect)")
-              << std::endl;
+    report_result(data_buffer_[past_], filtered_value, defect);
 
     // Remove the oldest element from the buffer, as it's no longer needed for future windows
     // centered on subsequent elements.
-    data_buffer_.pop_front();
+    data_buffer_.consume(1);
 }
 
 
-void FilterThreshold::run() {
+// Pop the next item for run(). An empty queue parks the thread in pop()
+// until data arrives or the queue is closed; after such an idle wait the
+// pacer restarts from now instead of catching up on the deadlines it missed.
+template <typename T>
+bool FilterThreshold::next_item(PipelineQueue<T>& queue, T& item) {
+    if (!queue.try_pop(item)) {
+        if (!queue.pop(item)) {
+            return false; // Closed and drained
+        }
+        pacer_.reset();
+    }
+    metrics_.enter_busy();
+    return true;
+}
+
+bool FilterThreshold::receive_pair() {
     std::pair<uint8_t, uint8_t> received_pair;
+    if (!next_item(*pair_queue_, received_pair)) {
+        return false;
+    }
+    ++items_popped_;
+    if (row_mode()) {
+        uint8_t pixels[2] = {received_pair.first, received_pair.second};
+        append_row_pixels(pixels, 2);
+        return true;
+    }
+    data_buffer_.push_back(received_pair.first);
+    if (data_buffer_.size() >= window_size_) {
+        process_element(); // Process if window is full, oldest element at front is centered
+    }
+    data_buffer_.push_back(received_pair.second);
+    if (data_buffer_.size() >= window_size_) {
+        process_element(); // Process again if second element made window full
+    }
+    return true;
+}
+
+bool FilterThreshold::receive_batch() {
+    PixelBatch* batch = nullptr;
+    if (!next_item(*batch_queue_, batch)) {
+        return false;
+    }
+    ++items_popped_;
+    // A whole span is handled per queue operation and per T cycle.
+    process_batch(*batch);
+    batch_pool_->release(batch);
+    return true;
+}
+
+void FilterThreshold::process_batch(const PixelBatch& batch) {
+    if (batch.first_index != next_batch_index_) {
+        restart_stream(batch.first_index);
+    }
+    next_batch_index_ = batch.first_index + batch.size;
+    if (row_mode()) {
+        append_row_pixels(batch.data, batch.size);
+    } else if (worker_pool_) {
+        filter_batch_parallel(batch);
+    } else if (engine_ == FilterEngine::Fixed) {
+        filter_batch_fixed(batch);
+    } else if (engine_ == FilterEngine::Simd) {
+        filter_batch_simd(batch);
+    } else {
+        append_batch(batch);
+        while (data_buffer_.size() >= window_size_) {
+            process_element();
+        }
+    }
+    // Generation to decision. With parallel workers or rows the last results
+    // of the batch may still be pending, so this is when the batch was handed
+    // off to the filter rather than when its last decision reached the sink.
+    latency_.record_since(batch.created_ns);
+}
+
+void FilterThreshold::restart_stream(uint64_t first_index) {
+    // Finish what came before the gap as at the end of the stream; its last
+    // past_ + future_ pixels have no complete window.
+    drain_chunks();
+    if (row_mode()) {
+        finish_rows();
+        rows_before_gaps_ += rows_received_;
+        rows_received_ = 0;
+        // Restart on the next line boundary; a broken line is dropped.
+        first_row_ = (first_index + row_width_ - 1) / row_width_;
+        row_skip_ = static_cast<size_t>(first_row_ * row_width_ - first_index);
+    } else {
+        while (data_buffer_.size() >= window_size_) {
+            process_element();
+        }
+        // The next window is centered on pixel first_index + past_.
+        index_offset_ = first_index - pixels_filtered_;
+        windows_expected_ = pixels_filtered_;
+    }
+    data_buffer_.consume(data_buffer_.size());
+}
+
+size_t FilterThreshold::append_batch(const PixelBatch& batch) {
+    // Append the batch behind the carried-over history so the kernels see one
+    // flat array. Returns the number of complete windows now available.
+    data_buffer_.append(batch.data, batch.size);
+    if (data_buffer_.size() < window_size_) {
+        return 0;
+    }
+    return data_buffer_.size() - (window_size_ - 1);
+}
+
+double FilterThreshold::reference_filter(const uint8_t* window) const {
+    // The reference double-precision dot product used by process_element().
+    double filtered_value = 0.0;
+    for (size_t i = 0; i < window_size_; ++i) {
+        filtered_value += static_cast<double>(window[i]) * window_[i];
+    }
+    return filtered_value;
+}
+
+void FilterThreshold::filter_batch_simd(const PixelBatch& batch) {
+    size_t count = append_batch(batch);
+    if (count > 0) {
+        const uint8_t* window = data_buffer_.data();
+        expect_windows(window, count);
+        simd_output_.resize(count);
+        float_kernel_.apply(window, count, simd_output_.data());
+        for (size_t i = 0; i < count; ++i) {
+            double filtered_value = simd_value(window + i, simd_output_[i]);
+            report_result(window[i + past_], filtered_value, filtered_value >= threshold_value_);
+        }
+        // Everything but the last window_size_ - 1 elements has been filtered.
+        data_buffer_.consume(count);
+    }
+}
+
+void FilterThreshold::filter_batch_fixed(const PixelBatch& batch) {
+    size_t count = append_batch(batch);
+    if (count > 0) {
+        const uint8_t* window = data_buffer_.data();
+        expect_windows(window, count);
+        fixed_output_.resize(count);
+        filter9_symmetric_i16(window, count, fixed_taps_, fixed_output_.data());
+        for (size_t i = 0; i < count; ++i) {
+            int sum = fixed_output_[i];
+            double value = static_cast<double>(sum) / fixed_denominator_;
+            if (near_low_threshold(value, fixed_error_)) {
+                // Hysteresis would compare the rounded value against TV - band.
+                double filtered_value = reference_filter(window + i);
+                report_result(window[i + past_], filtered_value, filtered_value >= threshold_value_);
+            } else if (sum >= fixed_defect_from_) {
+                report_result(window[i + past_], value, true);
+            } else if (sum < fixed_clear_below_) {
+                report_result(window[i + past_], value, false);
+            } else {
+                // Within rounding distance of TV: let the double path decide.
+                double filtered_value = reference_filter(window + i);
+                report_result(window[i + past_], filtered_value, filtered_value >= threshold_value_);
+            }
+        }
+        data_buffer_.consume(count);
+    }
+}
+
+bool FilterThreshold::set_verify(const VerifyConfig& config, int m) {
+    if (!config.enabled()) {
+        return false;
+    }
+    if (!batch_pool_) {
+        std::cerr << "FilterThreshold: Verification needs batch transport (pairs always use the reference filter)." << std::endl;
+        return false;
+    }
+    if (engine_ == FilterEngine::Reference && !worker_pool_) {
+        std::cerr << "FilterThreshold: The reference engine on the stage thread is the reference, nothing to verify." << std::endl;
+        return false;
+    }
+    // Sampled results in flight: one batch, plus every parallel chunk.
+    size_t depth = batch_pool_->batch_capacity() + chunk_storage_.size() * chunk_size_;
+    verifier_.configure(config, threshold_value_, m, depth / config.sample_every + 1);
+    if (row_mode()) {
+        reference_rows_.assign(row_config_.lines * row_width_, 0.0);
+        reference_sources_.assign(row_config_.lines, nullptr);
+    }
+    return true;
+}
+
+std::string FilterThreshold::verification_summary() const {
+    std::string path = engine_ == FilterEngine::Simd ? "simd" : engine_ == FilterEngine::Fixed ? "fixed" : "reference";
+    if (worker_pool_) {
+        path += " on " + std::to_string(worker_pool_->thread_count()) + " workers";
+    }
+    if (row_mode()) {
+        path += ", rows";
+    }
+    return verifier_.summary(path);
+}
+
+void FilterThreshold::expect_windows(const uint8_t* windows, size_t count) {
+    // Stream layout: windows[i] is centered on pixel past_ + windows_expected_ + index_offset_ + i.
+    if (!verifier_.enabled()) {
+        return;
+    }
+    uint64_t base = past_ + windows_expected_ + index_offset_;
+    uint64_t every = verifier_.config().sample_every;
+    for (uint64_t i = (every - base % every) % every; i < count; i += every) {
+        verifier_.expect(base + i, reference_filter(windows + i));
+    }
+    windows_expected_ += count;
+}
+
+bool FilterThreshold::verify_row(uint64_t row) const {
+    // Within K/2 lines of a sampled line, whose vertical window may use it.
+    uint64_t every = verifier_.config().sample_every;
+    uint64_t half = row_config_.lines / 2;
+    uint64_t offset = row % every;
+    return offset <= half || every - offset <= half;
+}
+
+bool FilterThreshold::set_row_mode(int m, const RowFilterConfig& config) {
+    // Mirror reflects up to max(past, future) pixels into the line, Skip needs one full window.
+    size_t min_width = 1;
+    if (config.edge == EdgeMode::Mirror) {
+        min_width = std::max(past_, future_) + 1;
+    } else if (config.edge == EdgeMode::Skip) {
+        min_width = window_size_;
+    }
+    if (m <= 0 || static_cast<size_t>(m) < min_width) {
+        std::cerr << "FilterThreshold: Row mode needs m >= " << min_width << " for this edge mode, using stream mode." << std::endl;
+        return false;
+    }
+    if (config.lines == 0 || config.lines % 2 == 0) {
+        std::cerr << "FilterThreshold: Vertical kernel height must be odd, using stream mode." << std::endl;
+        return false;
+    }
+    row_width_ = static_cast<size_t>(m);
+    row_config_ = config;
+    vertical_taps_ = binomial_kernel(config.lines);
+    padded_row_.assign(row_width_ + window_size_ - 1, 0);
+    raw_rows_.assign(config.lines * row_width_, 0);
+    filtered_rows_.assign(config.lines * row_width_, 0.0);
+    vertical_sources_.assign(config.lines, nullptr);
+    exact_rows_.assign(config.lines * row_width_, 0.0);
+    rows_received_ = 0;
+    data_buffer_.reserve(row_width_ + (batch_pool_ ? batch_pool_->batch_capacity() : 2));
+    return true;
+}
+
+void FilterThreshold::append_row_pixels(const uint8_t* pixels, size_t count) {
+    // Collect pixels until a whole line is available, then filter it in one go.
+    size_t skipped = std::min(row_skip_, count);
+    row_skip_ -= skipped;
+    data_buffer_.append(pixels + skipped, count - skipped);
+    while (data_buffer_.size() >= row_width_) {
+        filter_row(data_buffer_.data());
+        data_buffer_.consume(row_width_);
+    }
+}
+
+void FilterThreshold::filter_windows(const uint8_t* windows, size_t count, double* out,
+                                     std::vector<float>& float_scratch,
+                                     std::vector<int16_t>& fixed_scratch) const {
+    // out[c] = window over windows[c .. c + window_size_ - 1], with the selected
+    // engine. Only touches the scratch buffers, so workers may call it concurrently.
+    if (engine_ == FilterEngine::Simd) {
+        float_scratch.resize(count);
+        float_kernel_.apply(windows, count, float_scratch.data());
+        for (size_t c = 0; c < count; ++c) {
+            out[c] = simd_value(windows + c, float_scratch[c]);
+        }
+    } else if (engine_ == FilterEngine::Fixed) {
+        fixed_scratch.resize(count);
+        filter9_symmetric_i16(windows, count, fixed_taps_, fixed_scratch.data());
+        for (size_t c = 0; c < count; ++c) {
+            int sum = fixed_scratch[c];
+            // Outside the ambiguous band sum / denominator lands on the same side
+            // of TV (and of the low threshold) as the double path; inside it,
+            // use the double path itself.
+            double value = static_cast<double>(sum) / fixed_denominator_;
+            if ((sum >= fixed_defect_from_ || sum < fixed_clear_below_) && !near_low_threshold(value, fixed_error_)) {
+                out[c] = value;
+            } else {
+                out[c] = reference_filter(windows + c);
+            }
+        }
+    } else {
+        for (size_t c = 0; c < count; ++c) {
+            out[c] = reference_filter(windows + c);
+        }
+    }
+}
+
+void FilterThreshold::filter_row(const uint8_t* row) {
+    size_t lines = row_config_.lines;
+    size_t slot = static_cast<size_t>(rows_received_ % lines) * row_width_;
+    std::copy(row, row + row_width_, raw_rows_.begin() + slot);
+
+    double* filtered = filtered_rows_.data() + slot;
+    if (row_config_.edge == EdgeMode::Skip) {
+        // Only centers with a complete window inside the line.
+        std::fill(filtered, filtered + row_width_, 0.0);
+        filter_windows(row, row_width_ - (window_size_ - 1), filtered + past_, simd_output_, fixed_output_);
+    } else {
+        pad_row(row, row_width_, past_, future_, row_config_.edge, padded_row_.data());
+        filter_windows(padded_row_.data(), row_width_, filtered, simd_output_, fixed_output_);
+    }
+    if (verifier_.enabled() && verify_row(rows_received_)) {
+        // The reference horizontal pass over the same windows.
+        reference_row(row, reference_rows_.data() + slot);
+    }
+
+    // With the K-line kernel, line r completes the vertical window of line r - K/2.
+    uint64_t current = rows_received_++;
+    uint64_t half = lines / 2;
+    if (current >= half) {
+        uint64_t center_row = current - half;
+        if (row_config_.edge != EdgeMode::Skip || center_row >= half) {
+            emit_row(center_row, current);
+        }
+    }
+}
+
+void FilterThreshold::reference_row(const uint8_t* row, double* out) {
+    // The reference horizontal pass of one line, laid out like filtered_rows_.
+    if (row_config_.edge == EdgeMode::Skip) {
+        std::fill(out, out + row_width_, 0.0);
+        for (size_t c = 0; c + window_size_ <= row_width_; ++c) {
+            out[past_ + c] = reference_filter(row + c);
+        }
+    } else {
+        pad_row(row, row_width_, past_, future_, row_config_.edge, padded_row_.data());
+        for (size_t c = 0; c < row_width_; ++c) {
+            out[c] = reference_filter(padded_row_.data() + c);
+        }
+    }
+}
+
+double FilterThreshold::horizontal_error() const {
+    // Bound on |engine - Reference| of a vertical result. The binomial
+    // vertical taps are positive and sum to 1, so the horizontal bound
+    // carries over; the two vertical passes add their own double rounding.
+    double bound = engine_ == FilterEngine::Simd ? simd_margin_ : engine_ == FilterEngine::Fixed ? fixed_error_ : 0.0;
+    if (bound == 0.0) {
+        return 0.0;
+    }
+    double magnitude = 0.0;
+    for (double tap : window_) {
+        magnitude += std::fabs(tap);
+    }
+    return bound + (row_config_.lines + 1) * DBL_EPSILON * 255.0 * magnitude;
+}
+
+void FilterThreshold::emit_row(uint64_t row, uint64_t last_row) {
+    // Vertical pass over the ring for output line row; lines beyond
+    // [0, last_row] are edge-extended (never needed in Skip mode).
+    size_t lines = row_config_.lines;
+    long half = static_cast<long>(lines / 2);
+    size_t first_column = 0;
+    size_t end_column = row_width_;
+    if (row_config_.edge == EdgeMode::Skip) {
+        first_column = past_;
+        end_column = row_width_ - future_;
+    }
+    // The ring only holds the newest K lines.
+    long oldest = static_cast<long>(last_row) - static_cast<long>(lines) + 1;
+    if (oldest < 0) {
+        oldest = 0;
+    }
 
-    while (running_) {
-        // Try to get data from the queue.
-        // This pop can block. If producer is finished and queue is empty,
-        // we need a way to stop.
+    const double** source = vertical_sources_.data();
+    for (size_t k = 0; k < lines; ++k) {
+        long position = edge_position(static_cast<long>(row) + static_cast<long>(k) - half,
+                                      oldest, static_cast<long>(last_row), row_config_.edge);
+        source[k] = filtered_rows_.data() + static_cast<size_t>(position % static_cast<long>(lines)) * row_width_;
+    }
+    const uint8_t* raw = raw_rows_.data() + static_cast<size_t>(row % lines) * row_width_;
+    uint64_t base_index = (first_row_ + row) * row_width_;
+    bool verify = verifier_.enabled() && verifier_.sampled(row);
+    if (verify) {
+        // The same lines of the reference horizontal pass.
+        for (size_t k = 0; k < lines; ++k) {
+            reference_sources_[k] = reference_rows_.data() + (source[k] - filtered_rows_.data());
+        }
+    }
 
-        // Non-blocking try_pop to check producer_finished_flag_ periodically
-        bool got_item = input_queue_.try_pop(received_pair);
+    // Results this close to TV (or to the hysteresis low threshold) may be
+    // decided differently than the reference would decide them; those use the
+    // reference pass of the same lines.
+    double margin = horizontal_error();
+    bool exact_ready = false;
 
-        if (got_item) {
-            data_buffer_.push_back(received_pair.first);
-            if (data_buffer_.size() >= WINDOW_SIZE) {
-                process_element(); // Process if window is full, oldest element at front is centered
+    for (size_t c = first_column; c < end_column; ++c) {
+        double filtered_value = 0.0;
+        for (size_t k = 0; k < lines; ++k) {
+            filtered_value += vertical_taps_[k] * source[k][c];
+        }
+        if (margin > 0.0 && (std::fabs(filtered_value - threshold_value_) <= margin ||
+                             near_low_threshold(filtered_value, margin))) {
+            if (!exact_ready) {
+                for (size_t k = 0; k < lines; ++k) {
+                    size_t line = static_cast<size_t>(source[k] - filtered_rows_.data());
+                    reference_row(raw_rows_.data() + line, exact_rows_.data() + k * row_width_);
+                }
+                exact_ready = true;
+            }
+            filtered_value = 0.0;
+            for (size_t k = 0; k < lines; ++k) {
+                filtered_value += vertical_taps_[k] * exact_rows_[k * row_width_ + c];
             }
-            data_buffer_.push_back(received_pair.second);
-            if (data_buffer_.size() >= WINDOW_SIZE) {
-                process_element(); // Process again if second element made window full
+        }
+        if (verify) {
+            double reference_value = 0.0;
+            for (size_t k = 0; k < lines; ++k) {
+                reference_value += vertical_taps_[k] * reference_sources_[k][c];
             }
-        } else {
-            // Queue was empty
-            if (producer_finished_flag_ && input_queue_.empty()) {
-                // Producer is done and queue is empty, process remaining buffer then stop
-                std::cout << "FilterThreshold: Producer finished and queue empty." << std::endl;
-                break; // Exit main processing loop
+            verifier_.compare(base_index + c, filtered_value, filtered_value >= threshold_value_, reference_value);
+        }
+        report_result_at(base_index + c, raw[c], filtered_value, filtered_value >= threshold_value_);
+    }
+}
+
+void FilterThreshold::finish_rows() {
+    // Emit the last K/2 lines, whose vertical window runs past the end of the stream.
+    if (rows_received_ == 0) {
+        return;
+    }
+    uint64_t half = row_config_.lines / 2;
+    uint64_t last_row = rows_received_ - 1;
+    uint64_t first = rows_received_ > half ? rows_received_ - half : 0;
+    for (uint64_t row = first; row <= last_row; ++row) {
+        if (row_config_.edge == EdgeMode::Skip && (row < half || row + half > last_row)) {
+            continue;
+        }
+        emit_row(row, last_row);
+    }
+}
+
+bool FilterThreshold::set_parallel(size_t worker_count, size_t chunk_size) {
+    if (worker_count == 0) {
+        return false;
+    }
+    if (!batch_pool_ || row_mode()) {
+        std::cerr << "FilterThreshold: Parallel filtering needs batch transport and the stream layout, filtering on the stage thread." << std::endl;
+        return false;
+    }
+    chunk_size_ = chunk_size > 0 ? chunk_size : 4096;
+    worker_pool_ = std::make_unique<WorkerPool>(worker_count);
+    // A few chunks per worker keep everyone busy while the front one is reordered.
+    size_t chunk_count = 4 * worker_count + 2;
+    for (size_t i = 0; i < chunk_count; ++i) {
+        std::unique_ptr<FilterChunk> chunk(new FilterChunk());
+        chunk->count = 0;
+        chunk->pixels.reserve(chunk_size_ + window_size_ - 1);
+        chunk->values.reserve(chunk_size_);
+        chunk->done = false;
+        free_chunks_.push_back(chunk.get());
+        chunk_storage_.push_back(std::move(chunk));
+    }
+    in_flight_.reserve(chunk_count);
+    return true;
+}
+
+void FilterThreshold::filter_batch_parallel(const PixelBatch& batch) {
+    size_t count = append_batch(batch);
+    const uint8_t* window = data_buffer_.data();
+    expect_windows(window, count); // From the stream, not the chunk copies
+    for (size_t offset = 0; offset < count; offset += chunk_size_) {
+        while (free_chunks_.empty()) {
+            release_front_chunk(true); // Back-pressure: reorder the oldest chunk first
+        }
+        FilterChunk* chunk = free_chunks_.back();
+        free_chunks_.pop_back();
+        chunk->count = std::min(chunk_size_, count - offset);
+        // The chunk's own copy of its windows: past_ halo pixels before, future_ after.
+        chunk->pixels.assign(window + offset, window + offset + chunk->count + window_size_ - 1);
+        chunk->values.resize(chunk->count);
+        chunk->done = false;
+        in_flight_.push_back(chunk);
+        worker_pool_->submit([this, chunk] { filter_chunk(chunk); });
+    }
+    data_buffer_.consume(count);
+    // Pass on whatever is already finished without waiting.
+    while (release_front_chunk(false)) {
+    }
+}
+
+void FilterThreshold::filter_chunk(FilterChunk* chunk) const {
+    // Runs on a worker thread.
+    filter_windows(chunk->pixels.data(), chunk->count, chunk->values.data(),
+                   chunk->float_scratch, chunk->fixed_scratch);
+    {
+        std::lock_guard<std::mutex> lock(chunk_mutex_);
+        chunk->done = true;
+    }
+    chunk_done_.notify_all();
+}
+
+bool FilterThreshold::release_front_chunk(bool wait) {
+    // Reorder stage: results only leave in submission (= stream) order.
+    if (in_flight_.empty()) {
+        return false;
+    }
+    FilterChunk* chunk = in_flight_.front();
+    {
+        std::unique_lock<std::mutex> lock(chunk_mutex_);
+        if (!chunk->done) {
+            if (!wait) {
+                return false;
             }
-            // If producer not finished, or queue not empty (race condition, unlikely with try_pop logic),
-            // just yield/sleep briefly to avoid busy-waiting if items are infrequent.
-            // The problem states T is a max cycle time, implying work or sleep.
-            // If no item, we still "complete a cycle" by sleeping.
-            // std::this_thread::yield(); // or a short sleep
+            chunk_done_.wait(lock, [chunk] { return chunk->done; });
         }
+    }
+    in_flight_.pop_front();
+    for (size_t i = 0; i < chunk->count; ++i) {
+        double filtered_value = chunk->values[i];
+        report_result(chunk->pixels[i + past_], filtered_value, filtered_value >= threshold_value_);
+    }
+    free_chunks_.push_back(chunk);
+    return true;
+}
 
-        // Regardless of whether an item was processed or not, ensure the cycle time T.
-        // If process_element took time, this sleep will be shorter.
-        // If no item was popped and processed, this will be a full T sleep.
-        std::this_thread::sleep_for(std::chrono::nanoseconds(t_ns_));
+void FilterThreshold::drain_chunks() {
+    while (release_front_chunk(true)) {
     }
+}
 
+void FilterThreshold::run() {
+    long long cpu_start = thread_cpu_time_ns();
+    SteadyStateScope steady_state;
+    while (running_.load(std::memory_order_relaxed)) {
+        // Blocks while the queue is empty and returns false once the producer
+        // has closed it and everything queued before that has been taken.
+        bool got_item = batch_queue_ ? receive_batch() : receive_pair();
+        if (!got_item) {
+            std::cout << "FilterThreshold: Producer finished and queue empty." << std::endl;
+            break; // Exit main processing loop
+        }
+
+        metrics_.items.set(items_popped_);
+        metrics_.pixels.set(pixels_filtered_);
+        metrics_.enter_idle();
+
+        // Ensure the cycle time T between items.
+        // The pacer waits for an absolute deadline, so the time process_element
+        // took is absorbed instead of being added on top of T.
+        if (!pacer_.wait()) {
+            metrics_.deadline_misses.add(1);
+        }
+        steady_state.tick();
+    }
+    steady_state.leave();
+
+    finish_stream();
+    cpu_time_ns_ = thread_cpu_time_ns() - cpu_start;
+    std::cout << "FilterThreshold: " << pacer_.summary() << std::endl;
+    report_leftovers();
+}
+
+void FilterThreshold::finish_stream() {
     // After the loop, process any remaining elements in the buffer
     // that can form a complete window. This is important when the producer has finished.
     std::cout << "FilterThreshold: Processing remaining elements in buffer after main loop..." << std::endl;
-    while (data_buffer_.size() >= WINDOW_SIZE) {
-        process_element();
+    drain_chunks();
+    if (row_mode()) {
+        finish_rows();
+    } else {
+        while (data_buffer_.size() >= window_size_) {
+            process_element();
+        }
     }
 
-    std::cout << "FilterThreshold: Exiting run loop. " << data_buffer_.size() << " elements remaining in buffer (not enough for a full window)." << std::endl;
+    // A run still shorter than min_run at the end of the stream is clean.
+    flush_pending_run(false);
+    sink_->finish();
+}
+
+void FilterThreshold::report_leftovers() const {
+    if (row_mode()) {
+        std::cout << "FilterThreshold: Exiting run loop. " << rows_before_gaps_ + rows_received_ << " rows filtered, "
+                  << data_buffer_.size() << " elements remaining in buffer (incomplete row)." << std::endl;
+    } else {
+        std::cout << "FilterThreshold: Exiting run loop. " << data_buffer_.size() << " elements remaining in buffer (not enough for a full window)." << std::endl;
+    }
     if(!data_buffer_.empty()){
         std::cout << "Remaining elements: ";
         for(uint8_t val : data_buffer_){
@@ -1,47 +1,328 @@
 #ifndef FILTER_THRESHOLD_H
 #define FILTER_THRESHOLD_H
 
-#include "blocking_queue.h"
+#include "pipeline_queue.h"
+#include "pixel_batch.h"
+#include "pacer.h"
+#include "result_sink.h"
+#include "row_filter.h"
+#include "worker_pool.h"
+#include "metrics.h"
+#include "alloc_check.h"
+#include "filter_kernel.h"
+#include "filter_verify.h"
+#include <atomic>
 #include <vector>
-#include <deque>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include "history_buffer.h"
+#include "ring_buffer.h"
 #include <cstdint> // For uint8_t
 #include <utility> // For std::pair
 #include <string>  // For std::string, if needed for output formatting
 #include <thread>  // For std::this_thread
 #include <chrono>  // For std::chrono
+#include <cmath>   // For std::fabs
 #include <numeric> // For std::inner_product (potentially) or manual loop
 #include <iomanip> // For std::fixed, std::setprecision if printing floats
 
+// Filter implementation used for batch transport.
+enum class FilterEngine {
+    Reference, // Double-precision dot product, one element at a time (process_element)
+    Simd,      // Vectorized float kernel over a whole batch (filter_kernel.h); results near TV re-decided in double
+    Fixed      // Vectorized int16 kernel with an exact integer threshold
+};
+
+// Two-level thresholding (set_hysteresis). A defect starts where the filtered
+// value reaches TV and lasts while it stays at or above TV - band, so noise
+// around TV no longer toggles the decision. Runs of fewer than min_run defect
+// pixels are reported as clean.
+struct HysteresisConfig {
+    double band = 0.0;  // TV - low threshold; 0 = single threshold
+    size_t min_run = 1; // 0 and 1 keep every run
+
+    bool enabled() const { return band > 0.0 || min_run > 1; }
+};
+
 class FilterThreshold {
 public:
-    FilterThreshold(BlockingQueue<std::pair<uint8_t, uint8_t>>& input_queue,
+    FilterThreshold(PipelineQueue<std::pair<uint8_t, uint8_t>>& input_queue,
                     double tv, // Threshold Value
-                    long long t_ns, // Process time T in nanoseconds
-                    bool& producer_finished_flag); // Reference to a flag indicating producer is done
+                    long long t_ns); // Process time T in nanoseconds
+
+    // Batch transport: consumes whole PixelBatch spans and returns them to batch_pool.
+    FilterThreshold(PipelineQueue<PixelBatch*>& input_queue,
+                    BatchPool& batch_pool,
+                    double tv,
+                    long long t_ns);
+
+    // Stage mode: no queue of its own. Batches are handed in by process_batch()
+    // (from a Pipeline) and finish_stream() is called after the last one.
+    FilterThreshold(BatchPool& batch_pool, double tv, long long t_ns);
 
     // The main loop for the filter and threshold block, to be run in a thread.
+    // Parks while the input queue is empty and returns once it is closed and drained.
     void run();
 
-    // Signal to stop the processor.
+    // Filter the pixels of one batch (the batch is not released), and flush
+    // everything still buffered at the end of the stream. run() uses both.
+    // Results are reported at the batches' stream indices: where a batch does
+    // not continue the previous one (lines shed under overload, slots lost in
+    // a shared-memory ring), the stream before the gap is finished as at its
+    // end, and no window spans the gap.
+    void process_batch(const PixelBatch& batch);
+    void finish_stream();
+    void report_leftovers() const;
+
+    // Signal to stop the processor; safe from any thread. Takes effect after
+    // the current item (a filter parked on an empty queue waits for close()).
     void stop();
 
-    // Static constant for the filter window
+    // Choose how iterations are spaced T apart (default: hybrid sleep-then-spin
+    // against absolute deadlines). Call before run().
+    void set_pacing(const PacerConfig& config);
+    const Pacer& pacer() const { return pacer_; }
+
+    // Replace the default 9-tap window with any kernel of one or more taps,
+    // centered on tap spec.center (past() pixels before it, future() after).
+    // Returns false (and keeps the current kernel) for an empty kernel or an
+    // out-of-range center. Call before set_engine(), set_row_mode(),
+    // set_parallel() and run().
+    bool set_kernel(const KernelSpec& spec);
+    const std::vector<double>& window() const { return window_; }
+    size_t window_size() const { return window_size_; }
+    size_t past_elements() const { return past_; }
+    size_t future_elements() const { return future_; }
+    const ConvolutionKernel& float_kernel() const { return float_kernel_; }
+
+    // Select the filter implementation for batch transport. Call before run().
+    // Simd works with every kernel (specialized loops for the common lengths).
+    // Fixed requires a symmetric 9-tap window representable as integer taps
+    // and otherwise falls back to Reference, keeping its decisions exact.
+    void set_engine(FilterEngine engine);
+    FilterEngine engine() const { return engine_; }
+
+    // Filter scan lines of m pixels separately instead of one flat stream, with
+    // the given edge handling and optional K-line vertical pass. Works with both
+    // transports and every engine; assumes no pixels are dropped upstream.
+    // Returns false (and keeps stream mode) if m cannot support the config.
+    // Call before run().
+    bool set_row_mode(int m, const RowFilterConfig& config);
+    bool row_mode() const { return row_width_ > 0; }
+
+    // Split every received batch into chunks of chunk_size windows and filter
+    // them on a pool of worker_count threads. Each chunk copies its pixels
+    // together with the past / future halo of the kernel, so workers are
+    // independent; results are put back in stream order before the sink, and
+    // every decision is the same as with the stage thread filtering alone.
+    // Batch transport with the stream layout only. Call before run().
+    bool set_parallel(size_t worker_count, size_t chunk_size);
+    size_t worker_count() const { return worker_pool_ ? worker_pool_->thread_count() : 0; }
+
+    // Decide defects with a high (TV) and a low threshold and drop runs
+    // shorter than config.min_run. Decisions follow the reported stream
+    // order; a gap in the result indices (skip edges) ends the run. While a
+    // run is shorter than min_run its results are held back (at most
+    // min_run - 1 of them), so the sink sees them only once they are decided.
+    // The low threshold is compared against the engine's filtered value.
+    // Call before run().
+    void set_hysteresis(const HysteresisConfig& config);
+    const HysteresisConfig& hysteresis() const { return hysteresis_; }
+
+    // Check the selected engine (and the parallel reorder) against the
+    // reference dot product on the same windows, for the sampled results (see
+    // FilterVerifier). m > 0 reports mismatches by row and column. Needs batch
+    // transport and a path other than the reference engine on the stage
+    // thread; returns false otherwise. Call after set_engine(),
+    // set_row_mode() and set_parallel(), before run().
+    bool set_verify(const VerifyConfig& config, int m);
+    const FilterVerifier& verifier() const { return verifier_; }
+    std::string verification_summary() const; // After run()
+
+    // Where per-pixel results go. The default is a TextSink on std::cout that
+    // prints the original "Filtered Output" lines. The sink must outlive run().
+    void set_sink(ResultSink& sink) { sink_ = &sink; }
+
+    // Counters for benchmark reporting; read them after the thread has joined.
+    uint64_t pixels_filtered() const { return pixels_filtered_; }
+    uint64_t defects_found() const { return defects_found_; }
+    uint64_t items_popped() const { return items_popped_; }
+    long long cpu_time_ns() const { return cpu_time_ns_; } // Thread CPU time spent in run()
+
+    // Live instrumentation (empty when built with STATS=0); safe to read while
+    // running. latency() is generation to decision per batch (batch transport).
+    const StageMetrics& metrics() const { return metrics_; }
+    const LatencyHistogram& latency() const { return latency_; }
+
+    // The default filter window (default_kernel_spec()), centered on tap 4.
     static const std::vector<double> FILTER_WINDOW;
-    static const size_t WINDOW_SIZE = 9;
-    static const size_t PAST_ELEMENTS = 4;
-    static const size_t FUTURE_ELEMENTS = 4;
 
 
 private:
+    // Shared constructor body for both transports; exactly one queue is non-null.
+    FilterThreshold(PipelineQueue<std::pair<uint8_t, uint8_t>>* pair_queue,
+                    PipelineQueue<PixelBatch*>* batch_queue,
+                    BatchPool* batch_pool,
+                    double tv,
+                    long long t_ns);
+
     void process_element();
+    size_t append_batch(const PixelBatch& batch);
+    void filter_batch_simd(const PixelBatch& batch);
+    void filter_batch_fixed(const PixelBatch& batch);
+    double reference_filter(const uint8_t* window) const;
+    void setup_fixed_point();
+    void setup_simd_band();
+    bool near_low_threshold(double value, double margin) const {
+        // Hysteresis compares the values themselves against TV - band.
+        return low_threshold_ < threshold_value_ && std::fabs(value - low_threshold_) <= margin;
+    }
+    double simd_value(const uint8_t* window, float value) const {
+        // Outside the bands the float result is on the same side of TV (and of
+        // the hysteresis low threshold) as the double path; inside, it decides.
+        if ((value >= simd_defect_from_ || value < simd_clear_below_) && !near_low_threshold(value, simd_margin_)) {
+            return value;
+        }
+        return reference_filter(window);
+    }
+    void report_result(uint8_t center_value, double filtered_value, bool defect);
+    void report_result_at(uint64_t index, uint8_t center_value, double filtered_value, bool defect);
+    void deliver(uint64_t index, uint8_t center_value, double filtered_value, bool defect);
+    void apply_hysteresis(uint64_t index, uint8_t center_value, double filtered_value, bool defect);
+    void flush_pending_run(bool defect);
+    void append_row_pixels(const uint8_t* pixels, size_t count);
+    void filter_row(const uint8_t* row);
+    void filter_windows(const uint8_t* windows, size_t count, double* out,
+                        std::vector<float>& float_scratch, std::vector<int16_t>& fixed_scratch) const;
+    void reference_row(const uint8_t* row, double* out);
+    double horizontal_error() const;
+    void emit_row(uint64_t row, uint64_t last_row);
+    void finish_rows();
+    void restart_stream(uint64_t first_index);
+    void expect_windows(const uint8_t* windows, size_t count);
+    bool verify_row(uint64_t row) const;
+
+    struct FilterChunk;
+    void filter_batch_parallel(const PixelBatch& batch);
+    void filter_chunk(FilterChunk* chunk) const;
+    bool release_front_chunk(bool wait);
+    void drain_chunks();
+    bool receive_pair();
+    bool receive_batch();
+    template <typename T>
+    bool next_item(PipelineQueue<T>& queue, T& item);
 
-    BlockingQueue<std::pair<uint8_t, uint8_t>>& input_queue_;
+    PipelineQueue<std::pair<uint8_t, uint8_t>>* pair_queue_;  // Set in pair transport
+    PipelineQueue<PixelBatch*>* batch_queue_;                // Set in batch transport
+    BatchPool* batch_pool_;
     double threshold_value_;
     long long t_ns_; // Process time T in nanoseconds
-    bool running_;
-    bool& producer_finished_flag_; // Shared flag to know when producer is done
+    Pacer pacer_;    // Spaces iterations T apart
+    std::atomic<bool> running_; // Stop token, cleared by stop()
+
+    std::unique_ptr<ResultSink> default_sink_;
+    ResultSink* sink_;
+    uint64_t pixels_filtered_;
+    uint64_t defects_found_;
+    uint64_t items_popped_;  // Pairs or batches taken from the queue
+    long long cpu_time_ns_;
+    StageMetrics metrics_;
+    LatencyHistogram latency_;
+
+    // Hysteresis (set_hysteresis). pending_run_ holds the results of a run
+    // that has not reached min_run pixels yet.
+    struct PendingResult {
+        uint64_t index;
+        uint8_t center_value;
+        double filtered_value;
+    };
+    HysteresisConfig hysteresis_;
+    double low_threshold_;
+    bool in_defect_;        // State of the high/low comparator
+    bool run_confirmed_;    // The current run has reached min_run
+    uint64_t next_index_;   // Index that continues the current run
+    std::vector<PendingResult> pending_run_;
+
+    // The kernel (set_kernel); window_[past_] weighs the pixel being decided.
+    std::vector<double> window_;
+    size_t window_size_;
+    size_t past_;
+    size_t future_;
+
+    // Contiguous window buffer: the window_size_ - 1 element tail of the
+    // previous transfer followed by the newly received pixels.
+    HistoryBuffer data_buffer_;
+    uint64_t next_batch_index_; // Stream index that continues the last batch
+    uint64_t index_offset_;     // Stream pixels skipped at gaps (stream layout)
+
+    // Row-aware mode (set_row_mode). The last K raw lines and their
+    // horizontally filtered values are kept in rings indexed by row % K;
+    // data_buffer_ then only holds the line being assembled.
+    size_t row_width_;             // m, or 0 in stream mode
+    RowFilterConfig row_config_;
+    std::vector<double> vertical_taps_;
+    std::vector<uint8_t> padded_row_;  // One line plus edge extension
+    std::vector<uint8_t> raw_rows_;    // K * m original pixels
+    std::vector<double> filtered_rows_; // K * m horizontal results
+    std::vector<const double*> vertical_sources_; // Line feeding each vertical tap
+    std::vector<double> exact_rows_;   // Reference pass of those lines, for results near TV
+    uint64_t rows_received_;       // Since the last gap
+    uint64_t first_row_;           // Line number of row 0 after the last gap
+    uint64_t rows_before_gaps_;    // Rows received before the last gap
+    size_t row_skip_;              // Pixels left of a line broken by a gap
+
+    // Parallel mode (set_parallel). Chunks are recycled through free_chunks_;
+    // in_flight_ holds the submitted ones in stream order (the reorder stage).
+    // Only the done flags are shared with the workers.
+    struct FilterChunk {
+        size_t count;                      // Windows in this chunk
+        std::vector<uint8_t> pixels;       // count + window_size_ - 1, halo included
+        std::vector<double> values;
+        std::vector<float> float_scratch;
+        std::vector<int16_t> fixed_scratch;
+        bool done;                         // Guarded by chunk_mutex_
+    };
+    size_t chunk_size_;
+    std::vector<std::unique_ptr<FilterChunk>> chunk_storage_;
+    std::vector<FilterChunk*> free_chunks_;
+    RingBuffer<FilterChunk*> in_flight_;
+    mutable std::mutex chunk_mutex_;
+    mutable std::condition_variable chunk_done_;
+    std::unique_ptr<WorkerPool> worker_pool_; // Declared last: joins the workers before the rest goes
+
+    FilterEngine engine_;
+    ConvolutionKernel float_kernel_;    // Simd engine: float taps of window_
+    std::vector<float> simd_output_;
+    // The float kernel's result lies within simd_margin_ of the double path's.
+    // Results in [simd_clear_below_, simd_defect_from_) are re-evaluated with
+    // reference_filter(), so every defect decision is identical to Reference;
+    // with hysteresis, so are those within simd_margin_ of low_threshold_.
+    double simd_margin_;
+    double simd_clear_below_;
+    double simd_defect_from_;
+
+    // Fixed-point engine: window_ == fixed_taps_ / fixed_denominator_.
+    // An integer sum S is a defect if S >= fixed_defect_from_ and clean if
+    // S < fixed_clear_below_. Sums in between are so close to TV that the
+    // double path's rounding decides, so those pixels are re-evaluated with
+    // reference_filter() to keep every decision identical to Reference, as
+    // are those within fixed_error_ of the hysteresis low threshold.
+    bool fixed_available_;
+    int16_t fixed_taps_[5];
+    int fixed_denominator_;
+    double fixed_error_; // Bound on |S / denominator - reference_filter()|
+    int fixed_clear_below_;
+    int fixed_defect_from_;
+    std::vector<int16_t> fixed_output_;
 
-    std::deque<uint8_t> data_buffer_; // Buffer to hold elements for the 9-element window
+    // Golden check (set_verify). windows_expected_ counts the stream windows
+    // handed to expect_windows(); in row layout reference_rows_ holds the
+    // reference horizontal pass next to filtered_rows_.
+    FilterVerifier verifier_;
+    uint64_t windows_expected_;
+    std::vector<double> reference_rows_;
+    std::vector<const double*> reference_sources_;
 };
 
 #endif // FILTER_THRESHOLD_H
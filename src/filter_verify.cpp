@@ -0,0 +1,72 @@
+#include "filter_verify.h"
+#include <cmath>    // For std::fabs
+#include <iomanip>
+#include <iostream> // For std::cerr
+#include <limits>
+#include <sstream>
+
+FilterVerifier::FilterVerifier()
+    : threshold_value_(0.0),
+      m_(0),
+      checked_(0),
+      value_mismatches_(0),
+      decision_mismatches_(0),
+      max_error_(0.0),
+      has_mismatch_(false),
+      first_mismatch_{0, 0.0, 0.0, false} {}
+
+void FilterVerifier::configure(const VerifyConfig& config, double tv, int m, size_t expected_depth) {
+    config_ = config;
+    threshold_value_ = tv;
+    m_ = m;
+    expected_.reserve(expected_depth);
+}
+
+void FilterVerifier::compare(uint64_t index, double value, bool defect, double reference_value) {
+    ++checked_;
+    double error = std::fabs(value - reference_value);
+    max_error_ = error > max_error_ ? error : max_error_;
+    bool value_ok = error <= config_.tolerance;
+    bool decision_ok = defect == (reference_value >= threshold_value_);
+    if (value_ok && decision_ok) {
+        return;
+    }
+    value_mismatches_ += value_ok ? 0 : 1;
+    decision_mismatches_ += decision_ok ? 0 : 1;
+    if (!has_mismatch_) {
+        has_mismatch_ = true;
+        first_mismatch_ = {index, value, reference_value, defect};
+        // Said at once as well: in a long shadowed run the summary comes late.
+        std::cerr << "FilterThreshold: Verification mismatch: " << describe(first_mismatch_, "engine") << std::endl;
+    }
+}
+
+std::string FilterVerifier::describe(const Mismatch& mismatch, const std::string& engine_name) const {
+    std::ostringstream out;
+    out << "pixel " << mismatch.index;
+    if (m_ > 0) {
+        out << " (row " << mismatch.index / static_cast<uint64_t>(m_) << ", column "
+            << mismatch.index % static_cast<uint64_t>(m_) << ")";
+    }
+    out << std::setprecision(std::numeric_limits<double>::max_digits10) << ": " << engine_name << " " << mismatch.value
+        << (mismatch.defect ? " defect" : " clean") << ", reference " << mismatch.reference_value
+        << (mismatch.reference_value >= threshold_value_ ? " defect" : " clean");
+    return out.str();
+}
+
+std::string FilterVerifier::summary(const std::string& engine_name) const {
+    std::ostringstream out;
+    out << "Verification (" << engine_name << " vs reference, ";
+    if (config_.sample_every == 1) {
+        out << "every result";
+    } else {
+        out << "1 in " << config_.sample_every;
+    }
+    out << "): " << checked_ << " checked, max |error| " << std::setprecision(3) << max_error_
+        << " (tolerance " << config_.tolerance << "), " << value_mismatches_ << " value and "
+        << decision_mismatches_ << " decision mismatches";
+    if (has_mismatch_) {
+        out << "\nFirst mismatch at " << describe(first_mismatch_, engine_name);
+    }
+    return out.str();
+}
@@ -0,0 +1,94 @@
+#ifndef FILTER_VERIFY_H
+#define FILTER_VERIFY_H
+
+#include "ring_buffer.h"
+#include <cstddef> // For size_t
+#include <cstdint>
+#include <string>
+
+// Golden-output check of the optimized filter paths (FilterThreshold::set_verify).
+struct VerifyConfig {
+    uint64_t sample_every = 0; // Check one result in N (one line in N in row layout); 0 = off
+    double tolerance = 1e-3;   // Largest |engine - reference| filtered value that still matches
+    bool required = false;     // --verify: a mismatch fails the run
+
+    bool enabled() const { return sample_every > 0; }
+};
+
+// Compares the filtered values and threshold decisions of an optimized
+// engine with the reference double-precision dot product of process_element,
+// computed from the same pixel windows. Values match within the tolerance;
+// decisions (filtered value >= TV, before hysteresis) must match exactly.
+//
+// Where the engine's result is known at once, compare() checks it directly.
+// Where it arrives later (parallel workers), the reference is computed when
+// the windows are handed off and queued with expect(); match() then pairs it
+// with the result of the same index as it leaves in stream order. Checking
+// one result in N costs one reference dot product per sampled pixel.
+//
+// Only the filter stage's thread uses a verifier.
+class FilterVerifier {
+public:
+    FilterVerifier();
+
+    // Start checking against threshold tv; m > 0 reports mismatches by row
+    // and column. expected_depth reserves the queue (sampled results that can
+    // be in flight at once).
+    void configure(const VerifyConfig& config, double tv, int m, size_t expected_depth);
+    bool enabled() const { return config_.enabled(); }
+    const VerifyConfig& config() const { return config_; }
+
+    // Whether the result (or line) at position unit is one of the sampled ones.
+    bool sampled(uint64_t unit) const { return unit % config_.sample_every == 0; }
+
+    // Check one engine result against its reference value.
+    void compare(uint64_t index, double value, bool defect, double reference_value);
+
+    // Queue the reference value of a result that is still being computed.
+    void expect(uint64_t index, double reference_value) { expected_.push_back({index, reference_value}); }
+
+    // Check a result against its queued reference, if it has one.
+    void match(uint64_t index, double value, bool defect) {
+        if (!expected_.empty() && expected_.front().index == index) {
+            compare(index, value, defect, expected_.front().value);
+            expected_.pop_front();
+        }
+    }
+
+    uint64_t checked() const { return checked_; }
+    uint64_t value_mismatches() const { return value_mismatches_; }
+    uint64_t decision_mismatches() const { return decision_mismatches_; }
+    bool passed() const { return value_mismatches_ == 0 && decision_mismatches_ == 0; }
+
+    // "Verification (simd vs reference, every result): 1200 checked, ..." and,
+    // after a mismatch, a second line describing the first one. engine_name
+    // names the path being checked.
+    std::string summary(const std::string& engine_name) const;
+
+private:
+    struct Expected {
+        uint64_t index;
+        double value;
+    };
+    struct Mismatch {
+        uint64_t index;
+        double value;
+        double reference_value;
+        bool defect;
+    };
+
+    std::string describe(const Mismatch& mismatch, const std::string& engine_name) const;
+
+    VerifyConfig config_;
+    double threshold_value_;
+    int m_;
+    RingBuffer<Expected> expected_;
+    uint64_t checked_;
+    uint64_t value_mismatches_;
+    uint64_t decision_mismatches_;
+    double max_error_;
+    bool has_mismatch_;
+    Mismatch first_mismatch_;
+};
+
+#endif // FILTER_VERIFY_H
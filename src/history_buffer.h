@@ -0,0 +1,75 @@
+#ifndef HISTORY_BUFFER_H
+#define HISTORY_BUFFER_H
+
+#include <vector>
+#include <cstdint> // For uint8_t
+#include <cstddef> // For size_t
+#include <cstring> // For std::memmove, std::memcpy
+
+// Contiguous sliding-window buffer for the filter.
+//
+// New pixels are appended behind the elements still waiting for their future
+// neighbours, so the filter always sees one flat array starting at data().
+// consume() only advances a read offset; the (at most window size - 1 element)
+// tail is moved back to the front of the storage lazily, when an append would
+// run off the end. Once the storage has grown to the largest batch seen,
+// appending and consuming never allocate.
+class HistoryBuffer {
+public:
+    explicit HistoryBuffer(size_t initial_capacity = 64)
+        : storage_(initial_capacity), begin_(0), end_(0) {}
+
+    // Append count pixels behind the current contents.
+    void append(const uint8_t* pixels, size_t count) {
+        make_room(count);
+        std::memcpy(storage_.data() + end_, pixels, count);
+        end_ += count;
+    }
+
+    void push_back(uint8_t pixel) {
+        make_room(1);
+        storage_[end_++] = pixel;
+    }
+
+    // Drop the count oldest elements.
+    void consume(size_t count) {
+        begin_ += (count < size()) ? count : size();
+        if (begin_ == end_) {
+            begin_ = end_ = 0;
+        }
+    }
+
+    // Make sure count more pixels can be appended without reallocating.
+    void reserve(size_t count) { make_room(count); }
+
+    const uint8_t* data() const { return storage_.data() + begin_; }
+    size_t size() const { return end_ - begin_; }
+    bool empty() const { return begin_ == end_; }
+    uint8_t operator[](size_t i) const { return storage_[begin_ + i]; }
+
+    const uint8_t* begin() const { return data(); }
+    const uint8_t* end() const { return storage_.data() + end_; }
+
+private:
+    void make_room(size_t count) {
+        if (end_ + count <= storage_.size()) {
+            return;
+        }
+        // Slide the unconsumed tail to the front, then grow if still needed.
+        size_t live = size();
+        if (begin_ > 0) {
+            std::memmove(storage_.data(), storage_.data() + begin_, live);
+            begin_ = 0;
+            end_ = live;
+        }
+        if (live + count > storage_.size()) {
+            storage_.resize(live + count);
+        }
+    }
+
+    std::vector<uint8_t> storage_;
+    size_t begin_; // Offset of the oldest unconsumed element
+    size_t end_;   // One past the newest element
+};
+
+#endif // HISTORY_BUFFER_H
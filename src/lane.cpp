@@ -0,0 +1,509 @@
+#include "lane.h"
+#include "blocking_queue.h"
+#include "filter_kernel.h"
+#include "pipeline_stages.h"
+#include "thread_affinity.h"
+#include <algorithm> // For std::max
+#include <iostream>
+
+namespace {
+
+// Pooled batches when the (unbounded) blocking queue carries batches.
+const size_t DEFAULT_POOL_BATCHES = 64;
+
+// Backpressure high watermark of the unbounded blocking pair queue when none
+// is given, and the depth that queue has room for from the start.
+const size_t DEFAULT_PAIR_WATERMARK = 65536;
+
+// Pooled batches of a publishing lane: each one goes back to the pool as
+// soon as it has been copied into the shared-memory ring.
+const size_t SHM_POOL_BATCHES = 4;
+
+// Row width of synthetic data when no m is given.
+const int DEFAULT_SYNTHETIC_WIDTH = 1024;
+
+// Build the queue selected by the user ("blocking" or "spsc") for element type T.
+// The blocking queue starts with room for expected_depth items.
+template <typename T>
+std::unique_ptr<PipelineQueue<T>> make_queue(const std::string& queue_choice,
+                                             size_t capacity,
+                                             QueueFullPolicy policy,
+                                             size_t expected_depth) {
+    if (queue_choice == "spsc") {
+        return std::make_unique<SpscRingQueue<T>>(capacity, policy);
+    }
+    return std::make_unique<BlockingQueue<T>>(expected_depth);
+}
+
+// Print a one-line description of the queue; with drop_stats, also the drop counter.
+template <typename T>
+void report_queue(const PipelineQueue<T>& queue, const std::string& prefix,
+                  const std::string& item_name, bool drop_stats) {
+    const auto* ring = dynamic_cast<const SpscRingQueue<T>*>(&queue);
+    if (!drop_stats) {
+        if (ring) {
+            std::cout << prefix << "Queue: SPSC ring, capacity " << ring->capacity() << " " << item_name << std::endl;
+        } else {
+            std::cout << prefix << "Queue: blocking (unbounded)" << std::endl;
+        }
+    } else if (ring && ring->policy() == QueueFullPolicy::DropOldest) {
+        std::cout << prefix << "SPSC queue dropped " << ring->dropped_count() << " " << item_name << " (drop-oldest policy)." << std::endl;
+    }
+}
+
+} // namespace
+
+Lane::Lane(int id, const LaneConfig& config, ResultSink& sink, const std::string& log_prefix)
+    : id_(id),
+      config_(config),
+      prefix_(log_prefix),
+      sink_(sink),
+      calibration_failed_(false) {
+    if (config_.numa_node < 0 && config_.generator_cpu < 0) {
+        build();
+        return;
+    }
+    // Build where the generator will run, so first touch places the pool,
+    // the ring and the stage buffers on the lane's node.
+    std::thread builder([this] {
+        place_thread(config_.generator_cpu);
+        build();
+    });
+    builder.join();
+}
+
+bool Lane::place_thread(int cpu) const {
+    if (cpu >= 0) {
+        return pin_current_thread_to_cpu(cpu);
+    } else if (config_.numa_node >= 0) {
+        return bind_current_thread_to_node(config_.numa_node);
+    }
+    return true;
+}
+
+void Lane::setup_stage_thread(size_t slot, int cpu) {
+    bool pinned = place_thread(cpu);
+    if (!config_.realtime.enabled) {
+        return;
+    }
+    RealtimeThreadStatus& status = realtime_status_[slot];
+    status.cpu = cpu;
+    status.pinned = cpu >= 0 && pinned;
+    if (config_.realtime.fifo_priority > 0) {
+        status.fifo = set_current_thread_fifo(config_.realtime.fifo_priority, status.fifo_error);
+    }
+    std::lock_guard<std::mutex> lock(realtime_mutex_);
+    if (--realtime_pending_ == 0) {
+        realtime_ready_.notify_one();
+    }
+}
+
+void Lane::build() {
+    const std::string source = config_.csv_filepath;
+    if (source.empty()) {
+        config_.prefetch.depth = 0; // Nothing to read
+    }
+    // Replay a recording at the T it was captured with. T is per item, so it
+    // is scaled when this lane's items (pairs or batches) are a different size.
+    ScanHeader replay;
+    if (!source.empty() && config_.pacer_config.strategy != PacingStrategy::None &&
+        ScanReader::read_header(source, replay) && replay.period_ns > 0 && replay.item_pixels > 0) {
+        size_t item_pixels = config_.use_batches ? config_.batch_size : 2;
+        config_.t_ns = std::max(1LL, static_cast<long long>(replay.period_ns * static_cast<double>(item_pixels) / replay.item_pixels));
+    }
+    if (config_.use_batches) {
+        if (!config_.shm_publish.empty()) {
+            shm_ring_ = std::make_unique<ShmRing>();
+            if (!shm_ring_->create(config_.shm_publish, config_.shm_slots, config_.batch_size, config_.m, config_.t_ns)) {
+                std::cerr << prefix_ << "Publishing disabled; filtering in this process." << std::endl;
+                shm_ring_.reset();
+                config_.shm_publish.clear();
+            }
+        }
+        // The blocking queue never holds more batches than the pool has.
+        if (!shm_ring_) {
+            batch_queue_ = make_queue<PixelBatch*>(config_.queue_choice, config_.queue_capacity, config_.full_policy,
+                                                   DEFAULT_POOL_BATCHES);
+        }
+        // Enough batches to fill the ring plus one held by each stage; the
+        // unbounded queue is bounded by the pool instead.
+        size_t pool_batches = shm_ring_ ? SHM_POOL_BATCHES : DEFAULT_POOL_BATCHES;
+        if (auto* ring = dynamic_cast<SpscRingQueue<PixelBatch*>*>(batch_queue_.get())) {
+            pool_batches = ring->capacity() + 2;
+        }
+        // All batch payloads in one arena, mapped and faulted in here.
+        size_t arena_bytes = BatchPool::storage_bytes(pool_batches, config_.batch_size);
+        arena_ = std::make_unique<Arena>(arena_bytes, config_.hugepages);
+        auto* storage = static_cast<uint8_t*>(arena_->allocate(arena_bytes));
+        if (storage) {
+            batch_pool_ = std::make_unique<BatchPool>(pool_batches, config_.batch_size, storage);
+        } else {
+            batch_pool_ = std::make_unique<BatchPool>(pool_batches, config_.batch_size);
+        }
+        if (shm_ring_) {
+            batch_queue_ = std::make_unique<ShmBatchQueue>(*shm_ring_, *batch_pool_, config_.full_policy);
+        }
+        if (auto* ring = dynamic_cast<SpscRingQueue<PixelBatch*>*>(batch_queue_.get())) {
+            BatchPool* pool = batch_pool_.get();
+            ring->set_drop_handler([pool](PixelBatch*&& batch) { pool->release(batch); });
+        }
+        data_gen_ = std::make_unique<DataGenerator>(*batch_queue_, *batch_pool_, config_.m, config_.t_ns, source, config_.prefetch,
+                                                     config_.shm_wait_ms);
+        if (shm_ring_) {
+            config_.flat_field_path.clear(); // Up to the consumer
+        }
+        auto flat_field = std::make_unique<FlatFieldStage>();
+        if (!config_.flat_field_path.empty() && !flat_field->load(config_.flat_field_path)) {
+            // Running uncorrected would pass a miscalibrated line as a clean run.
+            calibration_failed_ = true;
+            config_.flat_field_path.clear();
+        }
+        if (!config_.flat_field_path.empty()) {
+            if (config_.m > 0 && flat_field->columns() != static_cast<size_t>(config_.m)) {
+                std::cerr << prefix_ << "Warning: calibration has " << flat_field->columns()
+                          << " columns but rows are " << config_.m << " pixels wide." << std::endl;
+            }
+            // The pipeline pops the queue; the filter only sees the batches handed to it.
+            filter_thresh_ = std::make_unique<FilterThreshold>(*batch_pool_, config_.tv, config_.t_ns);
+            pipeline_ = std::make_unique<Pipeline>(*batch_queue_, *batch_pool_, batch_pool_->batch_count());
+            pipeline_->add_stage(std::move(flat_field))
+                      .add_stage(std::make_unique<FilterStage>(*filter_thresh_));
+        } else if (!shm_ring_) {
+            filter_thresh_ = std::make_unique<FilterThreshold>(*batch_queue_, *batch_pool_, config_.tv, config_.t_ns);
+        }
+        if (filter_thresh_) {
+            filter_thresh_->set_kernel(config_.kernel);
+            filter_thresh_->set_engine(config_.engine);
+        }
+    } else {
+        pair_queue_ = make_queue<std::pair<uint8_t, uint8_t>>(config_.queue_choice, config_.queue_capacity, config_.full_policy,
+                                                              DEFAULT_PAIR_WATERMARK);
+        data_gen_ = std::make_unique<DataGenerator>(*pair_queue_, config_.m, config_.t_ns, source, config_.prefetch, config_.shm_wait_ms);
+        filter_thresh_ = std::make_unique<FilterThreshold>(*pair_queue_, config_.tv, config_.t_ns);
+        filter_thresh_->set_kernel(config_.kernel);
+    }
+
+    data_gen_->set_random_engine(config_.random_engine);
+    if (config_.seed != 0) {
+        // Lanes given the same seed still get independent xoshiro streams.
+        data_gen_->set_seed(config_.seed, static_cast<uint64_t>(id_));
+    }
+    if (config_.synthetic && config_.csv_filepath.empty()) {
+        data_gen_->set_synthetic(config_.synthetic_config, config_.m > 0 ? config_.m : DEFAULT_SYNTHETIC_WIDTH);
+    } else {
+        config_.synthetic = false;
+    }
+    if (!config_.record_path.empty()) {
+        recorder_ = std::make_unique<ScanWriter>();
+        size_t item_pixels = config_.use_batches ? config_.batch_size : 2;
+        if (recorder_->open(config_.record_path, config_.m, config_.t_ns, item_pixels, config_.record_compressed)) {
+            data_gen_->set_recorder(recorder_.get());
+        } else {
+            std::cerr << prefix_ << "Recording disabled." << std::endl;
+            recorder_.reset();
+            config_.record_path.clear();
+        }
+    }
+    if (const ScanHeader* replay_header = data_gen_->replay_header()) {
+        if (config_.m > 0 && replay_header->m > 0 && replay_header->m != static_cast<uint32_t>(config_.m)) {
+            std::cerr << prefix_ << "Warning: recording has rows of " << replay_header->m
+                      << " pixels but m is " << config_.m << "." << std::endl;
+        }
+    }
+    if (data_gen_->shm_source()) {
+        // The publisher already paces the stream; take it as it arrives.
+        config_.pacer_config.strategy = PacingStrategy::None;
+    }
+    data_gen_->set_pacing(config_.pacer_config);
+    data_gen_->set_pixel_limit(config_.pixel_limit);
+    if (config_.backpressure.policy != OverloadPolicy::None) {
+        if (config_.backpressure.high_watermark == 0) {
+            // Shed well before the ring (or, for batches, the pool) runs out.
+            size_t high = DEFAULT_PAIR_WATERMARK;
+            if (shm_ring_) {
+                high = shm_ring_->slot_count() * 3 / 4;
+            } else if (batch_pool_) {
+                high = batch_pool_->batch_count() * 3 / 4;
+            } else if (auto* ring = dynamic_cast<SpscRingQueue<std::pair<uint8_t, uint8_t>>*>(pair_queue_.get())) {
+                high = ring->capacity() * 3 / 4;
+            }
+            config_.backpressure.high_watermark = std::max<size_t>(2, high);
+        }
+        data_gen_->set_backpressure(config_.backpressure);
+        config_.backpressure = data_gen_->backpressure().config();
+    }
+    if (!filter_thresh_) {
+        return; // Publishing: the filter runs in the consumer's process
+    }
+    filter_thresh_->set_pacing(config_.pacer_config);
+    filter_thresh_->set_sink(sink_);
+    filter_thresh_->set_hysteresis(config_.hysteresis);
+    if (config_.use_rows) {
+        config_.use_rows = filter_thresh_->set_row_mode(config_.m, config_.row_config);
+    }
+    if (config_.filter_workers > 0 && !filter_thresh_->set_parallel(config_.filter_workers, config_.chunk_size)) {
+        config_.filter_workers = 0;
+    }
+    if (config_.verify.enabled() && !filter_thresh_->set_verify(config_.verify, config_.m)) {
+        config_.verify = VerifyConfig();
+    }
+}
+
+void Lane::start() {
+    int filter_cpu = config_.filter_cpu;
+    if (config_.realtime.enabled) {
+        // Slot 0 is the generator, then the filter or each pipeline stage.
+        realtime_status_.assign(1, RealtimeThreadStatus());
+        realtime_status_[0].role = "generator";
+        if (shm_ring_) {
+            // No consumer thread in this process.
+        } else if (pipeline_) {
+            for (const StageStats& stage : pipeline_->stats()) {
+                realtime_status_.push_back(RealtimeThreadStatus());
+                realtime_status_.back().role = stage.name;
+            }
+        } else {
+            realtime_status_.push_back(RealtimeThreadStatus());
+            realtime_status_.back().role = "filter";
+        }
+        realtime_pending_ = realtime_status_.size();
+    }
+    data_gen_thread_ = std::thread([this] {
+        setup_stage_thread(0, config_.generator_cpu);
+        data_gen_->run();
+    });
+    if (pipeline_) {
+        // Every stage runs where the filter would.
+        pipeline_->set_thread_setup([this, filter_cpu](size_t stage) { setup_stage_thread(stage + 1, filter_cpu); });
+        pipeline_->start();
+    } else if (filter_thresh_) {
+        filter_thresh_thread_ = std::thread([this, filter_cpu] {
+            setup_stage_thread(1, filter_cpu);
+            filter_thresh_->run();
+        });
+    }
+    if (config_.realtime.enabled) {
+        std::unique_lock<std::mutex> lock(realtime_mutex_);
+        realtime_ready_.wait(lock, [this] { return realtime_pending_ == 0; });
+    }
+}
+
+void Lane::join() {
+    // Wait for DataGenerator to finish
+    // In CSV mode, it will finish when the file is processed.
+    // In random mode, it runs until the pixel limit (or indefinitely).
+    data_gen_thread_.join();
+    std::cout << prefix_ << "DataGenerator thread finished." << std::endl;
+    if (recorder_) {
+        recorder_->close();
+        std::cout << prefix_ << "Recorded " << recorder_->header().pixels << " pixels ("
+                  << recorder_->bytes_written() << " bytes) to " << recorder_->path() << std::endl;
+    }
+
+    // The generator closed its queue on the way out; the consumers drain what
+    // is left, see the queue closed and return.
+    if (shm_ring_) {
+        std::cout << prefix_ << "Published " << shm_ring_->batches_written() << " batches to shared-memory ring "
+                  << shm_ring_->name() << "." << std::endl;
+        return;
+    }
+    if (pipeline_) {
+        pipeline_->join();
+        std::cout << prefix_ << "Pipeline threads finished." << std::endl;
+        return;
+    }
+    filter_thresh_thread_.join();
+    std::cout << prefix_ << "FilterThreshold thread finished." << std::endl;
+}
+
+void Lane::stop() {
+    data_gen_->stop();
+    if (shm_ring_) {
+        shm_ring_->interrupt(); // Waiting for a consumer to free a slot
+    }
+}
+
+void Lane::report_realtime() const {
+    if (!config_.realtime.enabled) {
+        return;
+    }
+    std::vector<int> isolated = isolated_cpus();
+    for (const RealtimeThreadStatus& status : realtime_status_) {
+        std::cout << prefix_ << "Real-time " << describe_realtime_thread(status, config_.realtime, isolated) << std::endl;
+    }
+}
+
+bool Lane::report_verification() const {
+    if (!filter_thresh_ || !config_.verify.enabled()) {
+        return true;
+    }
+    std::cout << prefix_ << filter_thresh_->verification_summary() << std::endl;
+    return filter_thresh_->verifier().passed();
+}
+
+void Lane::report_setup() const {
+    if (const ScanHeader* replay = data_gen_->replay_header()) {
+        std::cout << prefix_ << "Replay Mode: " << config_.csv_filepath << ", " << replay->pixels << " pixels";
+        if (replay->m > 0) {
+            std::cout << " (" << replay->rows << " rows of " << replay->m << ")";
+        }
+        std::cout << ", recorded at T=" << replay->period_ns << "ns per " << replay->item_pixels << " pixels, "
+                  << (replay->compressed() ? "LZ4" : (data_gen_->replay_zero_copy() && config_.use_batches ? "zero-copy" : "raw"))
+                  << std::endl;
+    } else if (const ShmRing* ring = data_gen_->shm_source()) {
+        std::cout << prefix_ << "Shared-memory Mode: reading ring " << ring->name() << " of process "
+                  << ring->producer_pid() << ", " << ring->slot_count() << " slots of " << ring->slot_capacity()
+                  << " pixels, published at T=" << ring->t_ns() << "ns" << std::endl;
+    } else if (!config_.csv_filepath.empty()) {
+        std::cout << prefix_ << "CSV Mode: Processing file " << config_.csv_filepath << std::endl;
+    } else if (const SyntheticSource* synthetic = data_gen_->synthetic()) {
+        const SyntheticConfig& web = synthetic->config();
+        std::cout << prefix_ << "Synthetic Mode: rows of " << synthetic->width() << ", background "
+                  << web.background << " +/- " << web.noise << ", " << web.defects_per_mpixel
+                  << " defects/Mpixel, " << SyntheticSource::shape_name(web.shape) << " radius "
+                  << web.defect_radius << ", contrast " << web.contrast << " ("
+                  << RandomPixelSource::engine_name(config_.random_engine);
+        if (config_.seed != 0) {
+            std::cout << ", seed " << config_.seed;
+        }
+        std::cout << ")." << std::endl;
+    } else {
+        std::cout << prefix_ << "Random Mode: Generating random data ("
+                  << RandomPixelSource::engine_name(config_.random_engine);
+        if (config_.random_engine == RandomEngine::Xoshiro256pp) {
+            std::cout << " " << RandomPixelSource::xoshiro_isa() << ", stream " << id_;
+        }
+        if (config_.seed != 0) {
+            std::cout << ", seed " << config_.seed;
+        }
+        std::cout << ")." << std::endl;
+    }
+    if (config_.prefetch.depth > 0) {
+        std::cout << prefix_ << "Read-ahead: " << config_.prefetch.depth << " chunks of "
+                  << config_.prefetch.chunk_bytes / 1024 << " KiB on an I/O thread" << std::endl;
+    }
+    std::cout << prefix_ << "M=" << config_.m << ", TV=" << config_.tv << ", T=" << config_.t_ns << "ns" << std::endl;
+    const PacerConfig& pacing = data_gen_->pacer().config();
+    std::cout << prefix_ << "Pacing: " << Pacer::strategy_name(pacing.strategy);
+    if (pacing.strategy == PacingStrategy::Batched) {
+        std::cout << ", " << pacing.ops_per_deadline << " iterations per "
+                  << data_gen_->pacer().target_period_ns() << "ns deadline";
+    }
+    std::cout << std::endl;
+    if (shm_ring_) {
+        std::cout << prefix_ << "Publishing to shared-memory ring " << shm_ring_->name() << ": " << shm_ring_->slot_count()
+                  << " slots of " << shm_ring_->slot_capacity() << " pixels, "
+                  << (config_.full_policy == QueueFullPolicy::DropOldest ? "dropping new batches" : "waiting")
+                  << " when full" << std::endl;
+        std::cout << prefix_ << "Transport: batches of " << config_.batch_size << " pixels, " << batch_pool_->batch_count() << " pooled" << std::endl;
+    } else {
+        std::cout << prefix_ << "Filter kernel: " << filter_thresh_->window_size() << " taps, center "
+                  << filter_thresh_->past_elements() << std::endl;
+        if (config_.hysteresis.enabled()) {
+            std::cout << prefix_ << "Threshold: hysteresis, high " << config_.tv << ", low "
+                      << config_.tv - config_.hysteresis.band << ", minimum defect run "
+                      << std::max<size_t>(config_.hysteresis.min_run, 1) << " pixels" << std::endl;
+        }
+        if (config_.use_rows) {
+            static const char* const edge_names[] = {"clamp", "mirror", "skip"};
+            std::cout << prefix_ << "Filter layout: rows of " << config_.m << ", "
+                      << edge_names[static_cast<int>(config_.row_config.edge)]
+                      << " edges, " << filter_thresh_->window_size() << " x " << config_.row_config.lines << " kernel" << std::endl;
+        } else {
+            std::cout << prefix_ << "Filter layout: stream" << std::endl;
+        }
+        if (config_.use_batches) {
+            std::cout << prefix_ << "Transport: batches of " << config_.batch_size << " pixels, " << batch_pool_->batch_count() << " pooled" << std::endl;
+            if (arena_->used() > 0) {
+                std::cout << prefix_ << "Batch arena: " << arena_->describe() << std::endl;
+            }
+            if (filter_thresh_->engine() == FilterEngine::Simd) {
+                std::cout << prefix_ << "Filter engine: simd, " << filter_thresh_->float_kernel().description() << std::endl;
+            } else if (filter_thresh_->engine() == FilterEngine::Fixed) {
+                std::cout << prefix_ << "Filter engine: fixed-point (" << filter9_symmetric_isa() << ")" << std::endl;
+            } else {
+                std::cout << prefix_ << "Filter engine: reference" << std::endl;
+            }
+            if (config_.filter_workers > 0) {
+                std::cout << prefix_ << "Parallel filtering: " << config_.filter_workers << " workers, chunks of "
+                          << (config_.chunk_size > 0 ? config_.chunk_size : 4096) << " pixels" << std::endl;
+            }
+            if (config_.verify.enabled()) {
+                std::cout << prefix_ << "Verification: against the reference filter, ";
+                if (config_.verify.sample_every == 1) {
+                    std::cout << "every result";
+                } else {
+                    std::cout << "1 in " << config_.verify.sample_every << (config_.use_rows ? " lines" : " results");
+                }
+                std::cout << ", tolerance " << config_.verify.tolerance << std::endl;
+            }
+            if (pipeline_) {
+                std::cout << prefix_ << "Stages:";
+                for (const StageStats& stage : pipeline_->stats()) {
+                    std::cout << " -> " << stage.name;
+                }
+                std::cout << " (flat field from " << config_.flat_field_path << ")" << std::endl;
+            }
+            report_queue(*batch_queue_, prefix_, "batches", false);
+        } else {
+            std::cout << prefix_ << "Transport: pairs" << std::endl;
+            report_queue(*pair_queue_, prefix_, "pairs", false);
+        }
+    }
+    if (data_gen_->backpressure().enabled()) {
+        std::cout << prefix_ << "Overload policy: " << data_gen_->backpressure().describe() << std::endl;
+    }
+    if (recorder_) {
+        std::cout << prefix_ << "Recording to " << recorder_->path() << (recorder_->header().compressed() ? " (LZ4)" : "") << std::endl;
+    }
+    if (config_.generator_cpu >= 0 || config_.filter_cpu >= 0) {
+        std::cout << prefix_ << "Placement: generator on CPU " << config_.generator_cpu
+                  << ", filter on CPU " << config_.filter_cpu << std::endl;
+    } else if (config_.numa_node >= 0) {
+        std::cout << prefix_ << "Placement: NUMA node " << config_.numa_node << std::endl;
+    }
+}
+
+void Lane::report_stats(std::ostream& out) const {
+    out << prefix_ << "Stats DataGenerator: " << describe_stage_metrics(data_gen_->metrics()) << "\n";
+    if (filter_thresh_ && !pipeline_) {
+        // In a pipeline the filter is driven by its stage thread; see the stage report.
+        out << prefix_ << "Stats FilterThreshold: " << describe_stage_metrics(filter_thresh_->metrics()) << "\n";
+    }
+    const QueueDepthGauge& depth = data_gen_->queue_depth();
+    out << prefix_ << "Stats queue depth: current " << depth.current() << ", high water " << depth.high_water() << "\n";
+    const BackpressureController& backpressure = data_gen_->backpressure();
+    if (backpressure.enabled()) {
+        out << prefix_ << "Stats backpressure: " << backpressure.live_overloads.get() << " overloads, "
+            << backpressure.live_shed_items.get() << " items shed (" << backpressure.live_shed_pixels.get()
+            << " pixels), throttled " << backpressure.live_throttle_ns.get() / 1000 << "us\n";
+    }
+    if (config_.use_batches && filter_thresh_) {
+        out << prefix_ << "Stats latency (generated -> filtered): " << filter_thresh_->latency().summary() << "\n";
+    }
+    out.flush();
+}
+
+std::vector<StageStats> Lane::stage_stats() const {
+    return pipeline_ ? pipeline_->stats() : std::vector<StageStats>();
+}
+
+void Lane::report_drops() const {
+    if (shm_ring_) {
+        if (config_.full_policy == QueueFullPolicy::DropOldest) {
+            std::cout << prefix_ << "Shared-memory ring dropped " << shm_ring_->batches_dropped()
+                      << " batches (ring full)." << std::endl;
+        }
+    } else if (const ShmRing* ring = data_gen_->shm_source()) {
+        std::cout << prefix_ << "Shared-memory ring: read " << ring->batches_read() << " batches, lost "
+                  << ring->lost_batches() << " (" << ring->lost_pixels() << " pixels) dropped by the publisher."
+                  << std::endl;
+    } else if (config_.use_batches) {
+        report_queue(*batch_queue_, prefix_, "batches", true);
+    } else {
+        report_queue(*pair_queue_, prefix_, "pairs", true);
+    }
+    if (data_gen_->backpressure().enabled()) {
+        std::cout << prefix_ << "Backpressure: " << data_gen_->backpressure().summary() << "." << std::endl;
+    }
+}
@@ -0,0 +1,168 @@
+#ifndef LANE_H
+#define LANE_H
+
+#include "data_generator.h"
+#include "filter_threshold.h"
+#include "spsc_ring_queue.h"
+#include "pixel_batch.h"
+#include "pacer.h"
+#include "backpressure.h"
+#include "arena.h"
+#include "pipeline.h"
+#include "row_filter.h"
+#include "synthetic_source.h"
+#include "result_sink.h"
+#include "scan_file.h"
+#include "shm_ring.h"
+#include "realtime.h"
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdint>
+
+// Everything needed to build one DataGenerator -> queue -> FilterThreshold chain.
+struct LaneConfig {
+    int m = 0;
+    double tv = 0.0;
+    long long t_ns = 500;
+    std::string csv_filepath;   // Empty = random data; a scan file is replayed (at its recorded T when paced)
+    uint64_t seed = 0;          // Random data only; 0 = seed from std::random_device
+    RandomEngine random_engine = RandomEngine::Mt19937; // Xoshiro: the lane id picks its stream
+    bool synthetic = false;     // Random data only: synthetic web instead of uniform noise
+    SyntheticConfig synthetic_config;
+    PrefetchConfig prefetch;    // File input only: read-ahead on an I/O thread (depth 0 = off)
+
+    std::string queue_choice = "blocking"; // "blocking" or "spsc"
+    size_t queue_capacity = 0;
+    QueueFullPolicy full_policy = QueueFullPolicy::SpinThenPark;
+    BackpressureConfig backpressure; // Producer reaction to queue depth; 0 watermark = 3/4 of the queue
+    bool hugepages = false;     // Back the batch arena with hugepages (falls back to ordinary pages)
+    std::string shm_publish;    // Batches only: publish to this shared-memory ring instead of filtering
+    size_t shm_slots = 64;      // Slots of the published ring (rounded up to a power of two)
+    long long shm_wait_ms = SHM_ATTACH_WAIT_MS; // Source "shm:<name>": how long to wait for the publisher
+
+    bool use_batches = false;
+    size_t batch_size = 0;
+    KernelSpec kernel = default_kernel_spec(); // Horizontal window and its center tap
+    HysteresisConfig hysteresis; // Low threshold TV - band and minimum defect run
+    VerifyConfig verify;        // Batches only: check the engine against the reference filter
+    FilterEngine engine = FilterEngine::Reference;
+    size_t filter_workers = 0;  // > 0: chunked parallel filtering (batches, stream layout)
+    size_t chunk_size = 0;      // Windows per chunk; 0 = default
+    std::string flat_field_path; // Batches only: flat-field calibration; runs the filter in a Pipeline
+
+    bool use_rows = false;
+    RowFilterConfig row_config;
+
+    PacerConfig pacer_config;
+    uint64_t pixel_limit = 0;   // 0 = unlimited
+
+    std::string record_path;    // Non-empty: record the generator output to this scan file
+    bool record_compressed = false; // LZ4 chunks (needs an LZ4 build)
+
+    // Placement; -1 leaves the choice to the scheduler. A NUMA node binds both
+    // threads to the node's CPUs unless a CPU is given as well.
+    int generator_cpu = -1;
+    int filter_cpu = -1;
+    int numa_node = -1;
+    RealtimeConfig realtime;    // SCHED_FIFO for the stage threads, and their startup report
+};
+
+// One independent pipeline: its own source, queue, batch pool, filter and sink.
+// A publishing lane stops at the queue: its generator writes the batches into
+// a shared-memory ring for a lane in another process (source "shm:<name>"),
+// and it has no filter.
+// With a flat-field calibration the stages after the queue run as a Pipeline
+// (FlatFieldStage -> FilterStage), one thread each; otherwise the filter pops
+// the queue itself.
+//
+// The queue, pool and stages are built on a short-lived thread that is first
+// placed like the lane's generator thread, so with first-touch allocation the
+// lane's buffers are local to the node its threads run on.
+class Lane {
+public:
+    // sink must outlive the lane. log_prefix starts every line the lane prints.
+    Lane(int id, const LaneConfig& config, ResultSink& sink, const std::string& log_prefix = "");
+
+    Lane(const Lane&) = delete;
+    Lane& operator=(const Lane&) = delete;
+
+    // Start both stage threads. In real-time mode, returns once every stage
+    // thread has been placed and scheduled.
+    void start();
+
+    // Wait for the generator, then for the consumers to drain the queue it
+    // closed on exit. Finishes the recording, if any.
+    void join();
+
+    // Ask the generator to stop early (any thread); join() then returns once
+    // what was already queued has been filtered.
+    void stop();
+
+    // Print the lane's configuration, or (after join) its queue drop and
+    // load-shedding statistics.
+    void report_setup() const;
+    void report_drops() const;
+
+    // Real-time mode: where each stage thread runs and with which policy
+    // (after start).
+    void report_realtime() const;
+
+    // With verification, print its result (after join). Returns false if a
+    // result did not match the reference.
+    bool report_verification() const;
+
+    int id() const { return id_; }
+    const LaneConfig& config() const { return config_; }
+    const DataGenerator& generator() const { return *data_gen_; }
+    const FilterThreshold& filter() const { return *filter_thresh_; } // Not for a publishing lane
+    bool publishes() const { return shm_ring_ != nullptr; }
+    // The lane's flat-field calibration could not be loaded; it must not run.
+    bool calibration_failed() const { return calibration_failed_; }
+    const ResultSink& sink() const { return sink_; }
+
+    // Print the live stage metrics, queue depth and latency histogram. Safe
+    // while the lane is running (periodic dump) and after join.
+    void report_stats(std::ostream& out) const;
+
+    // Per-stage counters of the stage pipeline (after join); empty without one.
+    std::vector<StageStats> stage_stats() const;
+
+private:
+    void build();
+    bool place_thread(int cpu) const;
+    void setup_stage_thread(size_t slot, int cpu);
+
+    int id_;
+    LaneConfig config_;
+    std::string prefix_;
+    ResultSink& sink_;
+    bool calibration_failed_;
+
+    // Both stages only see the PipelineQueue interface. In batch mode the
+    // pixels live in a BatchPool and only batch pointers travel through the queue.
+    std::unique_ptr<ShmRing> shm_ring_; // Publishing lane: what its batch queue writes to
+    std::unique_ptr<PipelineQueue<std::pair<uint8_t, uint8_t>>> pair_queue_;
+    std::unique_ptr<PipelineQueue<PixelBatch*>> batch_queue_;
+    std::unique_ptr<Arena> arena_;  // Batch payloads, sized at build time
+    std::unique_ptr<BatchPool> batch_pool_;
+    std::unique_ptr<ScanWriter> recorder_;
+    std::unique_ptr<DataGenerator> data_gen_;
+    std::unique_ptr<FilterThreshold> filter_thresh_;
+    std::unique_ptr<Pipeline> pipeline_; // Declared after what its stages use
+
+    std::thread data_gen_thread_;
+    std::thread filter_thresh_thread_;
+
+    // One slot per stage thread, filled by the thread itself in start().
+    std::vector<RealtimeThreadStatus> realtime_status_;
+    std::mutex realtime_mutex_;
+    std::condition_variable realtime_ready_;
+    size_t realtime_pending_ = 0;
+};
+
+#endif // LANE_H
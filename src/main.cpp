@@ -1,12 +1,28 @@
 #include "data_generator.h"
 #include "filter_threshold.h"
-#include "blocking_queue.h"
+#include "spsc_ring_queue.h"
+#include "pixel_batch.h"
+#include "filter_kernel.h"
+#include "result_sink.h"
+#include "lane.h"
+#include "thread_affinity.h"
+#include "metrics.h"
+#include "scan_file.h"
+#include "run_options.h"
+#include "alloc_check.h"
+#include "realtime.h"
 
 #include <iostream>
 #include <string>
 #include <thread>
 #include <limits> // Required for std::numeric_limits
 #include <atomic> // For std::atomic_bool
+#include <memory> // For std::unique_ptr
+#include <vector>
+#include <chrono> // For benchmark wall time
+#include <iomanip> // For std::setprecision
+#include <mutex>
+#include <condition_variable>
 
 // Helper function to get integer input safely
 long long get_long_input(const std::string& prompt) {
@@ -42,31 +58,134 @@ double get_double_input(const std::string& prompt) {
     }
 }
 
+// Print the benchmark summary: end-to-end throughput and per-stage CPU cost,
+// per lane and (with several lanes) in aggregate.
+void report_benchmark(const std::vector<std::unique_ptr<Lane>>& lanes, double wall_seconds) {
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "\n--- Benchmark results ---" << std::endl;
+    std::cout << "Wall time: " << wall_seconds * 1e3 << " ms" << std::endl;
+    double total_pixels = 0.0;
+    double total_queue_ops = 0.0;
+    for (const auto& lane : lanes) {
+        const DataGenerator& data_gen = lane->generator();
+        std::string prefix = lanes.size() > 1 ? "Lane " + std::to_string(lane->id()) + ": " : "";
+        if (lane->publishes()) {
+            // Filtered in another process; only the source side is measured here.
+            double pixels = static_cast<double>(data_gen.pixels_emitted());
+            total_pixels += pixels;
+            std::cout << prefix << "Pixels published: " << data_gen.pixels_emitted() << std::endl;
+            if (wall_seconds > 0.0) {
+                std::cout << prefix << "Throughput: " << pixels / wall_seconds / 1e6 << " Mpixels/s" << std::endl;
+            }
+            if (pixels > 0.0) {
+                std::cout << prefix << "DataGenerator CPU time: " << static_cast<double>(data_gen.cpu_time_ns()) / 1e6
+                          << " ms (" << static_cast<double>(data_gen.cpu_time_ns()) / pixels << " ns/pixel)" << std::endl;
+            }
+            continue;
+        }
+        const FilterThreshold& filter_thresh = lane->filter();
+        std::vector<StageStats> stage_stats = lane->stage_stats();
+        double pixels = static_cast<double>(filter_thresh.pixels_filtered());
+        // With a stage pipeline the first stage pops the lane's queue.
+        uint64_t pops = stage_stats.empty() ? filter_thresh.items_popped() : stage_stats.front().batches;
+        double queue_ops = static_cast<double>(data_gen.items_pushed() + pops);
+        total_pixels += pixels;
+        total_queue_ops += queue_ops;
 
-int main() {
-    std::cout << "--- Real-time Data Processing Pipeline Simulator ---" << std::endl;
+        std::cout << prefix << "Pixels generated: " << data_gen.pixels_emitted()
+                  << ", filtered: " << filter_thresh.pixels_filtered()
+                  << ", defects: " << filter_thresh.defects_found() << std::endl;
+        if (wall_seconds > 0.0) {
+            std::cout << prefix << "Throughput: " << pixels / wall_seconds / 1e6 << " Mpixels/s" << std::endl;
+            std::cout << prefix << "Queue ops: " << static_cast<uint64_t>(queue_ops) << " ("
+                      << queue_ops / wall_seconds / 1e6 << " M ops/s, push + pop)" << std::endl;
+        }
+        struct StageCpu {
+            std::string name;
+            long long cpu_ns;
+        };
+        std::vector<StageCpu> stages = {{"DataGenerator", data_gen.cpu_time_ns()}};
+        if (stage_stats.empty()) {
+            stages.push_back({"FilterThreshold", filter_thresh.cpu_time_ns()});
+        }
+        for (const StageStats& stage : stage_stats) {
+            stages.push_back({stage.name, stage.cpu_time_ns});
+        }
+        for (const auto& stage : stages) {
+            std::cout << prefix << stage.name << " CPU time: " << static_cast<double>(stage.cpu_ns) / 1e6 << " ms";
+            if (pixels > 0.0) {
+                std::cout << " (" << static_cast<double>(stage.cpu_ns) / pixels << " ns/pixel";
+                if (wall_seconds > 0.0) {
+                    std::cout << ", " << static_cast<double>(stage.cpu_ns) / 1e9 / wall_seconds * 100.0 << "% of wall";
+                }
+                std::cout << ")";
+            }
+            std::cout << std::endl;
+        }
+    }
+    if (lanes.size() > 1 && wall_seconds > 0.0) {
+        std::cout << "All " << lanes.size() << " lanes: " << total_pixels / wall_seconds / 1e6 << " Mpixels/s, "
+                  << total_queue_ops / wall_seconds / 1e6 << " M queue ops/s" << std::endl;
+    }
+}
 
-    // Get user inputs
-    int m = static_cast<int>(get_long_input("Enter number of columns (m, for CSV mode, 0 for non-CSV relevant): "));
-    double tv = get_double_input("Enter Threshold Value (TV): ");
-    long long t_ns = get_long_input("Enter Process Time T (in nanoseconds, >= 500): ");
-    if (t_ns < 500) {
-        std::cerr << "Warning: T is less than 500ns. Setting to 500ns." << std::endl;
-        t_ns = 500;
+// Build the result sink for one lane. File sinks of a multi-lane run get a
+// ".laneN" suffix. Returns nullptr if the output file cannot be opened.
+std::unique_ptr<ResultSink> make_sink(const std::string& sink_choice, const std::string& output_path,
+                                      uint64_t sample_every, int m, int lane, int lane_count) {
+    std::string path = lane_count > 1 ? output_path + ".lane" + std::to_string(lane) : output_path;
+    if (sink_choice == "text") {
+        return std::make_unique<TextSink>(std::cout);
+    } else if (sink_choice == "sampled") {
+        return std::make_unique<TextSink>(std::cout, sample_every);
+    } else if (sink_choice == "bitmap") {
+        auto bitmap = std::make_unique<BitmapSink>(path, m);
+        if (bitmap->is_open()) {
+            return bitmap;
+        }
+    } else if (sink_choice == "rle") {
+        auto rle = std::make_unique<RleSink>(path, m);
+        if (rle->is_open()) {
+            return rle;
+        }
+    } else if (sink_choice == "events") {
+        auto events = std::make_unique<EventSink>(path, m);
+        if (events->is_open()) {
+            return events;
+        }
+    } else if (sink_choice == "regions") {
+        auto regions = std::make_unique<RegionSink>(path, m);
+        if (regions->is_open()) {
+            return regions;
+        }
+    } else {
+        return std::make_unique<NullSink>();
     }
+    return nullptr;
+}
+
+// Collect the settings through the interactive prompts (the fallback when
+// no command-line arguments are given). finish_options() resolves the defaults.
+void prompt_options(RunOptions& options) {
+    // Get user inputs
+    options.m = static_cast<int>(get_long_input("Enter number of columns (m, for CSV mode, 0 for non-CSV relevant): "));
+    options.tv = get_double_input("Enter Threshold Value (TV): ");
+    options.t_ns = get_long_input("Enter Process Time T (in nanoseconds, >= 500): ");
 
     std::string mode_choice;
     std::string csv_filepath = "";
     bool use_csv = false;
+    uint64_t random_seed = 0;
+    bool synthetic_mode = false;
 
     while (true) {
-        std::cout << "Select mode (random/csv): ";
+        std::cout << "Select mode (random, synthetic, either with :<seed>, or csv): ";
         std::cin >> mode_choice;
         std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n'); // consume newline
 
         if (mode_choice == "csv") {
             use_csv = true;
-            std::cout << "Enter CSV filepath: ";
+            std::cout << "Enter CSV or scan filepath: ";
             std::getline(std::cin, csv_filepath);
             // Basic check if filepath is empty, actual file check done in DataGenerator
             if (csv_filepath.empty()) {
@@ -74,69 +193,603 @@ int main() {
                 continue;
             }
             break;
-        } else if (mode_choice == "random") {
+        } else if (parse_generated_source(mode_choice, synthetic_mode, random_seed)) {
             use_csv = false;
             break;
         } else {
-            std::cerr << "Invalid mode. Please enter 'random' or 'csv'." << std::endl;
+            std::cerr << "Invalid mode. Please enter 'random', 'synthetic' (optionally ':<seed>') or 'csv'." << std::endl;
+        }
+    }
+
+    // Each lane is an independent generator -> queue -> filter pipeline with
+    // its own source and threshold; all other settings are shared.
+    int lane_count = static_cast<int>(get_long_input("Enter number of lanes (independent pipelines, 1 = single): "));
+    if (lane_count < 1) {
+        lane_count = 1;
+    }
+    options.lane_count = lane_count;
+    options.sources.assign(1, use_csv ? csv_filepath : mode_choice);
+    options.lane_tvs.assign(1, options.tv);
+    std::vector<std::string> lane_sources(1, use_csv ? csv_filepath : "");
+    std::vector<bool> lane_synthetic(1, synthetic_mode);
+    for (int lane = 1; lane < lane_count; ++lane) {
+        std::string source;
+        while (source.empty()) {
+            std::cout << "Lane " << lane << " source (random, synthetic, either with :<seed>, or CSV filepath): ";
+            std::getline(std::cin, source);
+        }
+        options.sources.push_back(source);
+        uint64_t seed = 0;
+        bool synthetic = false;
+        if (parse_generated_source(source, synthetic, seed)) {
+            source.clear();
+        }
+        lane_sources.push_back(source);
+        lane_synthetic.push_back(synthetic);
+        options.lane_tvs.push_back(get_double_input("Lane " + std::to_string(lane) + " Threshold Value (TV): "));
+    }
+
+    // Read-ahead for the file lanes: an I/O thread keeps chunks in flight so
+    // the paced generator loop never waits for the disk.
+    PrefetchConfig& prefetch_config = options.prefetch;
+    bool any_file = false;
+    for (const std::string& source : lane_sources) {
+        any_file = any_file || !source.empty();
+    }
+    if (any_file) {
+        long long depth = get_long_input("Enter read-ahead depth in chunks (0 = read on the generator thread): ");
+        prefetch_config.depth = depth > 0 ? static_cast<size_t>(depth) : 0;
+        if (prefetch_config.depth > 0) {
+            long long chunk_kib = get_long_input("Enter read-ahead chunk size in KiB (0 = 1024): ");
+            prefetch_config.chunk_bytes = static_cast<size_t>(chunk_kib > 0 ? chunk_kib : 1024) * 1024;
+        }
+    }
+
+    // Generator for the random lanes. xoshiro fills whole batches 8 pixels per
+    // 64-bit draw and gives lanes with the same seed independent streams.
+    bool any_random = false;
+    for (const std::string& source : lane_sources) {
+        any_random = any_random || source.empty();
+    }
+    while (any_random) {
+        std::string engine_choice;
+        std::cout << "Select random generator (mt19937/xoshiro): ";
+        std::cin >> engine_choice;
+        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        if (engine_choice == "mt19937") {
+            options.random_engine = RandomEngine::Mt19937;
+        } else if (engine_choice == "xoshiro") {
+            options.random_engine = RandomEngine::Xoshiro256pp;
+        } else {
+            std::cerr << "Invalid generator. Please enter 'mt19937' or 'xoshiro'." << std::endl;
+            continue;
+        }
+        break;
+    }
+
+    // Synthetic web, shared by all synthetic lanes.
+    SyntheticConfig& synthetic_config = options.synthetic_config;
+    bool any_synthetic = false;
+    for (bool synthetic : lane_synthetic) {
+        any_synthetic = any_synthetic || synthetic;
+    }
+    if (any_synthetic) {
+        synthetic_config.background = static_cast<int>(get_long_input("Synthetic background level (0-255): "));
+        synthetic_config.noise = static_cast<int>(get_long_input("Synthetic noise amplitude (+/-): "));
+        synthetic_config.defects_per_mpixel = get_double_input("Synthetic defects per million pixels: ");
+        synthetic_config.defect_radius = static_cast<int>(get_long_input("Synthetic defect radius in pixels: "));
+        while (true) {
+            std::string shape_choice;
+            std::cout << "Select defect shape (round/streak/scratch): ";
+            std::cin >> shape_choice;
+            std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+            if (shape_choice == "round") {
+                synthetic_config.shape = DefectShape::Round;
+            } else if (shape_choice == "streak") {
+                synthetic_config.shape = DefectShape::Streak;
+            } else if (shape_choice == "scratch") {
+                synthetic_config.shape = DefectShape::Scratch;
+            } else {
+                std::cerr << "Invalid shape. Please enter 'round', 'streak' or 'scratch'." << std::endl;
+                continue;
+            }
+            break;
         }
+        synthetic_config.contrast = static_cast<int>(get_double_input("Synthetic defect contrast (added to background, may be negative): "));
     }
 
-    // Shared flag to indicate producer (DataGenerator) has finished
-    // This needs to be atomic if accessed by DataGenerator itself to set it,
-    // but here DataGenerator's run() exits and main thread sets it.
-    // For FilterThreshold to read it safely while DataGenerator might modify it (if DataGen set it),
-    // it should be atomic. Let's make it atomic for good practice.
-    // However, in the current design, DataGenerator.run() finishes, then main sets this flag.
-    // FilterThreshold reads it. So, it's more about visibility after DataGenerator thread joins.
-    // For simplicity in this version, a simple bool is used and set after DataGenerator's thread join.
-    // A more robust solution for Filter to stop early might use an atomic flag set by DataGen before exiting.
-    // Let's use a simple bool and manage its state from main.
-    bool producer_is_finished = false;
+    // Thread placement: pin each lane's two threads to cores, or to a NUMA node.
+    std::string& placement_choice = options.placement;
+    while (true) {
+        std::cout << "Select thread placement (none/cores/numa): ";
+        std::cin >> placement_choice;
+        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        if (placement_choice == "cores") {
+            std::string cpu_list;
+            std::cout << "Enter CPUs, generator then filter per lane (e.g. 0,1,2,3; blank = consecutive): ";
+            std::getline(std::cin, cpu_list);
+            options.placement_cpus = parse_cpu_list(cpu_list);
+            break;
+        } else if (placement_choice == "none" || placement_choice == "numa") {
+            break;
+        }
+        std::cerr << "Invalid placement. Please enter 'none', 'cores' or 'numa'." << std::endl;
+    }
 
+    std::string& queue_choice = options.queue_choice;
+    QueueFullPolicy& full_policy = options.full_policy;
 
-    // Initialize components
-    BlockingQueue<std::pair<uint8_t, uint8_t>> data_queue;
+    while (true) {
+        std::cout << "Select queue type (blocking/spsc): ";
+        std::cin >> queue_choice;
+        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n'); // consume newline
 
-    DataGenerator data_gen(data_queue, m, t_ns, use_csv ? csv_filepath : "");
-    // Pass the reference to the shared flag.
-    FilterThreshold filter_thresh(data_queue, tv, t_ns, producer_is_finished);
+        if (queue_choice == "blocking") {
+            break;
+        } else if (queue_choice == "spsc") {
+            options.queue_capacity = static_cast<size_t>(get_long_input("Enter SPSC queue capacity (rounded up to a power of two, 0 = 1024): "));
+            std::string policy_choice;
+            while (true) {
+                std::cout << "Select full-queue policy (block/spin/drop): ";
+                std::cin >> policy_choice;
+                std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+                if (policy_choice == "block") {
+                    full_policy = QueueFullPolicy::Block;
+                } else if (policy_choice == "spin") {
+                    full_policy = QueueFullPolicy::SpinThenPark;
+                } else if (policy_choice == "drop") {
+                    full_policy = QueueFullPolicy::DropOldest;
+                } else {
+                    std::cerr << "Invalid policy. Please enter 'block', 'spin' or 'drop'." << std::endl;
+                    continue;
+                }
+                break;
+            }
+            break;
+        } else {
+            std::cerr << "Invalid queue type. Please enter 'blocking' or 'spsc'." << std::endl;
+        }
+    }
 
+    BackpressureConfig& backpressure = options.backpressure;
+    while (true) {
+        std::string overload_choice;
+        std::cout << "Select overload policy (none/throttle/drop/decimate): ";
+        std::cin >> overload_choice;
+        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        if (overload_choice == "none") {
+            backpressure.policy = OverloadPolicy::None;
+        } else if (overload_choice == "throttle") {
+            backpressure.policy = OverloadPolicy::Throttle;
+        } else if (overload_choice == "drop") {
+            backpressure.policy = OverloadPolicy::DropLines;
+        } else if (overload_choice == "decimate") {
+            backpressure.policy = OverloadPolicy::Decimate;
+        } else {
+            std::cerr << "Invalid policy. Please enter 'none', 'throttle', 'drop' or 'decimate'." << std::endl;
+            continue;
+        }
+        break;
+    }
+    if (backpressure.policy != OverloadPolicy::None) {
+        backpressure.high_watermark = static_cast<size_t>(get_long_input("Enter high watermark in queued items (0 = 3/4 of the queue): "));
+        backpressure.low_watermark = static_cast<size_t>(get_long_input("Enter low watermark in queued items (0 = half the high watermark): "));
+        if (backpressure.policy == OverloadPolicy::Decimate) {
+            backpressure.decimate_keep = static_cast<size_t>(get_long_input("Keep one line in N while overloaded, N: "));
+        }
+    }
 
-    std::cout << "\nStarting simulation..." << std::endl;
-    std::cout << "Press Ctrl+C to stop if in continuous random mode." << std::endl;
-    if(use_csv) {
-        std::cout << "CSV Mode: Processing file " << csv_filepath << std::endl;
-    } else {
-        std::cout << "Random Mode: Generating random data." << std::endl;
+    std::string transport_choice;
+    FilterEngine& filter_engine = options.engine;
+
+    while (true) {
+        std::cout << "Select transport (pair/batch): ";
+        std::cin >> transport_choice;
+        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+
+        if (transport_choice == "pair") {
+            break;
+        } else if (transport_choice == "batch") {
+            options.batch_size = static_cast<size_t>(get_long_input("Enter batch size in pixels (0 = one row of m): "));
+            std::string engine_choice;
+            while (true) {
+                std::cout << "Select filter engine (reference/simd/fixed): ";
+                std::cin >> engine_choice;
+                std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+                if (engine_choice == "reference") {
+                    filter_engine = FilterEngine::Reference;
+                } else if (engine_choice == "simd") {
+                    filter_engine = FilterEngine::Simd;
+                } else if (engine_choice == "fixed") {
+                    filter_engine = FilterEngine::Fixed;
+                } else {
+                    std::cerr << "Invalid engine. Please enter 'reference', 'simd' or 'fixed'." << std::endl;
+                    continue;
+                }
+                break;
+            }
+            options.filter_workers = static_cast<size_t>(get_long_input("Enter filter worker threads (0 = filter on the stage thread): "));
+            if (options.filter_workers > 0) {
+                options.chunk_size = static_cast<size_t>(get_long_input("Enter chunk size in pixels (0 = 4096): "));
+            }
+            // An optional correction stage in front of the filter.
+            std::cout << "Enter flat-field calibration CSV (dark line, gain line; blank = none): ";
+            std::getline(std::cin, options.flat_field_path);
+            break;
+        } else {
+            std::cerr << "Invalid transport. Please enter 'pair' or 'batch'." << std::endl;
+        }
     }
-    std::cout << "M=" << m << ", TV=" << tv << ", T=" << t_ns << "ns" << std::endl;
+    options.use_batches = (transport_choice == "batch");
 
+    // The horizontal window: inline taps or a kernel file, any length and center.
+    while (true) {
+        std::string kernel_text;
+        std::cout << "Enter filter kernel (taps t0,t1,...[@center], a kernel file, or blank = default 9-tap): ";
+        std::getline(std::cin, kernel_text);
+        if (kernel_text.empty()) {
+            break;
+        }
+        std::string error;
+        if (read_kernel_option(kernel_text, options.kernel, error)) {
+            break;
+        }
+        std::cerr << "Invalid kernel: " << error << std::endl;
+    }
 
-    // Create and start threads
-    std::thread data_gen_thread(&DataGenerator::run, &data_gen);
-    std::thread filter_thresh_thread(&FilterThreshold::run, &filter_thresh);
+    // Two-level thresholding against flicker around TV.
+    while (true) {
+        std::string hysteresis_text;
+        std::cout << "Enter hysteresis as band below TV[,minimum run in pixels] (blank = single threshold): ";
+        std::getline(std::cin, hysteresis_text);
+        if (hysteresis_text.empty()) {
+            break;
+        }
+        std::string error;
+        if (parse_hysteresis_option(hysteresis_text, options.hysteresis, error)) {
+            break;
+        }
+        std::cerr << "Invalid hysteresis: " << error << std::endl;
+    }
+
+    // Row-aware filtering keeps the window inside each line of m pixels.
+    RowFilterConfig& row_config = options.row_config;
+    while (options.m > 0) {
+        std::string layout_choice;
+        std::cout << "Select filter layout (stream/rows): ";
+        std::cin >> layout_choice;
+        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        if (layout_choice == "stream") {
+            break;
+        } else if (layout_choice != "rows") {
+            std::cerr << "Invalid layout. Please enter 'stream' or 'rows'." << std::endl;
+            continue;
+        }
+        options.use_rows = true;
+        while (true) {
+            std::string edge_choice;
+            std::cout << "Select row edge mode (clamp/mirror/skip): ";
+            std::cin >> edge_choice;
+            std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+            if (edge_choice == "clamp") {
+                row_config.edge = EdgeMode::Clamp;
+            } else if (edge_choice == "mirror") {
+                row_config.edge = EdgeMode::Mirror;
+            } else if (edge_choice == "skip") {
+                row_config.edge = EdgeMode::Skip;
+            } else {
+                std::cerr << "Invalid edge mode. Please enter 'clamp', 'mirror' or 'skip'." << std::endl;
+                continue;
+            }
+            break;
+        }
+        while (true) {
+            row_config.lines = static_cast<size_t>(get_long_input("Enter vertical kernel height K (odd, 1 = horizontal only): "));
+            if (row_config.lines % 2 == 1) {
+                break;
+            }
+            std::cerr << "K must be odd." << std::endl;
+        }
+        break;
+    }
+
+    // Benchmark runs unpaced over a fixed pixel count with per-pixel output
+    // suppressed, and reports what the pipeline sustained.
+    while (true) {
+        std::string run_choice;
+        std::cout << "Select run type (simulate/benchmark): ";
+        std::cin >> run_choice;
+        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        if (run_choice == "simulate") {
+            break;
+        } else if (run_choice == "benchmark") {
+            options.benchmark = true;
+            options.benchmark_pixels = static_cast<uint64_t>(get_long_input(
+                use_csv ? "Enter pixel count (0 = whole file): "
+                        : "Enter pixel count (0 = 10000000): "));
+            break;
+        } else {
+            std::cerr << "Invalid run type. Please enter 'simulate' or 'benchmark'." << std::endl;
+        }
+    }
+
+    // Pacing: how each stage keeps its iterations T apart.
+    PacerConfig& pacer_config = options.pacer_config;
+    while (!options.benchmark) {
+        std::string pacing_choice;
+        std::cout << "Select pacing (sleep/hybrid/spin/batched): ";
+        std::cin >> pacing_choice;
+        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        if (pacing_choice == "sleep") {
+            pacer_config.strategy = PacingStrategy::Sleep;
+        } else if (pacing_choice == "hybrid") {
+            pacer_config.strategy = PacingStrategy::HybridSpin;
+        } else if (pacing_choice == "spin") {
+            pacer_config.strategy = PacingStrategy::BusySpin;
+        } else if (pacing_choice == "batched") {
+            pacer_config.strategy = PacingStrategy::Batched;
+            pacer_config.ops_per_deadline = static_cast<size_t>(get_long_input("Enter iterations per deadline (N, deadlines N*T apart): "));
+        } else {
+            std::cerr << "Invalid pacing. Please enter 'sleep', 'hybrid', 'spin' or 'batched'." << std::endl;
+            continue;
+        }
+        break;
+    }
+
+    // Output sink for the per-pixel results. Binary sinks write to a file.
+    std::string& sink_choice = options.sink_choice;
+    std::string& output_path = options.output_path;
+    while (true) {
+        std::cout << "Select output sink (text/sampled/bitmap/rle/events/regions/null): ";
+        std::cin >> sink_choice;
+        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        if (sink_choice == "text" || sink_choice == "null") {
+            break;
+        } else if (sink_choice == "sampled") {
+            options.sample_every = static_cast<uint64_t>(get_long_input("Print every Nth result (N): "));
+            break;
+        } else if (sink_choice == "bitmap" || sink_choice == "rle" || sink_choice == "events" || sink_choice == "regions") {
+            std::cout << "Enter output filepath: ";
+            std::getline(std::cin, output_path);
+            if (output_path.empty()) {
+                std::cerr << "Output filepath cannot be empty." << std::endl;
+                continue;
+            }
+            break;
+        } else {
+            std::cerr << "Invalid sink. Please enter 'text', 'sampled', 'bitmap', 'rle', 'events', 'regions' or 'null'." << std::endl;
+        }
+    }
+
+    // Optional recording of what the generators push, for later replay.
+    std::cout << "Record input to a scan file (blank = none): ";
+    std::getline(std::cin, options.record_path);
+    while (!options.record_path.empty() && scan_lz4_available()) {
+        std::string compress_choice;
+        std::cout << "Compress the recording with LZ4 (yes/no): ";
+        std::cin >> compress_choice;
+        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        if (compress_choice == "yes" || compress_choice == "no") {
+            options.record_compressed = compress_choice == "yes";
+            break;
+        }
+        std::cerr << "Invalid choice. Please enter 'yes' or 'no'." << std::endl;
+    }
+
+    // Live stage statistics (instrumented builds only); 0 reports once at exit.
+    if (STATS_ENABLED) {
+        options.stats_interval_ms = get_long_input("Enter stats dump interval in ms (0 = report at exit only): ");
+    }
+}
 
-    // Wait for DataGenerator to finish
-    // In CSV mode, it will finish when the file is processed.
-    // In random mode, it runs indefinitely until stop() is called (or program terminates).
-    // For this simulation, we'll let random mode run until Ctrl+C or similar.
-    // If it's CSV mode, data_gen_thread.join() will return when DataGenerator::run() exits.
-    data_gen_thread.join();
-    std::cout << "DataGenerator thread finished." << std::endl;
+int main(int argc, char** argv) {
+    // With arguments (flags and/or --config FILE) the run starts without a
+    // single prompt; without any, the settings are asked for interactively.
+    RunOptions options;
+    std::string error;
+    CommandLine command_line = parse_command_line(argc, argv, options, error);
+    if (command_line == CommandLine::Help) {
+        return 0;
+    }
+    if (command_line == CommandLine::Error) {
+        std::cerr << "Error: " << error << std::endl;
+        print_usage(std::cerr, argv[0]);
+        return 2;
+    }
+
+    std::cout << "--- Real-time Data Processing Pipeline Simulator ---" << std::endl;
+    if (command_line == CommandLine::Prompt) {
+        prompt_options(options);
+    }
+    finish_options(options);
+    int m = options.m;
+    int lane_count = options.lane_count;
+    bool benchmark = options.benchmark;
+    uint64_t benchmark_pixels = options.benchmark_pixels;
+
+    // Settings shared by every lane.
+    LaneConfig base_config;
+    base_config.m = m;
+    base_config.t_ns = options.t_ns;
+    base_config.random_engine = options.random_engine;
+    base_config.synthetic_config = options.synthetic_config;
+    base_config.prefetch = options.prefetch;
+    base_config.queue_choice = options.queue_choice;
+    base_config.queue_capacity = options.queue_capacity;
+    base_config.full_policy = options.full_policy;
+    base_config.backpressure = options.backpressure;
+    base_config.hugepages = options.hugepages;
+    base_config.shm_slots = options.shm_slots;
+    base_config.shm_wait_ms = options.shm_wait_ms;
+    base_config.realtime = options.realtime;
+    base_config.use_batches = options.use_batches;
+    base_config.batch_size = options.batch_size;
+    base_config.kernel = options.kernel;
+    base_config.hysteresis = options.hysteresis;
+    base_config.verify = options.verify;
+    base_config.engine = options.engine;
+    base_config.filter_workers = options.filter_workers;
+    base_config.chunk_size = options.chunk_size;
+    base_config.flat_field_path = options.flat_field_path;
+    base_config.use_rows = options.use_rows;
+    base_config.row_config = options.row_config;
+    base_config.pacer_config = options.pacer_config;
+    base_config.pixel_limit = benchmark ? benchmark_pixels : 0;
 
-    // Once DataGenerator is finished, signal FilterThreshold.
-    // This approach is simple: main thread acts as coordinator.
-    producer_is_finished = true;
-    std::cout << "Signaled FilterThreshold that producer is finished." << std::endl;
+    // Lock memory before the lanes are built, so their buffers are faulted in
+    // as they are mapped rather than on first use.
+    bool memory_locked = false;
+    std::string lock_error;
+    if (options.realtime.enabled) {
+        memory_locked = lock_process_memory(lock_error);
+    }
+
+    int node_count = numa_node_count();
+    int cpu_count = available_cpu_count();
+    std::vector<std::unique_ptr<ResultSink>> sinks;
+    std::vector<std::unique_ptr<Lane>> lanes;
+    for (int lane = 0; lane < lane_count; ++lane) {
+        LaneConfig config = base_config;
+        const LaneSource& source = options.lanes[lane];
+        config.csv_filepath = source.path;
+        config.seed = source.seed;
+        config.synthetic = source.synthetic;
+        config.tv = source.tv;
+        if (!options.record_path.empty()) {
+            config.record_path = lane_count > 1 ? options.record_path + ".lane" + std::to_string(lane) : options.record_path;
+            config.record_compressed = options.record_compressed;
+        }
+        if (!options.shm_publish.empty()) {
+            config.shm_publish = lane_count > 1 ? options.shm_publish + ".lane" + std::to_string(lane) : options.shm_publish;
+        }
+        const std::vector<int>& placement_cpus = options.placement_cpus;
+        if (options.placement == "cores") {
+            size_t first = 2 * static_cast<size_t>(lane);
+            config.generator_cpu = first < placement_cpus.size() ? placement_cpus[first] : static_cast<int>(first) % cpu_count;
+            config.filter_cpu = first + 1 < placement_cpus.size() ? placement_cpus[first + 1] : static_cast<int>(first + 1) % cpu_count;
+        } else if (options.placement == "numa") {
+            config.numa_node = lane % node_count;
+        }
+        if (options.realtime.fifo_priority > 0 && config.shm_publish.empty() && config.generator_cpu == config.filter_cpu) {
+            std::cerr << "Warning: Lane " << lane << " runs both SCHED_FIFO stages on CPU " << config.generator_cpu
+                      << "; a spinning stage starves the other. Give each stage its own CPU with --cpus." << std::endl;
+        }
+
+        std::unique_ptr<ResultSink> sink = make_sink(options.sink_choice, options.output_path, options.sample_every, m, lane, lane_count);
+        if (!sink) {
+            std::cerr << "Could not create the output sink, using the null sink for lane " << lane << "." << std::endl;
+            sink = std::make_unique<NullSink>();
+        }
+        std::string prefix = lane_count > 1 ? "Lane " + std::to_string(lane) + ": " : "";
+        lanes.push_back(std::make_unique<Lane>(lane, config, *sink, prefix));
+        sinks.push_back(std::move(sink));
+    }
+    // A supervisor restarting the process must not mistake a missing input
+    // (no publisher on a shm: ring, an unreadable calibration) for a clean,
+    // empty run.
+    for (size_t i = 0; i < lanes.size(); ++i) {
+        std::string lane_name = lane_count > 1 ? "Lane " + std::to_string(i) + ": " : "";
+        if (lanes[i]->generator().source_failed()) {
+            std::cerr << "Error: " << lane_name << "the data source could not be opened, not starting." << std::endl;
+            return 5;
+        }
+        if (lanes[i]->calibration_failed()) {
+            std::cerr << "Error: " << lane_name << "the flat-field calibration could not be loaded, not starting." << std::endl;
+            return 5;
+        }
+    }
+
+    std::cout << "\nStarting simulation..." << std::endl;
+    std::cout << "Press Ctrl+C to stop if in continuous random mode." << std::endl;
+    for (const auto& lane : lanes) {
+        lane->report_setup();
+    }
+    if (options.realtime.enabled) {
+        if (memory_locked) {
+            std::cout << "Real-time memory: locked and prefaulted (mlockall), heap kept mapped" << std::endl;
+        } else {
+            std::cout << "Real-time memory: not locked (" << lock_error << ")" << std::endl;
+        }
+    }
+    if (benchmark) {
+        std::cout << "Benchmark: unpaced, "
+                  << (benchmark_pixels > 0 ? std::to_string(benchmark_pixels) : std::string("all"))
+                  << " pixels" << (lane_count > 1 ? " per lane" : "") << std::endl;
+    }
 
+    // Only the stage threads' steady state counts (see alloc_check.h).
+    alloc_check_arm(options.alloc_check);
+    auto start_time = std::chrono::steady_clock::now();
+    // Create and start threads
+    for (auto& lane : lanes) {
+        lane->start();
+    }
+    for (const auto& lane : lanes) {
+        lane->report_realtime();
+    }
+    // Periodic stats dump, reading the lanes' live metrics while they run.
+    std::mutex dump_mutex;
+    std::condition_variable dump_wakeup;
+    bool lanes_done = false;
+    std::thread stats_dumper;
+    long long stats_interval_ms = options.stats_interval_ms;
+    if (stats_interval_ms > 0) {
+        stats_dumper = std::thread([&] {
+            std::unique_lock<std::mutex> lock(dump_mutex);
+            while (!dump_wakeup.wait_for(lock, std::chrono::milliseconds(stats_interval_ms), [&] { return lanes_done; })) {
+                for (const auto& lane : lanes) {
+                    lane->report_stats(std::cout);
+                }
+            }
+        });
+    }
+    // Each lane joins its generator, then waits for its consumers to drain the closed queue.
+    for (auto& lane : lanes) {
+        lane->join();
+    }
+    double wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+    if (stats_dumper.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(dump_mutex);
+            lanes_done = true;
+        }
+        dump_wakeup.notify_one();
+        stats_dumper.join();
+    }
 
-    // Wait for FilterThreshold to finish processing remaining items.
-    // FilterThreshold's run loop will exit once producer_is_finished is true AND queue is empty.
-    filter_thresh_thread.join();
-    std::cout << "FilterThreshold thread finished." << std::endl;
+    bool verified = true;
+    for (size_t i = 0; i < lanes.size(); ++i) {
+        lanes[i]->report_drops();
+        verified = lanes[i]->report_verification() && verified;
+        if (!lanes[i]->publishes()) {
+            std::cout << (lane_count > 1 ? "Lane " + std::to_string(i) + ": " : "") << "Output: " << sinks[i]->summary() << std::endl;
+        }
+    }
+    if (benchmark) {
+        report_benchmark(lanes, wall_seconds);
+    }
+    if (STATS_ENABLED) {
+        std::cout << "\n--- Stage statistics ---" << std::endl;
+        for (const auto& lane : lanes) {
+            lane->report_stats(std::cout);
+        }
+    }
 
     std::cout << "\nSimulation complete." << std::endl;
 
+    if (options.alloc_check) {
+        alloc_check_arm(false);
+        uint64_t allocations = alloc_check_violations();
+        if (allocations > 0) {
+            std::cerr << "Allocation check failed: " << allocations << " allocations after warm-up (the first of "
+                      << alloc_check_first_size() << " bytes)." << std::endl;
+            return 3;
+        }
+        std::cout << "Allocation check passed: no allocations after warm-up." << std::endl;
+    }
+    if (options.verify.required && !verified) {
+        std::cerr << "Verification failed: the filter engine does not match the reference." << std::endl;
+        return 4;
+    }
     return 0;
 }
@@ -0,0 +1,109 @@
+#include "metrics.h"
+#include <iomanip>
+#include <sstream>
+
+#ifdef PIPELINE_STATS
+
+size_t LatencyHistogram::bucket_of(uint64_t value) {
+    const uint64_t sub_count = uint64_t(1) << SUB_BITS;
+    if (value < sub_count) {
+        return static_cast<size_t>(value); // Group 0 is exact
+    }
+    int magnitude = 63 - __builtin_clzll(value); // floor(log2(value)) >= SUB_BITS
+    if (magnitude >= MAX_BITS) {
+        return BUCKETS - 1;
+    }
+    size_t group = static_cast<size_t>(magnitude - SUB_BITS + 1);
+    size_t sub = static_cast<size_t>((value >> (magnitude - SUB_BITS)) & (sub_count - 1));
+    return (group << SUB_BITS) + sub;
+}
+
+uint64_t LatencyHistogram::bucket_upper(size_t bucket) {
+    const uint64_t sub_count = uint64_t(1) << SUB_BITS;
+    size_t group = bucket >> SUB_BITS;
+    uint64_t sub = bucket & (sub_count - 1);
+    if (group == 0) {
+        return sub;
+    }
+    // Bucket covers [(32 + sub) << (group - 1), (33 + sub) << (group - 1)).
+    return ((sub_count + sub + 1) << (group - 1)) - 1;
+}
+
+void LatencyHistogram::record(int64_t value_ns) {
+    uint64_t value = value_ns > 0 ? static_cast<uint64_t>(value_ns) : 0;
+    std::atomic<uint64_t>& bucket = buckets_[bucket_of(value)];
+    bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    count_.store(count_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    sum_.store(sum_.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    int64_t signed_value = static_cast<int64_t>(value);
+    if (signed_value < min_.load(std::memory_order_relaxed)) {
+        min_.store(signed_value, std::memory_order_relaxed);
+    }
+    if (signed_value > max_.load(std::memory_order_relaxed)) {
+        max_.store(signed_value, std::memory_order_relaxed);
+    }
+}
+
+double LatencyHistogram::mean() const {
+    uint64_t n = count();
+    return n > 0 ? static_cast<double>(sum_.load(std::memory_order_relaxed)) / static_cast<double>(n) : 0.0;
+}
+
+int64_t LatencyHistogram::percentile(double percent) const {
+    // Work on the bucket counts themselves, so a concurrent writer can at
+    // worst make the answer one sample stale.
+    uint64_t total = 0;
+    for (const auto& bucket : buckets_) {
+        total += bucket.load(std::memory_order_relaxed);
+    }
+    if (total == 0) {
+        return 0;
+    }
+    double wanted = percent / 100.0 * static_cast<double>(total);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKETS; ++i) {
+        seen += buckets_[i].load(std::memory_order_relaxed);
+        if (seen > 0 && static_cast<double>(seen) >= wanted) {
+            int64_t upper = static_cast<int64_t>(bucket_upper(i));
+            int64_t largest = max();
+            return upper < largest ? upper : largest;
+        }
+    }
+    return max();
+}
+
+std::string LatencyHistogram::summary() const {
+    std::ostringstream out;
+    out << "n=" << count();
+    if (count() == 0) {
+        return out.str();
+    }
+    out << std::fixed << std::setprecision(1)
+        << ", min " << min() / 1e3 << "us"
+        << ", p50 " << percentile(50.0) / 1e3 << "us"
+        << ", p90 " << percentile(90.0) / 1e3 << "us"
+        << ", p99 " << percentile(99.0) / 1e3 << "us"
+        << ", p99.9 " << percentile(99.9) / 1e3 << "us"
+        << ", max " << max() / 1e3 << "us"
+        << ", mean " << mean() / 1e3 << "us";
+    return out.str();
+}
+
+#endif // PIPELINE_STATS
+
+std::string describe_stage_metrics(const StageMetrics& metrics) {
+    if (!STATS_ENABLED) {
+        return "stats compiled out";
+    }
+    std::ostringstream out;
+    double busy_ms = static_cast<double>(metrics.busy_ns.get()) / 1e6;
+    double idle_ms = static_cast<double>(metrics.idle_ns.get()) / 1e6;
+    out << metrics.items.get() << " items, " << metrics.pixels.get() << " pixels, "
+        << std::fixed << std::setprecision(3)
+        << "busy " << busy_ms << " ms, idle " << idle_ms << " ms";
+    if (busy_ms + idle_ms > 0.0) {
+        out << std::setprecision(1) << " (" << busy_ms / (busy_ms + idle_ms) * 100.0 << "% busy)";
+    }
+    out << ", " << metrics.deadline_misses.get() << " deadline misses";
+    return out.str();
+}
@@ -0,0 +1,186 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Stage instrumentation: counters, busy/idle time, queue depth and latency
+// histograms that another thread can read at any time (pull API).
+//
+// Every metric has exactly one writer, the thread of the stage that owns it.
+// Values are relaxed atomics updated with a plain load and store, so
+// recording costs about as much as an ordinary increment and readers never
+// see a torn value.
+//
+// Built without PIPELINE_STATS (make STATS=0), the same classes are empty:
+// every method is an empty inline function, no clock is read, and the call
+// sites compile to nothing.
+
+#ifdef PIPELINE_STATS
+constexpr bool STATS_ENABLED = true;
+#else
+constexpr bool STATS_ENABLED = false;
+#endif
+
+// steady_clock now in nanoseconds; 0 when stats are compiled out.
+inline int64_t metrics_now_ns() {
+#ifdef PIPELINE_STATS
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#else
+    return 0;
+#endif
+}
+
+#ifdef PIPELINE_STATS
+
+// Single-writer counter.
+class MetricCounter {
+public:
+    void add(uint64_t n) { value_.store(value_.load(std::memory_order_relaxed) + n, std::memory_order_relaxed); }
+    void set(uint64_t n) { value_.store(n, std::memory_order_relaxed); }
+    uint64_t get() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64_t> value_{0};
+};
+
+// HDR-style histogram of nanosecond values: log2 magnitude groups, each split
+// into 32 linear sub-buckets, so any recorded value is known to within about
+// 3% from 1 ns up to 2^42 ns (over an hour). Larger values land in the last
+// bucket. 1216 buckets, about 10 KiB, allocated with the owner.
+class LatencyHistogram {
+public:
+    static constexpr int SUB_BITS = 5;
+    static constexpr int MAX_BITS = 42;
+    static constexpr size_t BUCKETS = static_cast<size_t>(MAX_BITS - SUB_BITS + 1) << SUB_BITS;
+
+    void record(int64_t value_ns);
+
+    // Record now - start_ns; ignored when start_ns is 0 (no timestamp).
+    void record_since(int64_t start_ns) {
+        if (start_ns != 0) {
+            record(metrics_now_ns() - start_ns);
+        }
+    }
+
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+    int64_t min() const { return count() > 0 ? min_.load(std::memory_order_relaxed) : 0; }
+    int64_t max() const { return max_.load(std::memory_order_relaxed); }
+    double mean() const;
+
+    // Smallest value v such that at least `percent` % of the recorded values
+    // are <= v, reported as the upper edge of v's bucket.
+    int64_t percentile(double percent) const;
+
+    // "n=..., min/p50/p90/p99/p99.9/max ..." in microseconds.
+    std::string summary() const;
+
+private:
+    static size_t bucket_of(uint64_t value);
+    static uint64_t bucket_upper(size_t bucket);
+
+    std::array<std::atomic<uint64_t>, BUCKETS> buckets_{};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_{0};
+    std::atomic<int64_t> min_{INT64_MAX};
+    std::atomic<int64_t> max_{0};
+};
+
+// Depth of a queue, sampled by its producer after each push.
+class QueueDepthGauge {
+public:
+    template <typename Queue>
+    void sample(const Queue& queue) {
+        size_t depth = queue.size();
+        current_.store(depth, std::memory_order_relaxed);
+        if (depth > high_water_.load(std::memory_order_relaxed)) {
+            high_water_.store(depth, std::memory_order_relaxed);
+        }
+    }
+
+    size_t current() const { return current_.load(std::memory_order_relaxed); }
+    size_t high_water() const { return high_water_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<size_t> current_{0};
+    std::atomic<size_t> high_water_{0};
+};
+
+// Per-stage counters. The stage calls enter_busy() when it starts working on
+// an item and enter_idle() when it starts waiting (for input or for its next
+// deadline); the time since the previous call goes to the phase being left.
+class StageMetrics {
+public:
+    void enter_busy() { idle_ns.add(lap()); }
+    void enter_idle() { busy_ns.add(lap()); }
+
+    MetricCounter items;           // Queue items (pairs or batches) handled
+    MetricCounter pixels;
+    MetricCounter busy_ns;
+    MetricCounter idle_ns;
+    MetricCounter deadline_misses; // Iterations that ended after their deadline T
+
+private:
+    // Time since the previous transition; the first call only starts the clock.
+    uint64_t lap() {
+        int64_t now = metrics_now_ns();
+        int64_t elapsed = last_mark_ns_ != 0 ? now - last_mark_ns_ : 0;
+        last_mark_ns_ = now;
+        return static_cast<uint64_t>(elapsed);
+    }
+
+    int64_t last_mark_ns_ = 0;
+};
+
+#else // !PIPELINE_STATS
+
+class MetricCounter {
+public:
+    void add(uint64_t) {}
+    void set(uint64_t) {}
+    uint64_t get() const { return 0; }
+};
+
+class LatencyHistogram {
+public:
+    void record(int64_t) {}
+    void record_since(int64_t) {}
+    uint64_t count() const { return 0; }
+    int64_t min() const { return 0; }
+    int64_t max() const { return 0; }
+    double mean() const { return 0.0; }
+    int64_t percentile(double) const { return 0; }
+    std::string summary() const { return "stats compiled out"; }
+};
+
+class QueueDepthGauge {
+public:
+    template <typename Queue>
+    void sample(const Queue&) {}
+    size_t current() const { return 0; }
+    size_t high_water() const { return 0; }
+};
+
+class StageMetrics {
+public:
+    void enter_busy() {}
+    void enter_idle() {}
+
+    MetricCounter items;
+    MetricCounter pixels;
+    MetricCounter busy_ns;
+    MetricCounter idle_ns;
+    MetricCounter deadline_misses;
+};
+
+#endif // PIPELINE_STATS
+
+// One-line report of a stage's counters, e.g. for a periodic stats dump.
+std::string describe_stage_metrics(const StageMetrics& metrics);
+
+#endif // METRICS_H
@@ -0,0 +1,149 @@
+#include "pacer.h"
+#include "cpu_relax.h"
+#include <thread>
+#include <cmath>
+#include <limits>
+#include <sstream>
+#include <iomanip>
+
+Pacer::Pacer(long long period_ns, const PacerConfig& config)
+    : config_(config),
+      period_ns_(period_ns),
+      target_period_(period_ns),
+      started_(false),
+      ops_in_period_(0),
+      periods_(0),
+      mean_ns_(0.0),
+      m2_ns_(0.0),
+      min_ns_(std::numeric_limits<long long>::max()),
+      max_ns_(0),
+      over_target_(0),
+      resyncs_(0) {
+    if (config_.ops_per_deadline == 0) {
+        config_.ops_per_deadline = 1;
+    }
+    if (config_.strategy == PacingStrategy::Batched) {
+        target_period_ = std::chrono::nanoseconds(period_ns_ * static_cast<long long>(config_.ops_per_deadline));
+    }
+}
+
+const char* Pacer::strategy_name(PacingStrategy strategy) {
+    switch (strategy) {
+        case PacingStrategy::Sleep: return "sleep";
+        case PacingStrategy::HybridSpin: return "hybrid";
+        case PacingStrategy::BusySpin: return "spin";
+        case PacingStrategy::Batched: return "batched";
+        case PacingStrategy::None: return "none";
+    }
+    return "unknown";
+}
+
+void Pacer::reset() {
+    started_ = false;
+    ops_in_period_ = 0;
+}
+
+bool Pacer::wait() {
+    if (config_.strategy == PacingStrategy::None) {
+        return true;
+    }
+    if (config_.strategy == PacingStrategy::Sleep) {
+        // Relative sleep, kept for comparison with the original behaviour.
+        std::this_thread::sleep_for(std::chrono::nanoseconds(period_ns_));
+        record_release(Clock::now());
+        return true; // No deadline to miss
+    }
+    if (config_.strategy == PacingStrategy::Batched && ++ops_in_period_ < config_.ops_per_deadline) {
+        return true; // Still inside the current group of N operations
+    }
+    ops_in_period_ = 0;
+
+    Clock::time_point now = Clock::now();
+    if (!started_) {
+        // The first operation anchors the schedule.
+        started_ = true;
+        next_deadline_ = now + target_period_;
+        last_release_ = now;
+        return true;
+    }
+
+    bool on_time = now <= next_deadline_;
+    if (now >= next_deadline_ + target_period_) {
+        // More than a full period late: re-anchor rather than burst.
+        ++resyncs_;
+        next_deadline_ = now;
+    } else {
+        wait_until(next_deadline_);
+    }
+    record_release(Clock::now());
+    next_deadline_ += target_period_;
+    return on_time;
+}
+
+void Pacer::wait_until(Clock::time_point deadline) {
+    if (config_.strategy == PacingStrategy::HybridSpin) {
+        // Sleep through most of the gap, then spin out the rest precisely.
+        Clock::time_point wake = deadline - std::chrono::nanoseconds(config_.spin_window_ns);
+        if (Clock::now() < wake) {
+            std::this_thread::sleep_until(wake);
+        }
+    }
+    while (Clock::now() < deadline) {
+        cpu_relax();
+    }
+}
+
+void Pacer::record_release(Clock::time_point now) {
+    if (periods_ == 0 && last_release_ == Clock::time_point()) {
+        last_release_ = now;
+        return;
+    }
+    long long period = std::chrono::duration_cast<std::chrono::nanoseconds>(now - last_release_).count();
+    last_release_ = now;
+
+    ++periods_;
+    double delta = static_cast<double>(period) - mean_ns_;
+    mean_ns_ += delta / static_cast<double>(periods_);
+    m2_ns_ += delta * (static_cast<double>(period) - mean_ns_);
+    if (period < min_ns_) {
+        min_ns_ = period;
+    }
+    if (period > max_ns_) {
+        max_ns_ = period;
+    }
+    if (period > target_period_.count() + config_.miss_tolerance_ns) {
+        ++over_target_;
+    }
+}
+
+PacerStats Pacer::stats() const {
+    PacerStats result;
+    result.periods = periods_;
+    result.mean_ns = mean_ns_;
+    result.stddev_ns = periods_ > 1 ? std::sqrt(m2_ns_ / static_cast<double>(periods_ - 1)) : 0.0;
+    result.min_ns = periods_ > 0 ? min_ns_ : 0;
+    result.max_ns = max_ns_;
+    result.over_target = over_target_;
+    result.resyncs = resyncs_;
+    return result;
+}
+
+std::string Pacer::summary() const {
+    PacerStats s = stats();
+    std::ostringstream out;
+    out << "pacing " << strategy_name(config_.strategy);
+    if (config_.strategy == PacingStrategy::None) {
+        return out.str();
+    }
+    out << ", target " << target_period_.count() << "ns, " << s.periods << " periods";
+    if (s.periods > 0) {
+        out << std::fixed << std::setprecision(1)
+            << ", mean " << s.mean_ns << "ns, jitter (stddev) " << s.stddev_ns << "ns"
+            << ", min " << s.min_ns << "ns, max " << s.max_ns << "ns"
+            << ", " << s.over_target << " over target";
+    }
+    if (s.resyncs > 0) {
+        out << ", " << s.resyncs << " resyncs";
+    }
+    return out.str();
+}
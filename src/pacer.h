@@ -0,0 +1,89 @@
+#ifndef PACER_H
+#define PACER_H
+
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+// How a stage spaces its operations T apart.
+enum class PacingStrategy {
+    Sleep,      // Legacy: sleep_for(T) after the work (period = T + work + sleep overshoot)
+    HybridSpin, // Sleep until spin_window_ns before the absolute deadline, then spin
+    BusySpin,   // Spin (with a pause hint) until the absolute deadline
+    Batched,    // Release ops_per_deadline operations per deadline, deadlines N*T apart
+    None        // Unpaced: never wait
+};
+
+struct PacerConfig {
+    PacingStrategy strategy = PacingStrategy::HybridSpin;
+    size_t ops_per_deadline = 1;     // Batched only
+    long long spin_window_ns = 100000; // HybridSpin: covers typical Linux sleep overshoot
+    long long miss_tolerance_ns = 1000; // A period counts as over target beyond target + this
+};
+
+// Achieved release-to-release periods, measured at every deadline.
+struct PacerStats {
+    uint64_t periods = 0;       // Number of measured periods
+    double mean_ns = 0.0;
+    double stddev_ns = 0.0;     // Jitter
+    long long min_ns = 0;
+    long long max_ns = 0;
+    uint64_t over_target = 0;   // Periods longer than target + tolerance (the "<= T" violations)
+    uint64_t resyncs = 0;       // Deadlines abandoned because we fell a full period behind
+};
+
+// Paces a loop against absolute std::chrono::steady_clock deadlines.
+//
+// Call wait() once after each operation. Deadlines advance by a fixed period
+// from the first call, so the work time and the sleep overshoot of one
+// iteration do not accumulate into the next one. If the loop falls more than a
+// whole period behind, the schedule is re-anchored at "now" instead of
+// releasing a burst to catch up.
+class Pacer {
+public:
+    Pacer(long long period_ns, const PacerConfig& config = PacerConfig());
+
+    // Block until the next operation may start. Returns false if the operation
+    // that just ended overran its deadline.
+    bool wait();
+
+    // Forget the schedule; the next wait() starts a fresh one.
+    void reset();
+
+    PacerStats stats() const;
+    const PacerConfig& config() const { return config_; }
+
+    // Target time between two deadlines (T, or N*T when batched).
+    long long target_period_ns() const { return target_period_.count(); }
+
+    // One-line human readable report of stats().
+    std::string summary() const;
+
+    static const char* strategy_name(PacingStrategy strategy);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    void wait_until(Clock::time_point deadline);
+    void record_release(Clock::time_point now);
+
+    PacerConfig config_;
+    long long period_ns_;
+    std::chrono::nanoseconds target_period_;
+    bool started_;
+    size_t ops_in_period_;
+    Clock::time_point next_deadline_;
+    Clock::time_point last_release_;
+
+    // Running statistics (Welford) of the achieved periods.
+    uint64_t periods_;
+    double mean_ns_;
+    double m2_ns_;
+    long long min_ns_;
+    long long max_ns_;
+    uint64_t over_target_;
+    uint64_t resyncs_;
+};
+
+#endif // PACER_H
@@ -0,0 +1,79 @@
+#include "pipeline.h"
+#include "alloc_check.h"
+#include "cpu_time.h"
+
+Pipeline::Pipeline(PipelineQueue<PixelBatch*>& input, BatchPool& pool, size_t queue_capacity)
+    : input_(input),
+      pool_(pool),
+      queue_capacity_(queue_capacity > 0 ? queue_capacity : 64) {}
+
+Pipeline::~Pipeline() {
+    join();
+}
+
+Pipeline& Pipeline::add_stage(std::unique_ptr<Stage> stage) {
+    Stage& added = *stage;
+    owned_stages_.push_back(std::move(stage));
+    return add_stage(added);
+}
+
+Pipeline& Pipeline::add_stage(Stage& stage) {
+    if (!stages_.empty()) {
+        // Bounded and blocking: a slow stage holds back the ones before it
+        // instead of letting batches pile up.
+        links_.push_back(std::make_unique<SpscRingQueue<PixelBatch*>>(queue_capacity_, QueueFullPolicy::Block));
+    }
+    stages_.push_back(&stage);
+    StageStats stats;
+    stats.name = stage.name();
+    stats_.push_back(stats);
+    return *this;
+}
+
+void Pipeline::start() {
+    for (size_t i = 0; i < stages_.size(); ++i) {
+        threads_.emplace_back(&Pipeline::run_stage, this, i);
+    }
+}
+
+void Pipeline::join() {
+    for (std::thread& thread : threads_) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+    threads_.clear();
+}
+
+void Pipeline::run_stage(size_t index) {
+    if (thread_setup_) {
+        thread_setup_(index);
+    }
+    long long cpu_start = thread_cpu_time_ns();
+    PipelineQueue<PixelBatch*>& in = index == 0 ? input_ : *links_[index - 1];
+    PipelineQueue<PixelBatch*>* out = index + 1 < stages_.size() ? links_[index].get() : nullptr;
+    Stage& stage = *stages_[index];
+    StageStats& stats = stats_[index];
+
+    PixelBatch* batch = nullptr;
+    SteadyStateScope steady_state;
+    while (in.pop(batch)) { // False once the input is closed and drained
+        ++stats.batches;
+        stats.pixels += batch->size;
+        if (!stage.process(*batch)) {
+            ++stats.dropped;
+            pool_.release(batch);
+        } else if (out) {
+            out->push(batch);
+        } else {
+            pool_.release(batch); // Last stage: the batch is free again
+        }
+        steady_state.tick();
+    }
+    steady_state.leave();
+    stage.finish();
+    if (out) {
+        out->close();
+    }
+    stats.cpu_time_ns = thread_cpu_time_ns() - cpu_start;
+}
@@ -0,0 +1,93 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include "pipeline_queue.h"
+#include "spsc_ring_queue.h"
+#include "pixel_batch.h"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// One processing step of a Pipeline. A stage sees every batch of the stream
+// in order, on its own thread, and normally works on the pixels in place.
+class Stage {
+public:
+    virtual ~Stage() = default;
+
+    virtual std::string name() const = 0;
+
+    // Process one batch. Return false to drop it: it goes straight back to the
+    // pool instead of on to the next stage.
+    virtual bool process(PixelBatch& batch) = 0;
+
+    // Called once, after the last batch has been processed.
+    virtual void finish() {}
+};
+
+// Per-stage counters, valid after Pipeline::join().
+struct StageStats {
+    std::string name;
+    uint64_t batches = 0;
+    uint64_t pixels = 0;
+    uint64_t dropped = 0;      // Batches the stage returned false for
+    long long cpu_time_ns = 0; // Thread CPU time of the stage
+};
+
+// A chain of stages connected by bounded SPSC rings.
+//
+//   producer -> input -> [stage 0] -> ring -> [stage 1] -> ... -> back to pool
+//
+// Batches come from a BatchPool shared by the whole chain and travel by
+// pointer: no pixel is copied and nothing is allocated once running. The last
+// stage returns each batch to the pool. Closing the input queue ends the
+// stream: each stage drains its input, finishes, and closes its output.
+//
+//   Pipeline pipeline(queue, pool);
+//   pipeline.add_stage(std::make_unique<FlatFieldStage>(...))
+//           .add_stage(filter_stage);
+//   pipeline.start();
+//   ... producer pushes batches, then closes the queue ...
+//   pipeline.join();
+class Pipeline {
+public:
+    // queue_capacity: slots of each ring between two stages.
+    Pipeline(PipelineQueue<PixelBatch*>& input, BatchPool& pool, size_t queue_capacity = 64);
+    ~Pipeline();
+
+    Pipeline(const Pipeline&) = delete;
+    Pipeline& operator=(const Pipeline&) = delete;
+
+    // Append a stage; the reference form does not take ownership. Before start() only.
+    Pipeline& add_stage(std::unique_ptr<Stage> stage);
+    Pipeline& add_stage(Stage& stage);
+
+    // Called first on every stage thread, e.g. to pin it. Before start() only.
+    void set_thread_setup(std::function<void(size_t stage)> setup) { thread_setup_ = std::move(setup); }
+
+    // Start one thread per stage.
+    void start();
+
+    // Wait until the closed input has been drained through every stage.
+    void join();
+
+    size_t stage_count() const { return stages_.size(); }
+    const std::vector<StageStats>& stats() const { return stats_; }
+
+private:
+    void run_stage(size_t index);
+
+    PipelineQueue<PixelBatch*>& input_;
+    BatchPool& pool_;
+    size_t queue_capacity_;
+    std::vector<Stage*> stages_;
+    std::vector<std::unique_ptr<Stage>> owned_stages_;
+    std::vector<std::unique_ptr<SpscRingQueue<PixelBatch*>>> links_; // links_[i] feeds stage i + 1
+    std::vector<StageStats> stats_;
+    std::function<void(size_t)> thread_setup_;
+    std::vector<std::thread> threads_;
+};
+
+#endif // PIPELINE_H
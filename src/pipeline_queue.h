@@ -0,0 +1,45 @@
+#ifndef PIPELINE_QUEUE_H
+#define PIPELINE_QUEUE_H
+
+#include <cstddef> // For size_t
+
+// Common interface for the queues that connect pipeline stages.
+// DataGenerator and FilterThreshold only talk to this interface, so main()
+// can pick the queue implementation (mutex-based BlockingQueue or the
+// lock-free SpscRingQueue) at startup without touching the stages.
+template <typename T>
+class PipelineQueue {
+public:
+    virtual ~PipelineQueue() = default;
+
+    // Push an item to the queue. May block or drop depending on the implementation.
+    virtual void push(T item) = 0;
+
+    // Pop an item from the queue. Blocks if the queue is empty.
+    virtual T pop() = 0;
+
+    // Pop an item, parking the caller while the queue is empty. Returns false
+    // once the queue has been closed and every item pushed before close() has
+    // been popped: the end of the stream.
+    virtual bool pop(T& item) = 0;
+
+    // Try to pop an item from the queue without blocking.
+    // Returns true if an item was popped, false otherwise.
+    virtual bool try_pop(T& item) = 0;
+
+    // Check if the queue is empty.
+    virtual bool empty() const = 0;
+
+    // Get the current size of the queue.
+    virtual size_t size() const = 0;
+
+    // Mark the end of the stream and wake a parked consumer. Called by the
+    // producer (or after it has been joined) once its last push has returned;
+    // nothing may be pushed afterwards.
+    virtual void close() = 0;
+
+    // True once close() has been called. Items may still be queued.
+    virtual bool closed() const = 0;
+};
+
+#endif // PIPELINE_QUEUE_H
@@ -0,0 +1,76 @@
+#include "pipeline_stages.h"
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace {
+
+// Parse one line of comma-separated numbers; false on a malformed value.
+bool parse_values(const std::string& line, std::vector<double>& values) {
+    std::stringstream ss(line);
+    std::string value;
+    while (std::getline(ss, value, ',')) {
+        try {
+            values.push_back(std::stod(value));
+        } catch (const std::exception&) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+bool FlatFieldStage::load(const std::string& calibration_path) {
+    std::ifstream file(calibration_path);
+    if (!file.is_open()) {
+        std::cerr << "FlatFieldStage: Error opening calibration file " << calibration_path << std::endl;
+        return false;
+    }
+    std::string dark_line;
+    std::string gain_line;
+    std::vector<double> dark;
+    std::vector<double> gain;
+    if (!std::getline(file, dark_line) || !std::getline(file, gain_line) ||
+        !parse_values(dark_line, dark) || !parse_values(gain_line, gain)) {
+        std::cerr << "FlatFieldStage: Expected a dark line and a gain line of numbers in " << calibration_path << std::endl;
+        return false;
+    }
+    if (dark.empty() || dark.size() != gain.size()) {
+        std::cerr << "FlatFieldStage: Dark line has " << dark.size() << " values, gain line has "
+                  << gain.size() << "; they must match and be non-empty." << std::endl;
+        return false;
+    }
+
+    columns_ = dark.size();
+    lut_.resize(columns_ * 256);
+    for (size_t c = 0; c < columns_; ++c) {
+        for (int raw = 0; raw < 256; ++raw) {
+            double corrected = std::round((raw - dark[c]) * gain[c]);
+            lut_[c * 256 + raw] = static_cast<uint8_t>(corrected < 0.0 ? 0.0 : (corrected > 255.0 ? 255.0 : corrected));
+        }
+    }
+    return true;
+}
+
+bool FlatFieldStage::process(PixelBatch& batch) {
+    size_t column = static_cast<size_t>(batch.first_index % columns_);
+    for (size_t i = 0; i < batch.size; ++i) {
+        batch.data[i] = lut_[column * 256 + batch.data[i]];
+        if (++column == columns_) {
+            column = 0;
+        }
+    }
+    return true;
+}
+
+bool FilterStage::process(PixelBatch& batch) {
+    filter_.process_batch(batch);
+    return true;
+}
+
+void FilterStage::finish() {
+    filter_.finish_stream();
+    filter_.report_leftovers();
+}
@@ -0,0 +1,47 @@
+#ifndef PIPELINE_STAGES_H
+#define PIPELINE_STAGES_H
+
+#include "pipeline.h"
+#include "filter_threshold.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Flat-field correction: corrected = (raw - dark[c]) * gain[c] for the column
+// c = stream index % columns, rounded and clamped to 0..255, in place.
+//
+// The calibration file has two CSV lines of one value per column: the dark
+// level, then the gain. Both are folded into a 256-entry lookup table per
+// column when loading, so correcting a pixel is one table read.
+class FlatFieldStage : public Stage {
+public:
+    FlatFieldStage() = default;
+
+    // Returns false (and prints why) if the file cannot be read or the two
+    // lines differ in length.
+    bool load(const std::string& calibration_path);
+
+    size_t columns() const { return columns_; }
+
+    std::string name() const override { return "FlatField"; }
+    bool process(PixelBatch& batch) override;
+
+private:
+    size_t columns_ = 0;
+    std::vector<uint8_t> lut_; // columns_ * 256 corrected values
+};
+
+// Adapter running a stage-mode FilterThreshold as the filter step of a pipeline.
+class FilterStage : public Stage {
+public:
+    explicit FilterStage(FilterThreshold& filter) : filter_(filter) {}
+
+    std::string name() const override { return "FilterThreshold"; }
+    bool process(PixelBatch& batch) override;
+    void finish() override;
+
+private:
+    FilterThreshold& filter_;
+};
+
+#endif // PIPELINE_STAGES_H
@@ -0,0 +1,79 @@
+#include "pixel_batch.h"
+
+namespace {
+
+// Batch storage starts on a cache line when it is placed in caller memory.
+const size_t BATCH_ALIGNMENT = 64;
+
+size_t aligned_stride(size_t batch_capacity) {
+    return (batch_capacity + BATCH_ALIGNMENT - 1) / BATCH_ALIGNMENT * BATCH_ALIGNMENT;
+}
+
+} // namespace
+
+BatchPool::BatchPool(size_t batch_count, size_t batch_capacity)
+    : batch_capacity_(batch_capacity),
+      stride_(batch_capacity),
+      own_storage_(batch_count * batch_capacity),
+      storage_(own_storage_.data()),
+      batches_(batch_count) {
+    link_batches();
+}
+
+BatchPool::BatchPool(size_t batch_count, size_t batch_capacity, uint8_t* storage)
+    : batch_capacity_(batch_capacity),
+      stride_(aligned_stride(batch_capacity)),
+      storage_(storage),
+      batches_(batch_count) {
+    link_batches();
+}
+
+void BatchPool::link_batches() {
+    free_list_.reserve(batches_.size());
+    for (size_t i = 0; i < batches_.size(); ++i) {
+        batches_[i].data = storage_ + i * stride_;
+        batches_[i].capacity = batch_capacity_;
+        free_list_.push_back(&batches_[i]);
+    }
+}
+
+size_t BatchPool::storage_bytes(size_t batch_count, size_t batch_capacity) {
+    return batch_count * aligned_stride(batch_capacity);
+}
+
+void BatchPool::reset(PixelBatch* batch) {
+    // A replayed batch may have pointed into a file mapping; give it back its own storage.
+    batch->data = storage_ + static_cast<size_t>(batch - batches_.data()) * stride_;
+    batch->size = 0;
+}
+
+PixelBatch* BatchPool::acquire() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    batch_available_.wait(lock, [this] { return !free_list_.empty(); });
+    PixelBatch* batch = free_list_.back();
+    free_list_.pop_back();
+    reset(batch);
+    return batch;
+}
+
+PixelBatch* BatchPool::try_acquire() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (free_list_.empty()) {
+        return nullptr;
+    }
+    PixelBatch* batch = free_list_.back();
+    free_list_.pop_back();
+    reset(batch);
+    return batch;
+}
+
+void BatchPool::release(PixelBatch* batch) {
+    if (batch == nullptr) {
+        return;
+    }
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        free_list_.push_back(batch);
+    }
+    batch_available_.notify_one();
+}
@@ -0,0 +1,65 @@
+#ifndef PIXEL_BATCH_H
+#define PIXEL_BATCH_H
+
+#include <cstdint> // For uint8_t, uint64_t
+#include <cstddef> // For size_t
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+
+// A span of consecutive pixels moved through the pipeline as one message.
+// The pixel storage belongs to a BatchPool; only the pointer travels through
+// the queue, and the consumer hands the batch back to the pool when done.
+struct PixelBatch {
+    uint8_t* data = nullptr;  // Pixel storage (capacity bytes, owned by the pool; a
+                              // replay source may point it at mapped file data instead)
+    size_t size = 0;          // Number of valid pixels in data
+    size_t capacity = 0;      // Maximum number of pixels the batch can hold
+    uint64_t first_index = 0; // Stream index of data[0]
+    int64_t created_ns = 0;   // metrics_now_ns() when the batch was filled; 0 = not stamped
+};
+
+// Fixed set of PixelBatch buffers allocated once at construction.
+// acquire() blocks when every batch is in flight, so the pool also bounds the
+// memory held by the pipeline. Safe to use from any number of threads.
+class BatchPool {
+public:
+    BatchPool(size_t batch_count, size_t batch_capacity);
+
+    // Place the pixel storage in caller-owned memory of at least
+    // storage_bytes(batch_count, batch_capacity) bytes (an Arena block) that
+    // outlives the pool. Each batch starts on a cache line.
+    BatchPool(size_t batch_count, size_t batch_capacity, uint8_t* storage);
+    static size_t storage_bytes(size_t batch_count, size_t batch_capacity);
+
+    BatchPool(const BatchPool&) = delete;
+    BatchPool& operator=(const BatchPool&) = delete;
+
+    // Take a free batch (size reset to 0, data back on the pool's storage).
+    // Blocks until one is available.
+    PixelBatch* acquire();
+
+    // Take a free batch if one is available, otherwise return nullptr.
+    PixelBatch* try_acquire();
+
+    // Return a batch obtained from acquire() to the pool.
+    void release(PixelBatch* batch);
+
+    size_t batch_capacity() const { return batch_capacity_; }
+    size_t batch_count() const { return batches_.size(); }
+
+private:
+    void link_batches();
+    void reset(PixelBatch* batch);
+
+    size_t batch_capacity_;
+    size_t stride_;                     // Bytes between two batches' storage
+    std::vector<uint8_t> own_storage_;  // Unless the storage was given
+    uint8_t* storage_;                  // batch_count * stride_ contiguous bytes
+    std::vector<PixelBatch> batches_;
+    std::vector<PixelBatch*> free_list_; // Reserved to batch_count, never reallocates
+    std::mutex mutex_;
+    std::condition_variable batch_available_;
+};
+
+#endif // PIXEL_BATCH_H
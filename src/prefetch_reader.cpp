@@ -0,0 +1,136 @@
+#include "prefetch_reader.h"
+#include <algorithm> // For std::min, std::max
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>  // For open
+#include <unistd.h> // For read, close
+
+namespace {
+
+// The I/O thread mostly sleeps in read(); it should not burn a core spinning
+// for a free chunk either.
+const size_t IO_SPIN_LIMIT = 64;
+
+} // namespace
+
+PrefetchReader::PrefetchReader(const PrefetchConfig& config)
+    : config_(config),
+      fd_(-1),
+      chunks_(std::max<size_t>(config.depth, 1)),
+      filled_(chunks_.size(), QueueFullPolicy::SpinThenPark, IO_SPIN_LIMIT),
+      empty_(chunks_.size(), QueueFullPolicy::SpinThenPark, IO_SPIN_LIMIT),
+      stopping_(false),
+      current_(nullptr),
+      current_used_(0),
+      stalls_(0),
+      chunks_read_(0),
+      max_read_ns_(0) {
+    config_.depth = chunks_.size();
+    config_.chunk_bytes = std::max<size_t>(config_.chunk_bytes, 4096);
+    for (Chunk& chunk : chunks_) {
+        chunk.bytes.resize(config_.chunk_bytes);
+        empty_.push(&chunk); // Rings hold at least depth items, so this never waits
+    }
+}
+
+PrefetchReader::~PrefetchReader() {
+    close();
+}
+
+bool PrefetchReader::open(const std::string& path) {
+    if (fd_ >= 0 || io_thread_.joinable()) {
+        return false; // One file per reader
+    }
+    fd_ = ::open(path.c_str(), O_RDONLY);
+    if (fd_ < 0) {
+        return false;
+    }
+#if defined(POSIX_FADV_SEQUENTIAL)
+    posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL); // Let the kernel read ahead too
+#endif
+    io_thread_ = std::thread(&PrefetchReader::io_loop, this);
+    return true;
+}
+
+void PrefetchReader::close() {
+    if (io_thread_.joinable()) {
+        stopping_.store(true, std::memory_order_relaxed);
+        empty_.close(); // Wakes the I/O thread if it waits for a free chunk
+        io_thread_.join();
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+void PrefetchReader::io_loop() {
+    Chunk* chunk = nullptr;
+    while (!stopping_.load(std::memory_order_relaxed) && empty_.pop(chunk)) {
+        auto start = std::chrono::steady_clock::now();
+        chunk->size = 0;
+        // Fill the whole chunk unless the file ends, so short pipe reads do
+        // not turn into many small chunks.
+        while (chunk->size < chunk->bytes.size()) {
+            ssize_t got = ::read(fd_, chunk->bytes.data() + chunk->size, chunk->bytes.size() - chunk->size);
+            if (got > 0) {
+                chunk->size += static_cast<size_t>(got);
+            } else if (got == 0 || errno != EINTR) {
+                if (got < 0) {
+                    std::cerr << "Prefetch Error: read failed: " << std::strerror(errno) << std::endl;
+                }
+                break;
+            }
+        }
+        long long elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count();
+        if (elapsed > max_read_ns_.load(std::memory_order_relaxed)) {
+            max_read_ns_.store(elapsed, std::memory_order_relaxed);
+        }
+        if (chunk->size == 0) {
+            break; // End of file or error
+        }
+        chunks_read_.fetch_add(1, std::memory_order_relaxed);
+        bool last = chunk->size < chunk->bytes.size();
+        filled_.push(chunk);
+        if (last) {
+            break;
+        }
+    }
+    filled_.close(); // After the last push, on the producing thread
+}
+
+size_t PrefetchReader::read(void* out, size_t max_bytes) {
+    char* dst = static_cast<char*>(out);
+    size_t copied = 0;
+    while (copied < max_bytes) {
+        if (!current_) {
+            if (!filled_.try_pop(current_)) {
+                if (filled_.closed() && filled_.empty()) {
+                    current_ = nullptr;
+                    break; // End of file
+                }
+                if (copied > 0) {
+                    break; // Hand out what is here rather than wait
+                }
+                ++stalls_;
+                if (!filled_.pop(current_)) {
+                    current_ = nullptr;
+                    break;
+                }
+            }
+            current_used_ = 0;
+        }
+        size_t taken = std::min(max_bytes - copied, current_->size - current_used_);
+        std::memcpy(dst + copied, current_->bytes.data() + current_used_, taken);
+        copied += taken;
+        current_used_ += taken;
+        if (current_used_ == current_->size) {
+            empty_.push(current_);
+            current_ = nullptr;
+        }
+    }
+    return copied;
+}
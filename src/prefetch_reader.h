@@ -0,0 +1,76 @@
+#ifndef PREFETCH_READER_H
+#define PREFETCH_READER_H
+
+#include "spsc_ring_queue.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Read-ahead settings for the file sources; depth 0 reads on the caller's thread.
+struct PrefetchConfig {
+    size_t depth = 0;                // Chunks kept in flight
+    size_t chunk_bytes = 1024 * 1024; // Bytes per read()
+};
+
+// Sequential file reader with a dedicated I/O thread.
+//
+// The I/O thread keeps up to depth chunks read ahead of the consumer. Full
+// chunks travel to the consumer through one SPSC ring and come back empty
+// through another, so after open() no allocation or lock is taken on the
+// fast path. The consumer only waits when the disk fell behind by the whole
+// read-ahead depth; those waits are counted in stalls().
+//
+// Works on anything read() works on (regular files, pipes, FIFOs). One file
+// per reader: create a new one to read again.
+class PrefetchReader {
+public:
+    explicit PrefetchReader(const PrefetchConfig& config);
+    ~PrefetchReader();
+
+    PrefetchReader(const PrefetchReader&) = delete;
+    PrefetchReader& operator=(const PrefetchReader&) = delete;
+
+    // Open path and start the I/O thread. Returns false if it cannot be opened.
+    bool open(const std::string& path);
+
+    // Stop the I/O thread and close the file. Called by the destructor.
+    void close();
+
+    // Copy up to max_bytes of the file to out, like read(2) (consumer thread
+    // only). Returns 0 at the end of the file or after a read error.
+    size_t read(void* out, size_t max_bytes);
+
+    const PrefetchConfig& config() const { return config_; }
+    uint64_t chunks_read() const { return chunks_read_.load(std::memory_order_relaxed); }
+    uint64_t stalls() const { return stalls_; }             // read() calls that had to wait for the disk
+    long long max_read_ns() const { return max_read_ns_.load(std::memory_order_relaxed); } // Slowest read() on the I/O thread
+
+private:
+    struct Chunk {
+        std::vector<char> bytes;
+        size_t size = 0;
+    };
+
+    void io_loop();
+
+    PrefetchConfig config_;
+    int fd_;
+    std::vector<Chunk> chunks_;
+    SpscRingQueue<Chunk*> filled_; // I/O thread -> consumer; closed at the end of the file
+    SpscRingQueue<Chunk*> empty_;  // Consumer -> I/O thread; closed by close()
+    std::atomic<bool> stopping_;
+    std::thread io_thread_;
+
+    // Consumer side
+    Chunk* current_;    // Chunk being handed out by read()
+    size_t current_used_;
+    uint64_t stalls_;
+
+    std::atomic<uint64_t> chunks_read_;
+    std::atomic<long long> max_read_ns_;
+};
+
+#endif // PREFETCH_READER_H
@@ -0,0 +1,203 @@
+#include "random_source.h"
+#include <algorithm> // For std::min
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define RANDOM_SOURCE_X86 1
+#endif
+
+namespace {
+
+using BlockFunction = void (*)(uint64_t state[4][4], uint8_t* out, size_t blocks);
+
+inline uint64_t rotl(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+// SplitMix64, the seeding generator recommended for xoshiro.
+uint64_t splitmix64(uint64_t& x) {
+    uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+// Advance one xoshiro256++ state (4 words) by the polynomial in `jump`.
+void apply_jump(uint64_t s[4], const uint64_t jump[4]) {
+    uint64_t t[4] = {0, 0, 0, 0};
+    for (int i = 0; i < 4; ++i) {
+        for (int b = 0; b < 64; ++b) {
+            if (jump[i] & (uint64_t(1) << b)) {
+                for (int w = 0; w < 4; ++w) {
+                    t[w] ^= s[w];
+                }
+            }
+            // One plain xoshiro256 step (the output function does not matter here).
+            const uint64_t shifted = s[1] << 17;
+            s[2] ^= s[0];
+            s[3] ^= s[1];
+            s[1] ^= s[2];
+            s[0] ^= s[3];
+            s[2] ^= shifted;
+            s[3] = rotl(s[3], 45);
+        }
+    }
+    std::memcpy(s, t, sizeof(t));
+}
+
+// 2^128 and 2^192 steps, from the reference implementation.
+const uint64_t JUMP[4] = {0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL, 0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL};
+const uint64_t LONG_JUMP[4] = {0x76e15d3efefdcbbfULL, 0xc5004e441c522fb3ULL, 0x77710069854ee241ULL, 0x39109bb02acbe635ULL};
+
+// Four xoshiro256++ steps, one per stream, writing 32 bytes per block.
+void xoshiro_blocks_scalar(uint64_t state[4][4], uint8_t* out, size_t blocks) {
+    for (size_t block = 0; block < blocks; ++block) {
+        uint64_t result[4];
+        for (size_t s = 0; s < 4; ++s) {
+            result[s] = rotl(state[0][s] + state[3][s], 23) + state[0][s];
+            const uint64_t shifted = state[1][s] << 17;
+            state[2][s] ^= state[0][s];
+            state[3][s] ^= state[1][s];
+            state[1][s] ^= state[2][s];
+            state[0][s] ^= state[3][s];
+            state[2][s] ^= shifted;
+            state[3][s] = rotl(state[3][s], 45);
+        }
+        std::memcpy(out + block * sizeof(result), result, sizeof(result));
+    }
+}
+
+#if defined(RANDOM_SOURCE_X86)
+
+__attribute__((target("avx2")))
+inline __m256i rotl_avx2(__m256i x, int k) {
+    return _mm256_or_si256(_mm256_slli_epi64(x, k), _mm256_srli_epi64(x, 64 - k));
+}
+
+// Same steps as the scalar version, the four streams in one register per word.
+__attribute__((target("avx2")))
+void xoshiro_blocks_avx2(uint64_t state[4][4], uint8_t* out, size_t blocks) {
+    __m256i s0 = _mm256_load_si256(reinterpret_cast<const __m256i*>(state[0]));
+    __m256i s1 = _mm256_load_si256(reinterpret_cast<const __m256i*>(state[1]));
+    __m256i s2 = _mm256_load_si256(reinterpret_cast<const __m256i*>(state[2]));
+    __m256i s3 = _mm256_load_si256(reinterpret_cast<const __m256i*>(state[3]));
+    for (size_t block = 0; block < blocks; ++block) {
+        __m256i result = _mm256_add_epi64(rotl_avx2(_mm256_add_epi64(s0, s3), 23), s0);
+        __m256i shifted = _mm256_slli_epi64(s1, 17);
+        s2 = _mm256_xor_si256(s2, s0);
+        s3 = _mm256_xor_si256(s3, s1);
+        s1 = _mm256_xor_si256(s1, s2);
+        s0 = _mm256_xor_si256(s0, s3);
+        s2 = _mm256_xor_si256(s2, shifted);
+        s3 = rotl_avx2(s3, 45);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + block * 32), result);
+    }
+    _mm256_store_si256(reinterpret_cast<__m256i*>(state[0]), s0);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(state[1]), s1);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(state[2]), s2);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(state[3]), s3);
+}
+
+#endif // RANDOM_SOURCE_X86
+
+struct BlockDispatch {
+    BlockFunction function;
+    const char* isa;
+};
+
+BlockDispatch select_block_function() {
+#if defined(RANDOM_SOURCE_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return {xoshiro_blocks_avx2, "avx2"};
+    }
+#endif
+    return {xoshiro_blocks_scalar, "scalar"};
+}
+
+const BlockDispatch& block_dispatch() {
+    static const BlockDispatch dispatch = select_block_function();
+    return dispatch;
+}
+
+} // namespace
+
+RandomPixelSource::RandomPixelSource()
+    : engine_(RandomEngine::Mt19937),
+      mt_engine_(std::random_device{}()), // Seed with a real random device
+      uint8_distribution_(0, 255),
+      buffered_(BLOCK_BYTES) {
+    std::memset(state_, 0, sizeof(state_));
+}
+
+void RandomPixelSource::set_engine(RandomEngine engine) {
+    engine_ = engine;
+    std::random_device device;
+    seed((static_cast<uint64_t>(device()) << 32) | device());
+}
+
+void RandomPixelSource::seed(uint64_t seed, uint64_t stream) {
+    if (engine_ == RandomEngine::Mt19937) {
+        std::seed_seq sequence{static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32)};
+        mt_engine_.seed(sequence);
+        return;
+    }
+    uint64_t base[4];
+    uint64_t splitmix_state = seed;
+    for (uint64_t& word : base) {
+        word = splitmix64(splitmix_state);
+    }
+    for (uint64_t i = 0; i < stream; ++i) {
+        apply_jump(base, LONG_JUMP);
+    }
+    // The four interleaved generators are consecutive 2^128 jumps of the base.
+    for (size_t s = 0; s < STREAMS; ++s) {
+        for (int w = 0; w < 4; ++w) {
+            state_[w][s] = base[w];
+        }
+        apply_jump(base, JUMP);
+    }
+    buffered_ = BLOCK_BYTES;
+}
+
+void RandomPixelSource::refill() {
+    block_dispatch().function(state_, buffer_, 1);
+    buffered_ = 0;
+}
+
+void RandomPixelSource::fill(uint8_t* out, size_t count) {
+    if (engine_ == RandomEngine::Mt19937) {
+        for (size_t i = 0; i < count; ++i) {
+            out[i] = static_cast<uint8_t>(uint8_distribution_(mt_engine_));
+        }
+        return;
+    }
+    // Hand out what is left of the current block first, so the byte stream
+    // does not depend on how it is cut up.
+    size_t taken = std::min(count, BLOCK_BYTES - buffered_);
+    std::memcpy(out, buffer_ + buffered_, taken);
+    buffered_ += taken;
+    out += taken;
+    count -= taken;
+
+    size_t blocks = count / BLOCK_BYTES;
+    if (blocks > 0) {
+        block_dispatch().function(state_, out, blocks);
+        out += blocks * BLOCK_BYTES;
+        count -= blocks * BLOCK_BYTES;
+    }
+    if (count > 0) {
+        refill();
+        std::memcpy(out, buffer_, count);
+        buffered_ = count;
+    }
+}
+
+const char* RandomPixelSource::engine_name(RandomEngine engine) {
+    return engine == RandomEngine::Xoshiro256pp ? "xoshiro256++" : "mt19937";
+}
+
+const char* RandomPixelSource::xoshiro_isa() {
+    return block_dispatch().isa;
+}
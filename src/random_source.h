@@ -0,0 +1,71 @@
+#ifndef RANDOM_SOURCE_H
+#define RANDOM_SOURCE_H
+
+#include <cstddef> // For size_t
+#include <cstdint>
+#include <random>
+
+// Generator behind random mode.
+enum class RandomEngine {
+    Mt19937,     // std::mt19937 + uniform_int_distribution, one draw per pixel (the original)
+    Xoshiro256pp // Four interleaved xoshiro256++ streams, 8 pixels per 64-bit draw
+};
+
+// Random pixel values for DataGenerator.
+//
+// The xoshiro engine runs four xoshiro256++ generators side by side (each a
+// 2^128 jump apart), so one step yields 32 bytes and maps onto one AVX2
+// register per state word; there is a portable fallback that produces the
+// same bytes. Output is a plain byte stream: the same seed gives the same
+// pixels whatever mix of fill() and next() calls consumes it.
+//
+// Streams: seed(s, k) starts stream k of seed s, 2^192 draws (a long jump)
+// away from stream k - 1, so lanes sharing a seed never overlap.
+class RandomPixelSource {
+public:
+    // mt19937 seeded from std::random_device.
+    RandomPixelSource();
+
+    // Select the engine; reseeds it from std::random_device.
+    void set_engine(RandomEngine engine);
+    RandomEngine engine() const { return engine_; }
+
+    // Reproducible seeding. stream only affects the xoshiro engine.
+    void seed(uint64_t seed, uint64_t stream = 0);
+
+    // Write count random pixels to out.
+    void fill(uint8_t* out, size_t count);
+
+    // One random pixel.
+    uint8_t next() {
+        if (engine_ == RandomEngine::Mt19937) {
+            return static_cast<uint8_t>(uint8_distribution_(mt_engine_));
+        }
+        if (buffered_ == BLOCK_BYTES) {
+            refill();
+        }
+        return buffer_[buffered_++];
+    }
+
+    static const char* engine_name(RandomEngine engine);
+
+    // Instruction set of the xoshiro block generator picked at startup.
+    static const char* xoshiro_isa();
+
+private:
+    static constexpr size_t STREAMS = 4;
+    static constexpr size_t BLOCK_BYTES = STREAMS * sizeof(uint64_t);
+
+    void refill();
+
+    RandomEngine engine_;
+    std::mt19937 mt_engine_;
+    std::uniform_int_distribution<int> uint8_distribution_;
+
+    // xoshiro256++ state, word-major: state_[w][s] is word w of stream s.
+    alignas(32) uint64_t state_[4][STREAMS];
+    alignas(32) uint8_t buffer_[BLOCK_BYTES]; // Bytes of the last block not yet handed out
+    size_t buffered_;                         // Index of the next unused byte in buffer_
+};
+
+#endif // RANDOM_SOURCE_H
@@ -0,0 +1,88 @@
+#include "realtime.h"
+#include <algorithm> // For std::find
+#include <cerrno>
+#include <cstdlib>   // For std::strtoull
+#include <cstring>   // For std::strerror
+#include <fstream>
+#include <malloc.h>  // For mallopt
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+
+namespace {
+
+const int CAP_IPC_LOCK_BIT = 14; // CAP_IPC_LOCK in linux/capability.h
+
+// True if the effective capabilities (CapEff in /proc/self/status) include
+// CAP_IPC_LOCK, which lifts RLIMIT_MEMLOCK.
+bool has_ipc_lock() {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.compare(0, 7, "CapEff:") == 0) {
+            unsigned long long caps = std::strtoull(line.c_str() + 7, nullptr, 16);
+            return (caps >> CAP_IPC_LOCK_BIT) & 1;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+bool lock_process_memory(std::string& error) {
+    // Checked up front: under MCL_FUTURE a mapping past the limit fails when
+    // it is made (a thread stack, the file mapping), long after mlockall
+    // itself succeeded.
+    struct rlimit limit;
+    if (!has_ipc_lock() && getrlimit(RLIMIT_MEMLOCK, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY) {
+        error = "RLIMIT_MEMLOCK is " + std::to_string(limit.rlim_cur / 1024) +
+                " KiB; needs CAP_IPC_LOCK or ulimit -l unlimited";
+        return false;
+    }
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        error = std::string("mlockall: ") + std::strerror(errno);
+        return false;
+    }
+    // Keep freed memory in the locked heap, and serve large blocks from it
+    // as well, instead of unmapping and mapping (and faulting) again.
+    mallopt(M_TRIM_THRESHOLD, -1);
+    mallopt(M_MMAP_MAX, 0);
+    return true;
+}
+
+bool set_current_thread_fifo(int priority, std::string& error) {
+    sched_param param;
+    param.sched_priority = priority;
+    int rc = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    if (rc != 0) {
+        error = std::strerror(rc);
+        return false;
+    }
+    return true;
+}
+
+int max_fifo_priority() {
+    return sched_get_priority_max(SCHED_FIFO);
+}
+
+std::string describe_realtime_thread(const RealtimeThreadStatus& status, const RealtimeConfig& config,
+                                     const std::vector<int>& isolated) {
+    std::string text = status.role + ": ";
+    if (status.cpu < 0) {
+        text += "not pinned";
+    } else if (!status.pinned) {
+        text += "pinning to CPU " + std::to_string(status.cpu) + " failed";
+    } else {
+        bool is_isolated = std::find(isolated.begin(), isolated.end(), status.cpu) != isolated.end();
+        text += "CPU " + std::to_string(status.cpu) + (is_isolated ? " (isolated)" : " (not isolated)");
+    }
+    if (config.fifo_priority <= 0) {
+        text += ", SCHED_OTHER";
+    } else if (status.fifo) {
+        text += ", SCHED_FIFO " + std::to_string(config.fifo_priority);
+    } else {
+        text += ", SCHED_FIFO refused: " + status.fifo_error;
+    }
+    return text;
+}
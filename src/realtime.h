@@ -0,0 +1,54 @@
+#ifndef REALTIME_H
+#define REALTIME_H
+
+#include <string>
+#include <vector>
+
+// Opt-in real-time mode for the stage threads (Linux), --realtime.
+//
+//  * Pinning: every stage thread runs on a core of its own (the "cores"
+//    placement). Without --cpus the isolated cores are used (isolcpus= on the
+//    kernel command line), so nothing else is scheduled there.
+//  * Scheduling: with --rt-priority, each stage thread switches itself to
+//    SCHED_FIFO at that priority, so ordinary threads no longer preempt it.
+//    Needs CAP_SYS_NICE or a high enough RLIMIT_RTPRIO.
+//  * Memory: before the lanes are built, mlockall(MCL_CURRENT | MCL_FUTURE)
+//    locks what is mapped and makes every later mapping (the batch arena,
+//    queues, stage buffers, thread stacks) fault in completely when it is
+//    created, and glibc is told to keep freed memory instead of handing it
+//    back to the kernel. After that a stage never takes a page fault. Needs
+//    CAP_IPC_LOCK or an unlimited RLIMIT_MEMLOCK.
+//
+// Every step reports whether it was applied; a refused step only prints why
+// and the run goes on without it.
+
+struct RealtimeConfig {
+    bool enabled = false;
+    int fifo_priority = 0; // 1-99: SCHED_FIFO at this priority; 0 = keep SCHED_OTHER
+};
+
+// Lock and prefault all memory of the process, now and to come. Returns false
+// with the reason in error when the kernel would refuse (or has refused).
+bool lock_process_memory(std::string& error);
+
+// Switch the calling thread to SCHED_FIFO at priority. Returns false with the
+// reason in error.
+bool set_current_thread_fifo(int priority, std::string& error);
+
+// The highest SCHED_FIFO priority (99 on Linux).
+int max_fifo_priority();
+
+// What one stage thread ended up with, for the startup report.
+struct RealtimeThreadStatus {
+    std::string role;       // "generator", "filter" or a stage name
+    int cpu = -1;           // Requested CPU; -1 = not pinned
+    bool pinned = false;
+    bool fifo = false;
+    std::string fifo_error; // Why SCHED_FIFO was refused
+};
+
+// "generator: CPU 2 (isolated), SCHED_FIFO 80" and the like.
+std::string describe_realtime_thread(const RealtimeThreadStatus& status, const RealtimeConfig& config,
+                                     const std::vector<int>& isolated);
+
+#endif // REALTIME_H
@@ -0,0 +1,557 @@
+#include "result_sink.h"
+#include <cstdio>  // For std::snprintf
+#include <cstring> // For std::memcpy
+#include <iostream> // For std::cerr
+#include <limits>
+#include <algorithm> // For std::fill, std::min, std::max
+#include <sstream>
+
+namespace {
+
+// Append v to out as little-endian bytes.
+template <typename T>
+void append_le(std::vector<uint8_t>& out, T v) {
+    for (size_t i = 0; i < sizeof(T); ++i) {
+        out.push_back(static_cast<uint8_t>(v >> (8 * i)));
+    }
+}
+
+// Write the 16-byte header shared by the binary sinks at the current position.
+void write_header(std::ofstream& file, const char magic[4], uint32_t m, uint64_t pixels) {
+    std::vector<uint8_t> header(magic, magic + 4);
+    append_le(header, m);
+    append_le(header, pixels);
+    file.write(reinterpret_cast<const char*>(header.data()), static_cast<std::streamsize>(header.size()));
+}
+
+const size_t HEADER_SIZE = 16;
+
+} // namespace
+
+std::string NullSink::summary() const {
+    std::ostringstream out;
+    out << "null sink, " << results_ << " results discarded";
+    return out.str();
+}
+
+TextSink::TextSink(std::ostream& out, uint64_t sample_every)
+    : out_(out),
+      sample_every_(sample_every == 0 ? 1 : sample_every),
+      results_(0),
+      lines_(0) {
+    buffer_.reserve(FLUSH_THRESHOLD + 256);
+}
+
+TextSink::~TextSink() {
+    flush_buffer();
+}
+
+void TextSink::write(uint64_t /*index*/, uint8_t center_value, double filtered_value, bool defect) {
+    if (results_++ % sample_every_ != 0) {
+        return;
+    }
+    // Same text as the original std::fixed / setprecision(4) stream output.
+    char line[160];
+    int length = std::snprintf(line, sizeof(line),
+                               "Filtered Output for element value %d (window center): "
+                               "Filtered val = %.4f, Thresholded = %s\n",
+                               static_cast<int>(center_value), filtered_value,
+                               defect ? "1 (Defect)" : "0 (No Defect)");
+    if (length > 0) {
+        buffer_.append(line, static_cast<size_t>(length) < sizeof(line) ? static_cast<size_t>(length) : sizeof(line) - 1);
+    }
+    ++lines_;
+    if (buffer_.size() >= FLUSH_THRESHOLD) {
+        flush_buffer();
+    }
+}
+
+void TextSink::finish() {
+    flush_buffer();
+}
+
+void TextSink::flush_buffer() {
+    if (!buffer_.empty()) {
+        out_.write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+        out_.flush();
+        buffer_.clear();
+    }
+}
+
+std::string TextSink::summary() const {
+    std::ostringstream out;
+    out << "text sink, " << lines_ << " of " << results_ << " results printed";
+    if (sample_every_ > 1) {
+        out << " (every " << sample_every_ << ")";
+    }
+    return out.str();
+}
+
+BitmapSink::BitmapSink(const std::string& path, int m)
+    : path_(path),
+      file_(path, std::ios::binary | std::ios::trunc),
+      m_(m > 0 ? static_cast<uint32_t>(m) : 0),
+      row_width_(m > 0 ? static_cast<uint64_t>(m) : 8),
+      current_row_(0),
+      row_bits_((row_width_ + 7) / 8, 0),
+      pixels_covered_(0),
+      defects_(0),
+      bytes_written_(0),
+      finished_(false) {
+    if (!file_.is_open()) {
+        std::cerr << "BitmapSink Error: Could not open output file " << path << std::endl;
+        return;
+    }
+    // Placeholder header; the pixel count is filled in by finish().
+    write_header(file_, "LRBM", m_, 0);
+    buffer_.reserve(FLUSH_THRESHOLD + row_bits_.size());
+}
+
+BitmapSink::~BitmapSink() {
+    finish();
+}
+
+void BitmapSink::write(uint64_t index, uint8_t /*center_value*/, double /*filtered_value*/, bool defect) {
+    uint64_t row = index / row_width_;
+    while (current_row_ < row) {
+        emit_row(); // Also emits rows that had no results at all
+    }
+    if (defect) {
+        uint64_t column = index - row * row_width_;
+        row_bits_[column >> 3] |= static_cast<uint8_t>(1u << (column & 7));
+        ++defects_;
+    }
+    if (index + 1 > pixels_covered_) {
+        pixels_covered_ = index + 1;
+    }
+}
+
+void BitmapSink::emit_row() {
+    buffer_.insert(buffer_.end(), row_bits_.begin(), row_bits_.end());
+    std::fill(row_bits_.begin(), row_bits_.end(), 0);
+    ++current_row_;
+    if (buffer_.size() >= FLUSH_THRESHOLD) {
+        flush_buffer();
+    }
+}
+
+void BitmapSink::flush_buffer() {
+    if (!buffer_.empty() && file_.is_open()) {
+        file_.write(reinterpret_cast<const char*>(buffer_.data()), static_cast<std::streamsize>(buffer_.size()));
+        bytes_written_ += buffer_.size();
+    }
+    buffer_.clear();
+}
+
+void BitmapSink::finish() {
+    if (finished_ || !file_.is_open()) {
+        return;
+    }
+    finished_ = true;
+    // The last, possibly partial, row.
+    if (pixels_covered_ > current_row_ * row_width_) {
+        emit_row();
+    }
+    flush_buffer();
+    file_.seekp(0);
+    write_header(file_, "LRBM", m_, pixels_covered_);
+    file_.close();
+    bytes_written_ += HEADER_SIZE;
+}
+
+std::string BitmapSink::summary() const {
+    std::ostringstream out;
+    out << "bitmap sink, " << pixels_covered_ << " pixels (" << defects_ << " defects) in "
+        << bytes_written_ << " bytes to " << path_;
+    return out.str();
+}
+
+RleSink::RleSink(const std::string& path, int m)
+    : path_(path),
+      file_(path, std::ios::binary | std::ios::trunc),
+      m_(m > 0 ? static_cast<uint32_t>(m) : 0),
+      in_run_(false),
+      run_start_(0),
+      run_end_(0),
+      pixels_covered_(0),
+      runs_(0),
+      bytes_written_(0),
+      finished_(false) {
+    if (!file_.is_open()) {
+        std::cerr << "RleSink Error: Could not open output file " << path << std::endl;
+        return;
+    }
+    write_header(file_, "LRRL", m_, 0);
+    buffer_.reserve(FLUSH_THRESHOLD + 16);
+}
+
+RleSink::~RleSink() {
+    finish();
+}
+
+void RleSink::write(uint64_t index, uint8_t /*center_value*/, double /*filtered_value*/, bool defect) {
+    if (defect) {
+        if (in_run_ && index == run_end_) {
+            ++run_end_;
+        } else {
+            close_run();
+            in_run_ = true;
+            run_start_ = index;
+            run_end_ = index + 1;
+        }
+    } else {
+        close_run();
+    }
+    if (index + 1 > pixels_covered_) {
+        pixels_covered_ = index + 1;
+    }
+}
+
+void RleSink::close_run() {
+    if (!in_run_) {
+        return;
+    }
+    in_run_ = false;
+    append_le(buffer_, run_start_);
+    append_le(buffer_, run_end_ - run_start_);
+    ++runs_;
+    if (buffer_.size() >= FLUSH_THRESHOLD) {
+        flush_buffer();
+    }
+}
+
+void RleSink::flush_buffer() {
+    if (!buffer_.empty() && file_.is_open()) {
+        file_.write(reinterpret_cast<const char*>(buffer_.data()), static_cast<std::streamsize>(buffer_.size()));
+        bytes_written_ += buffer_.size();
+    }
+    buffer_.clear();
+}
+
+void RleSink::finish() {
+    if (finished_ || !file_.is_open()) {
+        return;
+    }
+    finished_ = true;
+    close_run();
+    flush_buffer();
+    file_.seekp(0);
+    write_header(file_, "LRRL", m_, pixels_covered_);
+    file_.close();
+    bytes_written_ += HEADER_SIZE;
+}
+
+std::string RleSink::summary() const {
+    std::ostringstream out;
+    out << "rle sink, " << pixels_covered_ << " pixels, " << runs_ << " defect runs in "
+        << bytes_written_ << " bytes to " << path_;
+    return out.str();
+}
+
+EventSink::EventSink(const std::string& path, int m)
+    : path_(path),
+      file_(path, std::ios::binary | std::ios::trunc),
+      m_(m > 0 ? static_cast<uint32_t>(m) : 0),
+      in_run_(false),
+      run_start_(0),
+      run_end_(0),
+      run_peak_(0.0),
+      pixels_covered_(0),
+      events_(0),
+      bytes_written_(0),
+      finished_(false) {
+    if (!file_.is_open()) {
+        std::cerr << "EventSink Error: Could not open output file " << path << std::endl;
+        return;
+    }
+    write_header(file_, "LREV", m_, 0);
+    buffer_.reserve(FLUSH_THRESHOLD + RECORD_SIZE);
+}
+
+EventSink::~EventSink() {
+    finish();
+}
+
+void EventSink::write(uint64_t index, uint8_t /*center_value*/, double filtered_value, bool defect) {
+    if (defect) {
+        if (in_run_ && index == run_end_) {
+            ++run_end_;
+            run_peak_ = std::max(run_peak_, filtered_value);
+        } else {
+            close_run();
+            in_run_ = true;
+            run_start_ = index;
+            run_end_ = index + 1;
+            run_peak_ = filtered_value;
+        }
+    } else {
+        close_run();
+    }
+    if (index + 1 > pixels_covered_) {
+        pixels_covered_ = index + 1;
+    }
+}
+
+void EventSink::close_run() {
+    if (!in_run_) {
+        return;
+    }
+    in_run_ = false;
+    uint64_t peak_bits = 0;
+    std::memcpy(&peak_bits, &run_peak_, sizeof(peak_bits));
+    append_le(buffer_, run_start_);
+    append_le(buffer_, run_end_);
+    append_le(buffer_, peak_bits);
+    ++events_;
+    if (buffer_.size() >= FLUSH_THRESHOLD) {
+        flush_buffer();
+    }
+}
+
+void EventSink::flush_buffer() {
+    if (!buffer_.empty() && file_.is_open()) {
+        file_.write(reinterpret_cast<const char*>(buffer_.data()), static_cast<std::streamsize>(buffer_.size()));
+        bytes_written_ += buffer_.size();
+    }
+    buffer_.clear();
+}
+
+void EventSink::finish() {
+    if (finished_ || !file_.is_open()) {
+        return;
+    }
+    finished_ = true;
+    close_run();
+    flush_buffer();
+    file_.seekp(0);
+    write_header(file_, "LREV", m_, pixels_covered_);
+    file_.close();
+    bytes_written_ += HEADER_SIZE;
+}
+
+std::string EventSink::summary() const {
+    std::ostringstream out;
+    out << "event sink, " << pixels_covered_ << " pixels, " << events_ << " defect events in "
+        << bytes_written_ << " bytes to " << path_;
+    return out.str();
+}
+
+RegionSink::RegionSink(const std::string& path, int m)
+    : path_(path),
+      file_(path, std::ios::binary | std::ios::trunc),
+      m_(m > 0 ? static_cast<uint32_t>(m) : 1),
+      current_line_(0),
+      in_run_(false),
+      run_start_(0),
+      run_end_(0),
+      run_area_(0),
+      run_peak_(0.0),
+      previous_cursor_(0),
+      pixels_covered_(0),
+      defects_(0),
+      regions_written_(0),
+      bytes_written_(0),
+      finished_(false) {
+    if (!file_.is_open()) {
+        std::cerr << "RegionSink Error: Could not open output file " << path << std::endl;
+        return;
+    }
+    write_header(file_, "LRDR", m_, 0);
+    // Everything the steady state touches, sized for the worst line.
+    size_t max_runs = (m_ + 1) / 2;
+    previous_runs_.reserve(max_runs);
+    current_runs_.reserve(max_runs);
+    size_t slots = static_cast<size_t>(m_) + 2;
+    regions_.resize(slots);
+    parent_.resize(slots);
+    marks_.assign(slots, 0);
+    free_slots_.reserve(slots);
+    for (size_t slot = slots; slot-- > 0;) {
+        free_slots_.push_back(static_cast<uint32_t>(slot));
+    }
+    buffer_.reserve(FLUSH_THRESHOLD + RECORD_SIZE);
+}
+
+RegionSink::~RegionSink() {
+    finish();
+}
+
+void RegionSink::write(uint64_t index, uint8_t /*center_value*/, double filtered_value, bool defect) {
+    uint64_t line = index / m_;
+    if (line != current_line_) {
+        // Two line ends flush every open region; further empty lines change nothing.
+        end_line();
+        if (line != current_line_) {
+            end_line();
+            current_line_ = line;
+        }
+    }
+    uint32_t column = static_cast<uint32_t>(index - line * m_);
+    if (defect) {
+        if (!in_run_ || column != run_end_) {
+            close_run();
+            in_run_ = true;
+            run_start_ = column;
+            run_area_ = 0;
+            run_peak_ = filtered_value;
+        }
+        run_end_ = column + 1;
+        ++run_area_;
+        run_peak_ = std::max(run_peak_, filtered_value);
+        ++defects_;
+    } else {
+        close_run();
+    }
+    if (index + 1 > pixels_covered_) {
+        pixels_covered_ = index + 1;
+    }
+}
+
+uint32_t RegionSink::find(uint32_t slot) {
+    while (parent_[slot] != slot) {
+        parent_[slot] = parent_[parent_[slot]]; // Path halving
+        slot = parent_[slot];
+    }
+    return slot;
+}
+
+uint32_t RegionSink::unite(uint32_t into, uint32_t from) {
+    Region& target = regions_[into];
+    const Region& source = regions_[from];
+    target.first_line = std::min(target.first_line, source.first_line);
+    target.last_line = std::max(target.last_line, source.last_line);
+    target.first_column = std::min(target.first_column, source.first_column);
+    target.last_column = std::max(target.last_column, source.last_column);
+    target.area += source.area;
+    target.peak = std::max(target.peak, source.peak);
+    parent_[from] = into;
+    return into;
+}
+
+uint32_t RegionSink::allocate(uint64_t line, uint32_t column) {
+    if (free_slots_.empty()) {
+        // Cannot happen with runs of two lines; grow rather than lose a region.
+        regions_.push_back(Region());
+        parent_.push_back(0);
+        marks_.push_back(0);
+        free_slots_.push_back(static_cast<uint32_t>(regions_.size() - 1));
+    }
+    uint32_t slot = free_slots_.back();
+    free_slots_.pop_back();
+    parent_[slot] = slot;
+    // No peak yet: filtered values can be negative (and so can TV).
+    regions_[slot] = Region{line, line, column, column, 0, -std::numeric_limits<double>::infinity()};
+    return slot;
+}
+
+void RegionSink::close_run() {
+    if (!in_run_) {
+        return;
+    }
+    in_run_ = false;
+    // Previous runs touching [start - 1, end] are 8-connected to this one.
+    while (previous_cursor_ < previous_runs_.size() && previous_runs_[previous_cursor_].end < run_start_) {
+        ++previous_cursor_;
+    }
+    uint32_t region = UINT32_MAX;
+    size_t k = previous_cursor_;
+    for (; k < previous_runs_.size() && previous_runs_[k].start <= run_end_; ++k) {
+        uint32_t root = find(previous_runs_[k].region);
+        if (region == UINT32_MAX) {
+            region = root;
+        } else if (root != region) {
+            region = unite(region, root);
+        }
+    }
+    // The last previous run touched may reach under the next run as well.
+    if (k > previous_cursor_) {
+        previous_cursor_ = k - 1;
+    }
+    if (region == UINT32_MAX) {
+        region = allocate(current_line_, run_start_);
+    }
+    Region& target = regions_[region];
+    target.last_line = current_line_;
+    target.first_column = std::min(target.first_column, run_start_);
+    target.last_column = std::max(target.last_column, run_end_ - 1);
+    target.area += run_area_;
+    target.peak = std::max(target.peak, run_peak_);
+    current_runs_.push_back(Run{run_start_, run_end_, region});
+}
+
+void RegionSink::end_line() {
+    close_run();
+    // Regions of the previous line that no run of this line continued are done.
+    std::fill(marks_.begin(), marks_.end(), 0);
+    for (const Run& run : previous_runs_) {
+        uint32_t root = find(run.region);
+        if (regions_[root].last_line < current_line_ && !marks_[root]) {
+            marks_[root] = 1;
+            emit(regions_[root]);
+        }
+    }
+    // Keep only the regions the current runs belong to; every other slot,
+    // finished or merged away, is free again.
+    std::fill(marks_.begin(), marks_.end(), 0);
+    for (Run& run : current_runs_) {
+        run.region = find(run.region);
+        marks_[run.region] = 1;
+    }
+    free_slots_.clear();
+    for (size_t slot = marks_.size(); slot-- > 0;) {
+        if (marks_[slot]) {
+            parent_[slot] = static_cast<uint32_t>(slot);
+        } else {
+            free_slots_.push_back(static_cast<uint32_t>(slot));
+        }
+    }
+    previous_runs_.swap(current_runs_);
+    current_runs_.clear();
+    previous_cursor_ = 0;
+    ++current_line_;
+}
+
+void RegionSink::emit(const Region& region) {
+    uint64_t peak_bits = 0;
+    std::memcpy(&peak_bits, &region.peak, sizeof(peak_bits));
+    append_le(buffer_, region.first_line);
+    append_le(buffer_, region.last_line);
+    append_le(buffer_, region.first_column);
+    append_le(buffer_, region.last_column);
+    append_le(buffer_, region.area);
+    append_le(buffer_, peak_bits);
+    ++regions_written_;
+    if (buffer_.size() >= FLUSH_THRESHOLD) {
+        flush_buffer();
+    }
+}
+
+void RegionSink::flush_buffer() {
+    if (!buffer_.empty() && file_.is_open()) {
+        file_.write(reinterpret_cast<const char*>(buffer_.data()), static_cast<std::streamsize>(buffer_.size()));
+        bytes_written_ += buffer_.size();
+    }
+    buffer_.clear();
+}
+
+void RegionSink::finish() {
+    if (finished_ || !file_.is_open()) {
+        return;
+    }
+    finished_ = true;
+    // The last line, then an empty one that ends whatever it continued.
+    end_line();
+    end_line();
+    flush_buffer();
+    file_.seekp(0);
+    write_header(file_, "LRDR", m_, pixels_covered_);
+    file_.close();
+    bytes_written_ += HEADER_SIZE;
+}
+
+std::string RegionSink::summary() const {
+    std::ostringstream out;
+    out << "region sink, " << pixels_covered_ << " pixels, " << defects_ << " defects in "
+        << regions_written_ << " regions, " << bytes_written_ << " bytes to " << path_;
+    return out.str();
+}
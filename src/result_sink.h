@@ -0,0 +1,269 @@
+#ifndef RESULT_SINK_H
+#define RESULT_SINK_H
+
+#include <cstdint> // For uint8_t, uint64_t
+#include <cstddef> // For size_t
+#include <fstream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Destination for the filter's per-pixel results.
+//
+// FilterThreshold calls write() once per filtered pixel, in stream order.
+// index is the stream position of the window center, so the first result has
+// index FilterThreshold::past_elements() (the first pixels never get a full
+// window). Sinks buffer internally and write in large chunks; finish() is
+// called once after the last result and must push everything out.
+class ResultSink {
+public:
+    virtual ~ResultSink() = default;
+
+    virtual void write(uint64_t index, uint8_t center_value, double filtered_value, bool defect) = 0;
+    virtual void finish() {}
+
+    // One-line description of what was written, for the end-of-run report.
+    virtual std::string summary() const = 0;
+};
+
+// Discards every result. For benchmarks and when only the counters matter.
+class NullSink : public ResultSink {
+public:
+    NullSink() : results_(0) {}
+
+    void write(uint64_t, uint8_t, double, bool) override { ++results_; }
+    std::string summary() const override;
+
+private:
+    uint64_t results_;
+};
+
+// The original "Filtered Output for element value ..." line format, written
+// to an ostream in large chunks instead of flushing after every line. With
+// sample_every = N only every Nth result is printed (N = 1 prints them all).
+class TextSink : public ResultSink {
+public:
+    explicit TextSink(std::ostream& out, uint64_t sample_every = 1);
+    ~TextSink() override;
+
+    void write(uint64_t index, uint8_t center_value, double filtered_value, bool defect) override;
+    void finish() override;
+    std::string summary() const override;
+
+private:
+    void flush_buffer();
+
+    static const size_t FLUSH_THRESHOLD = 64 * 1024;
+
+    std::ostream& out_;
+    uint64_t sample_every_;
+    uint64_t results_;
+    uint64_t lines_;
+    std::string buffer_;
+};
+
+// Bit-packed defect map: 1 bit per pixel (1 = defect), LSB first.
+//
+// File layout (little-endian):
+//   char[4]  magic "LRBM"
+//   uint32   m, the row width in pixels (0 = unstructured stream)
+//   uint64   number of pixels covered
+//   rows     ceil(m / 8) bytes per row, each row starting on a byte boundary
+// For m = 0 the pixels are packed back to back. Pixels without a result (the
+// first and last few of the stream) are 0.
+class BitmapSink : public ResultSink {
+public:
+    BitmapSink(const std::string& path, int m);
+    ~BitmapSink() override;
+
+    bool is_open() const { return file_.is_open(); }
+
+    void write(uint64_t index, uint8_t center_value, double filtered_value, bool defect) override;
+    void finish() override;
+    std::string summary() const override;
+
+private:
+    void emit_row();
+    void flush_buffer();
+
+    static const size_t FLUSH_THRESHOLD = 64 * 1024;
+
+    std::string path_;
+    std::ofstream file_;
+    uint32_t m_;
+    uint64_t row_width_;        // Pixels per row (8 when m = 0)
+    uint64_t current_row_;      // Row number held in row_bits_
+    std::vector<uint8_t> row_bits_;
+    std::vector<uint8_t> buffer_; // Completed rows waiting to be written
+    uint64_t pixels_covered_;     // One past the highest index seen
+    uint64_t defects_;
+    uint64_t bytes_written_;
+    bool finished_;
+};
+
+// Run-length encoded defect intervals: one record per maximal run of
+// consecutive defect pixels.
+//
+// File layout (little-endian):
+//   char[4]  magic "LRRL"
+//   uint32   m, the row width in pixels (0 = unstructured stream)
+//   uint64   number of pixels covered
+//   records  { uint64 first_index, uint64 length } in increasing order
+// Runs follow the flat pixel stream and may cross row boundaries; divide by m
+// to get row and column.
+class RleSink : public ResultSink {
+public:
+    RleSink(const std::string& path, int m);
+    ~RleSink() override;
+
+    bool is_open() const { return file_.is_open(); }
+
+    void write(uint64_t index, uint8_t center_value, double filtered_value, bool defect) override;
+    void finish() override;
+    std::string summary() const override;
+
+private:
+    void close_run();
+    void flush_buffer();
+
+    static const size_t FLUSH_THRESHOLD = 64 * 1024;
+
+    std::string path_;
+    std::ofstream file_;
+    uint32_t m_;
+    bool in_run_;
+    uint64_t run_start_;
+    uint64_t run_end_;          // One past the last defect of the open run
+    std::vector<uint8_t> buffer_;
+    uint64_t pixels_covered_;
+    uint64_t runs_;
+    uint64_t bytes_written_;
+    bool finished_;
+};
+
+// Defect-only sparse output: one event per defect run, written when the run
+// ends, so a clean web produces almost no output at all.
+//
+// File layout (little-endian):
+//   char[4]  magic "LREV"
+//   uint32   m, the row width in pixels (0 = unstructured stream)
+//   uint64   number of pixels covered
+//   records  { uint64 start_index, uint64 end_index, double peak } (24 bytes)
+// start_index is the first defect pixel (the 0 -> 1 transition), end_index
+// the first clean pixel after the run (1 -> 0), and peak the highest filtered
+// value inside it. Like RleSink, a run follows the flat stream and ends at a
+// gap in the result indices.
+class EventSink : public ResultSink {
+public:
+    EventSink(const std::string& path, int m);
+    ~EventSink() override;
+
+    bool is_open() const { return file_.is_open(); }
+
+    void write(uint64_t index, uint8_t center_value, double filtered_value, bool defect) override;
+    void finish() override;
+    std::string summary() const override;
+
+    static const size_t RECORD_SIZE = 24;
+
+private:
+    void close_run();
+    void flush_buffer();
+
+    static const size_t FLUSH_THRESHOLD = 64 * 1024;
+
+    std::string path_;
+    std::ofstream file_;
+    uint32_t m_;
+    bool in_run_;
+    uint64_t run_start_;
+    uint64_t run_end_;          // One past the last defect of the open run
+    double run_peak_;
+    std::vector<uint8_t> buffer_;
+    uint64_t pixels_covered_;
+    uint64_t events_;
+    uint64_t bytes_written_;
+    bool finished_;
+};
+
+// Connected defect regions: one record per finished 8-connected blob of
+// defect pixels, found in a single pass over the results of each line.
+//
+// Only the runs of the previous and the current line are kept, together with
+// the statistics of the regions they belong to (O(m) memory, all allocated in
+// the constructor). A region is written as soon as a line ends without
+// continuing it, so records appear in the order regions finish.
+//
+// File layout (little-endian):
+//   char[4]  magic "LRDR"
+//   uint32   m, the row width in pixels
+//   uint64   number of pixels covered
+//   records  { uint64 first_line, uint64 last_line, uint32 first_column,
+//              uint32 last_column, uint64 area, double peak } (40 bytes)
+// The bounding box is inclusive; area counts defect pixels and peak is the
+// highest filtered value inside the region. Needs m > 0.
+class RegionSink : public ResultSink {
+public:
+    RegionSink(const std::string& path, int m);
+    ~RegionSink() override;
+
+    bool is_open() const { return file_.is_open(); }
+
+    void write(uint64_t index, uint8_t center_value, double filtered_value, bool defect) override;
+    void finish() override;
+    std::string summary() const override;
+
+    static const size_t RECORD_SIZE = 40;
+
+private:
+    struct Region {
+        uint64_t first_line;
+        uint64_t last_line;
+        uint32_t first_column;
+        uint32_t last_column;
+        uint64_t area;
+        double peak;
+    };
+
+    // A maximal span [start, end) of defect columns in one line.
+    struct Run {
+        uint32_t start;
+        uint32_t end;
+        uint32_t region; // Slot; resolve with find()
+    };
+
+    void close_run();
+    void end_line();
+    uint32_t find(uint32_t slot);
+    uint32_t unite(uint32_t into, uint32_t from);
+    uint32_t allocate(uint64_t line, uint32_t column);
+    void emit(const Region& region);
+    void flush_buffer();
+
+    static const size_t FLUSH_THRESHOLD = 64 * 1024;
+
+    std::string path_;
+    std::ofstream file_;
+    uint32_t m_;
+    uint64_t current_line_;
+    bool in_run_;
+    uint32_t run_start_;
+    uint32_t run_end_;
+    uint64_t run_area_;
+    double run_peak_;
+    std::vector<Run> previous_runs_;
+    std::vector<Run> current_runs_;
+    size_t previous_cursor_;     // First previous run that may touch the next run
+    std::vector<Region> regions_; // Slots, m + 2 (runs of two lines, each at most ceil(m / 2))
+    std::vector<uint32_t> parent_; // Union-find over the slots
+    std::vector<uint32_t> free_slots_;
+    std::vector<uint8_t> marks_;
+    std::vector<uint8_t> buffer_;
+    uint64_t pixels_covered_;
+    uint64_t defects_;
+    uint64_t regions_written_;
+    uint64_t bytes_written_;
+    bool finished_;
+};
+
+#endif // RESULT_SINK_H
@@ -0,0 +1,75 @@
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include <cstddef> // For size_t
+#include <utility> // For std::move
+#include <vector>
+
+// Double-ended FIFO on one circular array, replacing std::deque / std::queue
+// on the hot paths. A deque allocates and frees a chunk every few hundred
+// elements as it moves through memory; this buffer only allocates when it
+// has to grow (doubling, never shrinking), so after reserve() or once it has
+// reached its largest depth, pushing and popping never touch the allocator.
+// Not thread-safe; the owner locks.
+template <typename T>
+class RingBuffer {
+public:
+    explicit RingBuffer(size_t initial_capacity = 16)
+        : slots_(round_up(initial_capacity)), head_(0), count_(0) {}
+
+    void push_back(T item) {
+        if (count_ == slots_.size()) {
+            grow(slots_.size() * 2);
+        }
+        slots_[(head_ + count_) & (slots_.size() - 1)] = std::move(item);
+        ++count_;
+    }
+
+    T& front() { return slots_[head_]; }
+    T& back() { return slots_[(head_ + count_ - 1) & (slots_.size() - 1)]; }
+
+    void pop_front() {
+        slots_[head_] = T(); // Release what the slot holds now, not when it is overwritten
+        head_ = (head_ + 1) & (slots_.size() - 1);
+        --count_;
+    }
+    void pop_back() {
+        back() = T();
+        --count_;
+    }
+
+    // Make room for capacity elements up front.
+    void reserve(size_t capacity) {
+        if (capacity > slots_.size()) {
+            grow(round_up(capacity));
+        }
+    }
+
+    size_t size() const { return count_; }
+    bool empty() const { return count_ == 0; }
+    size_t capacity() const { return slots_.size(); }
+
+private:
+    static size_t round_up(size_t n) {
+        size_t capacity = 1;
+        while (capacity < n) {
+            capacity <<= 1;
+        }
+        return capacity;
+    }
+
+    void grow(size_t capacity) {
+        std::vector<T> slots(capacity);
+        for (size_t i = 0; i < count_; ++i) {
+            slots[i] = std::move(slots_[(head_ + i) & (slots_.size() - 1)]);
+        }
+        slots_.swap(slots);
+        head_ = 0;
+    }
+
+    std::vector<T> slots_; // Power-of-two size
+    size_t head_;
+    size_t count_;
+};
+
+#endif // RING_BUFFER_H
@@ -0,0 +1,91 @@
+#ifndef ROW_FILTER_H
+#define ROW_FILTER_H
+
+#include <vector>
+#include <cstdint> // For uint8_t
+#include <cstddef> // For size_t
+
+// Row-aware filtering: the pixel stream is cut into scan lines of m pixels and
+// the horizontal window never reaches into the neighbouring line.
+
+// What the window sees beyond the first and last pixel of a line (and, for the
+// vertical pass, beyond the first and last line of the stream).
+enum class EdgeMode {
+    Clamp,  // Repeat the edge pixel:        c b a | a b c
+    Mirror, // Reflect around the edge pixel: c b | a b c
+    Skip    // No result for pixels whose window does not fit inside the line
+};
+
+struct RowFilterConfig {
+    EdgeMode edge = EdgeMode::Clamp;
+    // Height K of the vertical kernel, odd. 1 = horizontal only. The vertical
+    // taps are the normalized binomial row of length K (1 2 1, 1 4 6 4 1, ...),
+    // applied to K horizontally filtered lines.
+    size_t lines = 1;
+};
+
+// Map a possibly out-of-range position onto [first, last] according to mode
+// (Clamp and Mirror only). Mirror positions are clamped as well, for lines
+// or streams shorter than the window.
+inline long edge_position(long position, long first, long last, EdgeMode mode) {
+    if (mode == EdgeMode::Mirror) {
+        if (position < first) {
+            position = 2 * first - position;
+        } else if (position > last) {
+            position = 2 * last - position;
+        }
+    }
+    if (position < first) {
+        return first;
+    }
+    if (position > last) {
+        return last;
+    }
+    return position;
+}
+
+// Copy one line of m pixels into out with before pixels of edge extension in
+// front and after pixels behind it (out must hold before + m + after). A window
+// of before + after + 1 taps over out[c ..] then has its center tap (index
+// before) on line pixel c.
+inline void pad_row(const uint8_t* row, size_t m, size_t before, size_t after, EdgeMode mode, uint8_t* out) {
+    long last = static_cast<long>(m) - 1;
+    for (size_t i = 0; i < before; ++i) {
+        long offset = static_cast<long>(before - i);
+        out[i] = row[edge_position(-offset, 0, last, mode)];
+    }
+    for (size_t i = 0; i < after; ++i) {
+        out[before + m + i] = row[edge_position(last + 1 + static_cast<long>(i), 0, last, mode)];
+    }
+    for (size_t i = 0; i < m; ++i) {
+        out[before + i] = row[i];
+    }
+}
+
+// Centered case: pad pixels on each side (out must hold m + 2 * pad).
+inline void pad_row(const uint8_t* row, size_t m, size_t pad, EdgeMode mode, uint8_t* out) {
+    pad_row(row, m, pad, pad, mode, out);
+}
+
+// Normalized binomial kernel of the given (odd) length; {1.0} for length 1.
+inline std::vector<double> binomial_kernel(size_t length) {
+    std::vector<double> taps(1, 1.0);
+    for (size_t n = 1; n < length; ++n) {
+        std::vector<double> next(n + 1, 0.0);
+        for (size_t i = 0; i < n; ++i) {
+            next[i] += taps[i];
+            next[i + 1] += taps[i];
+        }
+        taps.swap(next);
+    }
+    double total = 0.0;
+    for (double tap : taps) {
+        total += tap;
+    }
+    for (double& tap : taps) {
+        tap /= total;
+    }
+    return taps;
+}
+
+#endif // ROW_FILTER_H
@@ -0,0 +1,611 @@
+#include "run_options.h"
+#include "metrics.h"
+#include "scan_file.h"
+#include "thread_affinity.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <fstream>
+#include <initializer_list>
+#include <iostream>
+#include <utility>
+
+namespace {
+
+bool parse_unsigned(const std::string& value, long long& out) {
+    char* end = nullptr;
+    errno = 0;
+    out = std::strtoll(value.c_str(), &end, 10);
+    return !value.empty() && *end == '\0' && errno == 0 && out >= 0;
+}
+
+bool parse_number(const std::string& value, double& out) {
+    char* end = nullptr;
+    out = std::strtod(value.c_str(), &end);
+    return !value.empty() && *end == '\0';
+}
+
+bool parse_flag(const std::string& value, bool& out) {
+    if (value == "yes" || value == "true" || value == "1") {
+        out = true;
+    } else if (value == "no" || value == "false" || value == "0") {
+        out = false;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Look value up in a name -> enum table; on failure list the valid names.
+template <typename T>
+bool parse_choice(const std::string& value, std::initializer_list<std::pair<const char*, T>> choices,
+                  T& out, std::string& error) {
+    std::string names;
+    for (const auto& choice : choices) {
+        if (value == choice.first) {
+            out = choice.second;
+            return true;
+        }
+        names += names.empty() ? "" : ", ";
+        names += choice.first;
+    }
+    error = "expected one of " + names;
+    return false;
+}
+
+std::string trim(const std::string& text) {
+    size_t first = text.find_first_not_of(" \t\r\n");
+    if (first == std::string::npos) {
+        return "";
+    }
+    size_t last = text.find_last_not_of(" \t\r\n");
+    return text.substr(first, last - first + 1);
+}
+
+bool is_flag_key(const std::string& key) {
+    return key == "record-lz4" || key == "hugepages" || key == "alloc-check" || key == "realtime" || key == "verify";
+}
+
+bool is_integer_key(const std::string& key) {
+    static const char* const keys[] = {
+        "m", "t-ns", "lanes", "read-ahead", "read-ahead-kib", "queue-capacity", "batch-size",
+        "workers", "chunk-size", "lines", "pixels", "ops-per-deadline", "sample-every",
+        "stats-interval-ms", "synthetic-background", "synthetic-noise", "synthetic-radius",
+        "high-watermark", "low-watermark", "decimate", "min-run", "rt-priority", "shm-slots", "shm-wait-ms",
+        "shadow-every",
+    };
+    for (const char* integer_key : keys) {
+        if (key == integer_key) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+bool parse_generated_source(const std::string& text, bool& synthetic, uint64_t& seed) {
+    std::string kind = text.substr(0, text.find(':'));
+    if (kind != "random" && kind != "synthetic") {
+        return false;
+    }
+    synthetic = (kind == "synthetic");
+    seed = 0;
+    if (kind.size() < text.size()) {
+        try {
+            seed = std::stoull(text.substr(kind.size() + 1));
+        } catch (const std::exception&) {
+            std::cerr << "Invalid seed, using a random one." << std::endl;
+        }
+    }
+    return true;
+}
+
+bool read_kernel_option(const std::string& text, KernelSpec& kernel, std::string& error) {
+    return std::ifstream(text).good() ? load_kernel_spec(text, kernel, error)
+                                      : parse_kernel_spec(text, kernel, error);
+}
+
+bool parse_hysteresis_option(const std::string& text, HysteresisConfig& hysteresis, std::string& error) {
+    size_t comma = text.find(',');
+    double band = 0.0;
+    long long min_run = 1;
+    if (!parse_number(trim(text.substr(0, comma)), band) || band < 0.0) {
+        error = "expected a non-negative band, got '" + text + "'";
+        return false;
+    }
+    if (comma != std::string::npos && !parse_unsigned(trim(text.substr(comma + 1)), min_run)) {
+        error = "expected a non-negative minimum run after the comma, got '" + text + "'";
+        return false;
+    }
+    hysteresis.band = band;
+    hysteresis.min_run = static_cast<size_t>(min_run);
+    return true;
+}
+
+bool set_option(RunOptions& options, const std::string& key, const std::string& value, std::string& error) {
+    long long number = 0;
+    double real = 0.0;
+    std::string message;
+    bool ok = true;
+
+    if (is_integer_key(key)) {
+        if (!parse_unsigned(value, number)) {
+            error = "--" + key + ": expected a non-negative integer, got '" + value + "'";
+            return false;
+        }
+        size_t size = static_cast<size_t>(number);
+        if (key == "m") {
+            options.m = static_cast<int>(number);
+        } else if (key == "t-ns") {
+            options.t_ns = number;
+        } else if (key == "lanes") {
+            options.lane_count = static_cast<int>(number);
+        } else if (key == "read-ahead") {
+            options.prefetch.depth = size;
+        } else if (key == "read-ahead-kib") {
+            options.prefetch.chunk_bytes = (size > 0 ? size : 1024) * 1024;
+        } else if (key == "queue-capacity") {
+            if (size == 0) {
+                error = "--queue-capacity: expected a capacity of at least 1, got '" + value + "'";
+                return false;
+            }
+            options.queue_choice = "spsc";
+            options.queue_capacity = size;
+        } else if (key == "batch-size") {
+            options.use_batches = true;
+            options.batch_size = size;
+        } else if (key == "workers") {
+            options.filter_workers = size;
+        } else if (key == "chunk-size") {
+            options.chunk_size = size;
+        } else if (key == "lines") {
+            options.use_rows = true;
+            options.row_config.lines = size;
+        } else if (key == "pixels") {
+            options.benchmark_pixels = static_cast<uint64_t>(number);
+        } else if (key == "ops-per-deadline") {
+            options.pacer_config.ops_per_deadline = size;
+        } else if (key == "sample-every") {
+            options.sample_every = static_cast<uint64_t>(number);
+        } else if (key == "stats-interval-ms") {
+            options.stats_interval_ms = number;
+        } else if (key == "synthetic-background") {
+            options.synthetic_config.background = static_cast<int>(number);
+        } else if (key == "synthetic-noise") {
+            options.synthetic_config.noise = static_cast<int>(number);
+        } else if (key == "synthetic-radius") {
+            options.synthetic_config.defect_radius = static_cast<int>(number);
+        } else if (key == "high-watermark") {
+            options.backpressure.high_watermark = size;
+        } else if (key == "low-watermark") {
+            options.backpressure.low_watermark = size;
+        } else if (key == "min-run") {
+            options.hysteresis.min_run = size;
+        } else if (key == "rt-priority") {
+            options.realtime.enabled = true;
+            options.realtime.fifo_priority = static_cast<int>(number);
+        } else if (key == "shm-slots") {
+            options.shm_slots = size;
+        } else if (key == "shm-wait-ms") {
+            options.shm_wait_ms = number;
+        } else if (key == "shadow-every") {
+            options.verify.sample_every = static_cast<uint64_t>(number);
+        } else if (key == "decimate") {
+            options.backpressure.policy = OverloadPolicy::Decimate;
+            options.backpressure.decimate_keep = size;
+        }
+        return true;
+    }
+
+    if (key == "tv" || key == "synthetic-defects" || key == "synthetic-contrast" || key == "verify-tolerance") {
+        if (!parse_number(value, real)) {
+            error = "--" + key + ": expected a number, got '" + value + "'";
+            return false;
+        }
+        if (key == "tv") {
+            options.tv = real;
+            options.tv_given = true;
+        } else if (key == "synthetic-defects") {
+            options.synthetic_config.defects_per_mpixel = real;
+        } else if (key == "verify-tolerance") {
+            options.verify.tolerance = real;
+        } else {
+            options.synthetic_config.contrast = static_cast<int>(real);
+        }
+        return true;
+    }
+
+    if (key == "source") {
+        if (value.empty()) {
+            error = "--source: expected random, synthetic (optionally :<seed>) or a filepath";
+            return false;
+        }
+        options.sources.push_back(value);
+    } else if (key == "lane-tv") {
+        // Comma-separated, lane 0 first.
+        options.lane_tvs.clear();
+        size_t start = 0;
+        while (start <= value.size()) {
+            size_t comma = value.find(',', start);
+            std::string cell = trim(value.substr(start, comma == std::string::npos ? std::string::npos : comma - start));
+            if (!parse_number(cell, real)) {
+                error = "--lane-tv: expected comma-separated numbers, got '" + value + "'";
+                return false;
+            }
+            options.lane_tvs.push_back(real);
+            if (comma == std::string::npos) {
+                break;
+            }
+            start = comma + 1;
+        }
+    } else if (key == "random-engine") {
+        ok = parse_choice(value, {{"mt19937", RandomEngine::Mt19937}, {"xoshiro", RandomEngine::Xoshiro256pp}},
+                          options.random_engine, message);
+    } else if (key == "synthetic-shape") {
+        ok = parse_choice(value, {{"round", DefectShape::Round}, {"streak", DefectShape::Streak},
+                                  {"scratch", DefectShape::Scratch}},
+                          options.synthetic_config.shape, message);
+    } else if (key == "placement") {
+        std::string placement;
+        ok = parse_choice(value, {{"none", std::string("none")}, {"cores", std::string("cores")},
+                                  {"numa", std::string("numa")}},
+                          placement, message);
+        options.placement = ok ? placement : options.placement;
+    } else if (key == "cpus") {
+        options.placement = "cores";
+        options.placement_cpus = parse_cpu_list(value);
+    } else if (key == "queue") {
+        ok = parse_choice(value, {{"blocking", std::string("blocking")}, {"spsc", std::string("spsc")}},
+                          options.queue_choice, message);
+    } else if (key == "full-policy") {
+        ok = parse_choice(value, {{"block", QueueFullPolicy::Block}, {"spin", QueueFullPolicy::SpinThenPark},
+                                  {"drop", QueueFullPolicy::DropOldest}},
+                          options.full_policy, message);
+    } else if (key == "overload") {
+        ok = parse_choice(value, {{"none", OverloadPolicy::None}, {"throttle", OverloadPolicy::Throttle},
+                                  {"drop", OverloadPolicy::DropLines}, {"decimate", OverloadPolicy::Decimate}},
+                          options.backpressure.policy, message);
+    } else if (key == "transport") {
+        ok = parse_choice(value, {{"pair", false}, {"batch", true}}, options.use_batches, message);
+    } else if (key == "engine") {
+        ok = parse_choice(value, {{"reference", FilterEngine::Reference}, {"simd", FilterEngine::Simd},
+                                  {"fixed", FilterEngine::Fixed}},
+                          options.engine, message);
+    } else if (key == "flat-field") {
+        options.flat_field_path = value;
+    } else if (key == "kernel") {
+        if (!value.empty()) {
+            ok = read_kernel_option(value, options.kernel, message);
+        } else {
+            options.kernel = default_kernel_spec();
+        }
+    } else if (key == "hysteresis") {
+        size_t min_run = options.hysteresis.min_run;
+        ok = parse_hysteresis_option(value, options.hysteresis, message);
+        if (ok && value.find(',') == std::string::npos) {
+            options.hysteresis.min_run = min_run; // --min-run given separately
+        }
+    } else if (key == "layout") {
+        ok = parse_choice(value, {{"stream", false}, {"rows", true}}, options.use_rows, message);
+    } else if (key == "edge") {
+        ok = parse_choice(value, {{"clamp", EdgeMode::Clamp}, {"mirror", EdgeMode::Mirror}, {"skip", EdgeMode::Skip}},
+                          options.row_config.edge, message);
+        options.use_rows = options.use_rows || ok;
+    } else if (key == "run") {
+        ok = parse_choice(value, {{"simulate", false}, {"benchmark", true}}, options.benchmark, message);
+    } else if (key == "pacing") {
+        ok = parse_choice(value, {{"sleep", PacingStrategy::Sleep}, {"hybrid", PacingStrategy::HybridSpin},
+                                  {"spin", PacingStrategy::BusySpin}, {"batched", PacingStrategy::Batched}},
+                          options.pacer_config.strategy, message);
+    } else if (key == "sink") {
+        ok = parse_choice(value, {{"text", std::string("text")}, {"sampled", std::string("sampled")},
+                                  {"bitmap", std::string("bitmap")}, {"rle", std::string("rle")},
+                                  {"events", std::string("events")}, {"regions", std::string("regions")},
+                                  {"null", std::string("null")}},
+                          options.sink_choice, message);
+    } else if (key == "output") {
+        options.output_path = value;
+    } else if (key == "record") {
+        options.record_path = value;
+    } else if (key == "shm-publish") {
+        options.shm_publish = value;
+    } else if (is_flag_key(key)) {
+        bool& flag = key == "record-lz4" ? options.record_compressed
+                   : key == "hugepages" ? options.hugepages
+                   : key == "alloc-check" ? options.alloc_check
+                   : key == "verify" ? options.verify.required : options.realtime.enabled;
+        if (!parse_flag(value, flag)) {
+            ok = false;
+            message = "expected yes or no";
+        }
+    } else {
+        error = "unknown option --" + key;
+        return false;
+    }
+    if (!ok) {
+        error = "--" + key + ": " + message + (value.empty() ? "" : " (got '" + value + "')");
+    }
+    return ok;
+}
+
+bool load_options_file(const std::string& path, RunOptions& options, std::string& error) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        error = "cannot open config file " + path;
+        return false;
+    }
+    std::string line;
+    int line_number = 0;
+    while (std::getline(file, line)) {
+        ++line_number;
+        std::string text = trim(line);
+        if (text.empty() || text[0] == '#') {
+            continue;
+        }
+        std::string where = path + ":" + std::to_string(line_number) + ": ";
+        size_t equals = text.find('=');
+        std::string key = trim(text.substr(0, equals));
+        std::string value = equals == std::string::npos ? "" : trim(text.substr(equals + 1));
+        if (equals == std::string::npos && !is_flag_key(key)) {
+            error = where + "expected key = value";
+            return false;
+        }
+        if (key == "config") {
+            error = where + "config files cannot include other config files";
+            return false;
+        }
+        if (!set_option(options, key, equals == std::string::npos ? "yes" : value, error)) {
+            error = where + error;
+            return false;
+        }
+    }
+    return true;
+}
+
+CommandLine parse_command_line(int argc, char** argv, RunOptions& options, std::string& error) {
+    if (argc <= 1) {
+        return CommandLine::Prompt;
+    }
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "-h" || arg == "--help") {
+            print_usage(std::cout, argv[0]);
+            return CommandLine::Help;
+        }
+        if (arg.compare(0, 2, "--") != 0) {
+            error = "unexpected argument '" + arg + "'";
+            return CommandLine::Error;
+        }
+        size_t equals = arg.find('=');
+        std::string key = arg.substr(2, equals == std::string::npos ? std::string::npos : equals - 2);
+        std::string value;
+        if (equals != std::string::npos) {
+            value = arg.substr(equals + 1);
+        } else if (is_flag_key(key)) {
+            value = "yes";
+        } else if (i + 1 < argc) {
+            value = argv[++i];
+        } else {
+            error = "--" + key + " needs a value";
+            return CommandLine::Error;
+        }
+        bool ok = key == "config" ? load_options_file(value, options, error)
+                                  : set_option(options, key, value, error);
+        if (!ok) {
+            return CommandLine::Error;
+        }
+    }
+    if (!options.tv_given) {
+        error = "--tv is required";
+        return CommandLine::Error;
+    }
+    if ((options.sink_choice == "bitmap" || options.sink_choice == "rle" || options.sink_choice == "events" ||
+         options.sink_choice == "regions") && options.output_path.empty()) {
+        error = "--sink " + options.sink_choice + " needs --output";
+        return CommandLine::Error;
+    }
+    return CommandLine::Run;
+}
+
+void print_usage(std::ostream& out, const char* program) {
+    out << "Usage: " << program << " [--config FILE] [--key VALUE | --key=VALUE ...]\n"
+        << "Without arguments the settings are asked for interactively.\n"
+        << "A config file holds \"key = value\" lines with the same keys; later flags override it.\n"
+        << "\n"
+        << "Input:\n"
+        << "  --m N                  Columns per line (0 = no row structure)\n"
+        << "  --tv X                 Threshold value (required)\n"
+        << "  --t-ns N               Process time T in ns (>= 500, default 500)\n"
+        << "  --source S             random[:seed], synthetic[:seed], shm:NAME (a --shm-publish ring)\n"
+        << "                         or a CSV / scan filepath; once per lane\n"
+        << "  --lanes N              Lane count (default: one per --source; extra lanes repeat the last)\n"
+        << "  --lane-tv X,Y,...      Per-lane thresholds (default: --tv)\n"
+        << "  --read-ahead N         Read-ahead chunks for file sources (0 = off)\n"
+        << "  --read-ahead-kib N     Read-ahead chunk size (default 1024)\n"
+        << "  --random-engine E      mt19937 or xoshiro\n"
+        << "  --synthetic-background N, --synthetic-noise N, --synthetic-defects X,\n"
+        << "  --synthetic-radius N, --synthetic-shape round|streak|scratch, --synthetic-contrast X\n"
+        << "\n"
+        << "Pipeline:\n"
+        << "  --placement P          none, cores or numa\n"
+        << "  --cpus LIST            CPUs, generator then filter per lane (implies cores)\n"
+        << "  --queue Q              blocking or spsc\n"
+        << "  --queue-capacity N     SPSC capacity (implies spsc; default 1024)\n"
+        << "  --full-policy P        block, spin or drop\n"
+        << "  --overload P           none, throttle, drop (whole lines) or decimate\n"
+        << "  --high-watermark N     Queued items that start the overload policy (0 = 3/4 of the queue)\n"
+        << "  --low-watermark N      Queued items that end it (0 = half the high watermark)\n"
+        << "  --decimate N           Keep one line in N while overloaded (implies decimate)\n"
+        << "  --transport T          pair or batch\n"
+        << "  --batch-size N         Pixels per batch (implies batch; 0 = one row of m)\n"
+        << "  --engine E             reference, simd or fixed (same decisions; simd values are float)\n"
+        << "  --workers N            Filter worker threads (0 = stage thread)\n"
+        << "  --chunk-size N         Pixels per worker chunk (0 = 4096)\n"
+        << "  --flat-field FILE      Flat-field calibration CSV; one that cannot be loaded fails\n"
+        << "                         the run (exit code 5)\n"
+        << "  --kernel K             Taps t0,t1,...[@center] or a kernel file\n"
+        << "  --hysteresis B[,N]     Defects last down to TV - B; optionally the minimum run N\n"
+        << "  --min-run N            Report defect runs shorter than N pixels as clean\n"
+        << "  --layout L             stream or rows\n"
+        << "  --edge E               clamp, mirror or skip (implies rows)\n"
+        << "  --lines K              Vertical kernel height, odd (implies rows)\n"
+        << "  --verify               Check every result of the engine against the reference filter;\n"
+        << "                         a mismatch fails the run (exit code 4)\n"
+        << "  --shadow-every N       Check one result in N (one line in N with rows) and report mismatches\n"
+        << "  --verify-tolerance X   Largest filtered-value difference that matches (default 0.001)\n"
+        << "  --shm-publish NAME     Write the batches to shared-memory ring NAME for another process\n"
+        << "                         (--source shm:NAME) to filter, instead of filtering them (implies batch)\n"
+        << "  --shm-slots N          Slots of the published ring (default 64)\n"
+        << "  --shm-wait-ms N        How long a shm:NAME source waits for its publisher (default 10000);\n"
+        << "                         a source that cannot be opened fails the run (exit code 5)\n"
+        << "\n"
+        << "Run:\n"
+        << "  --run R                simulate or benchmark\n"
+        << "  --pixels N             Benchmark pixel count (0 = whole file / 10000000)\n"
+        << "  --pacing P             sleep, hybrid, spin or batched\n"
+        << "  --ops-per-deadline N   Batched pacing: iterations per deadline\n"
+        << "  --sink S               text, sampled, bitmap, rle, events (defect runs with peak),\n"
+        << "                         regions (defect blobs, needs m) or null\n"
+        << "  --sample-every N       Sampled sink: print every Nth result\n"
+        << "  --output FILE          Bitmap / RLE / event / region output file\n"
+        << "  --record FILE          Record the input to a scan file\n"
+        << "  --record-lz4           Compress the recording (LZ4 builds)\n"
+        << "  --stats-interval-ms N  Periodic stats dump (instrumented builds)\n"
+        << "  --hugepages            Put the batch arena on hugepages (falls back to ordinary pages)\n"
+        << "  --alloc-check          Fail the run if a stage allocates after warm-up (ALLOC_CHECK=1 builds)\n"
+        << "  --realtime             Pin the stage threads (isolated cores unless --cpus), lock and prefault memory\n"
+        << "  --rt-priority N        Run the stage threads SCHED_FIFO at priority N, 1-99 (implies --realtime)\n";
+}
+
+void finish_options(RunOptions& options) {
+    if (options.t_ns < 500) {
+        std::cerr << "Warning: T is less than 500ns. Setting to 500ns." << std::endl;
+        options.t_ns = 500;
+    }
+
+    // Lanes: one per source, at least one; missing sources repeat the last.
+    if (options.sources.empty()) {
+        options.sources.push_back("random");
+    }
+    int lane_count = options.lane_count > 0 ? options.lane_count : static_cast<int>(options.sources.size());
+    options.lanes.clear();
+    for (int lane = 0; lane < lane_count; ++lane) {
+        LaneSource source;
+        size_t index = std::min(static_cast<size_t>(lane), options.sources.size() - 1);
+        if (!parse_generated_source(options.sources[index], source.synthetic, source.seed)) {
+            source.path = options.sources[index];
+        }
+        source.tv = static_cast<size_t>(lane) < options.lane_tvs.size() ? options.lane_tvs[lane] : options.tv;
+        options.lanes.push_back(source);
+    }
+    options.lane_count = lane_count;
+
+    if (options.queue_choice != "spsc") {
+        options.queue_capacity = 0;
+    } else if (options.queue_capacity == 0) {
+        options.queue_capacity = DEFAULT_QUEUE_CAPACITY;
+    }
+    if (options.backpressure.decimate_keep == 0) {
+        options.backpressure.decimate_keep = 2;
+    }
+    if (!options.shm_publish.empty()) {
+        options.use_batches = true; // The ring carries batches
+    }
+    for (const LaneSource& source : options.lanes) {
+        std::string ring;
+        if (!options.use_batches && parse_shm_source(source.path, ring)) {
+            // The filter finds lost slots in the batches' stream index.
+            std::cerr << "Warning: A shm: source needs batch transport (pairs carry no stream index), using batches." << std::endl;
+            options.use_batches = true;
+        }
+    }
+    if (!options.flat_field_path.empty() && !options.use_batches) {
+        std::cerr << "Warning: Flat-field correction needs batch transport, using batches." << std::endl;
+        options.use_batches = true;
+    }
+    bool sheds_lines = options.backpressure.policy == OverloadPolicy::DropLines ||
+                       options.backpressure.policy == OverloadPolicy::Decimate;
+    if (sheds_lines && !options.use_batches) {
+        // The filter restarts where the stream index skips the shed lines.
+        std::cerr << "Warning: Shedding lines needs batch transport (pairs carry no stream index), using batches." << std::endl;
+        options.use_batches = true;
+    }
+    if (options.use_batches && options.batch_size == 0) {
+        options.batch_size = options.m > 0 ? static_cast<size_t>(options.m) : DEFAULT_BATCH_SIZE;
+    }
+    if (sheds_lines && options.m > 0) {
+        size_t m = static_cast<size_t>(options.m);
+        if (options.batch_size % m != 0 && m % options.batch_size != 0) {
+            std::cerr << "Warning: Shedding whole lines needs a batch size that divides m or is a multiple of it, using "
+                      << m << "." << std::endl;
+            options.batch_size = m;
+        }
+    }
+    if (!options.use_batches) {
+        options.batch_size = 0;
+        options.filter_workers = 0;
+        options.chunk_size = 0;
+        options.flat_field_path.clear();
+    }
+    if (options.verify.required && options.verify.sample_every == 0) {
+        options.verify.sample_every = 1;
+    }
+    if (options.verify.enabled() && !options.use_batches) {
+        std::cerr << "Warning: Verification needs batch transport (pairs always use the reference filter), not verifying." << std::endl;
+        options.verify = VerifyConfig();
+    }
+    if (options.sink_choice == "regions" && options.m <= 0) {
+        std::cerr << "Warning: The region sink needs m > 0, writing defect runs instead." << std::endl;
+        options.sink_choice = "rle";
+    }
+    if (options.use_rows && options.m <= 0) {
+        std::cerr << "Warning: Row layout needs m > 0, using stream layout." << std::endl;
+        options.use_rows = false;
+    }
+    if (options.use_rows && options.row_config.lines % 2 == 0) {
+        std::cerr << "Warning: K must be odd, using " << options.row_config.lines + 1 << "." << std::endl;
+        ++options.row_config.lines;
+    }
+
+    bool any_generated = false;
+    for (const LaneSource& source : options.lanes) {
+        any_generated = any_generated || source.path.empty();
+    }
+    if (options.benchmark) {
+        // Generated data never ends on its own.
+        if (options.benchmark_pixels == 0 && any_generated) {
+            options.benchmark_pixels = DEFAULT_BENCHMARK_PIXELS;
+        }
+        options.pacer_config.strategy = PacingStrategy::None;
+    }
+    if (options.record_compressed && !scan_lz4_available()) {
+        std::cerr << "Warning: Built without LZ4, recording uncompressed." << std::endl;
+        options.record_compressed = false;
+    }
+    if (!STATS_ENABLED) {
+        options.stats_interval_ms = 0;
+    }
+    if (options.alloc_check && !ALLOC_CHECK_AVAILABLE) {
+        std::cerr << "Warning: Built without ALLOC_CHECK=1, the allocation check is off." << std::endl;
+        options.alloc_check = false;
+    }
+    if (options.realtime.enabled) {
+        // Every stage thread on a core of its own, the isolated ones by default.
+        if (options.placement == "numa") {
+            std::cerr << "Warning: Real-time mode pins each thread to one core, ignoring the NUMA placement." << std::endl;
+        }
+        options.placement = "cores";
+        if (options.placement_cpus.empty()) {
+            options.placement_cpus = isolated_cpus();
+            if (options.placement_cpus.empty()) {
+                std::cerr << "Warning: No isolated CPUs (isolcpus=), real-time threads share cores with the rest of the system." << std::endl;
+            }
+        }
+        int max_priority = max_fifo_priority();
+        if (options.realtime.fifo_priority > max_priority) {
+            std::cerr << "Warning: SCHED_FIFO priority above " << max_priority << ", using " << max_priority << "." << std::endl;
+            options.realtime.fifo_priority = max_priority;
+        }
+    }
+}
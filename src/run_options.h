@@ -0,0 +1,140 @@
+#ifndef RUN_OPTIONS_H
+#define RUN_OPTIONS_H
+
+#include "alloc_check.h"
+#include "realtime.h"
+#include "backpressure.h"
+#include "filter_kernel.h"
+#include "filter_threshold.h"
+#include "filter_verify.h"
+#include "pacer.h"
+#include "prefetch_reader.h"
+#include "random_source.h"
+#include "row_filter.h"
+#include "shm_ring.h"
+#include "spsc_ring_queue.h"
+#include "synthetic_source.h"
+#include <ostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// Batch size used when batch mode is selected without a row width.
+const size_t DEFAULT_BATCH_SIZE = 1024;
+// SPSC ring capacity when the spsc queue is selected without one.
+const size_t DEFAULT_QUEUE_CAPACITY = 1024;
+// Pixels processed by a random-mode benchmark when no count is given.
+const uint64_t DEFAULT_BENCHMARK_PIXELS = 10000000;
+
+// Where one lane's pixels come from, as resolved by finish_options().
+struct LaneSource {
+    std::string path;       // Empty = generated data
+    uint64_t seed = 0;      // Generated data only; 0 = seed from std::random_device
+    bool synthetic = false; // Generated data only: synthetic web instead of uniform noise
+    double tv = 0.0;
+};
+
+// Every setting of a run, whether it was collected by the interactive prompts
+// or given on the command line / in a config file. Values of 0 mean "default"
+// where the prompts say so; finish_options() replaces them.
+struct RunOptions {
+    int m = 0;
+    double tv = 0.0;
+    bool tv_given = false; // Set by set_option("tv"); the command line requires it
+    long long t_ns = 500;
+
+    // One entry per lane: "random" or "synthetic" (optionally ":<seed>"), or
+    // a CSV / scan filepath. lane_count > sources.size() repeats the last
+    // source; lane_tvs[i], if given, replaces tv for lane i.
+    std::vector<std::string> sources;
+    int lane_count = 0;
+    std::vector<double> lane_tvs;
+    std::vector<LaneSource> lanes; // Filled by finish_options()
+
+    PrefetchConfig prefetch;
+    RandomEngine random_engine = RandomEngine::Mt19937;
+    SyntheticConfig synthetic_config;
+
+    std::string placement = "none"; // "none", "cores" or "numa"
+    std::vector<int> placement_cpus;
+
+    std::string queue_choice = "blocking";
+    size_t queue_capacity = 0;  // 0 = DEFAULT_QUEUE_CAPACITY with spsc
+    QueueFullPolicy full_policy = QueueFullPolicy::SpinThenPark;
+    BackpressureConfig backpressure;
+
+    bool use_batches = false;
+    size_t batch_size = 0;      // 0 = one row of m (DEFAULT_BATCH_SIZE without m)
+    FilterEngine engine = FilterEngine::Reference;
+    size_t filter_workers = 0;
+    size_t chunk_size = 0;
+    std::string flat_field_path;
+    KernelSpec kernel = default_kernel_spec();
+    HysteresisConfig hysteresis;
+
+    bool use_rows = false;
+    RowFilterConfig row_config;
+
+    bool benchmark = false;
+    uint64_t benchmark_pixels = 0; // 0 = whole file (DEFAULT_BENCHMARK_PIXELS for generated data)
+    PacerConfig pacer_config;
+
+    std::string sink_choice = "text"; // text, sampled, bitmap, rle, events, regions or null
+    std::string output_path;
+    uint64_t sample_every = 1;
+
+    std::string record_path;
+    bool record_compressed = false;
+
+    long long stats_interval_ms = 0;
+
+    bool hugepages = false;   // Batch arena on hugepages
+    bool alloc_check = false; // Fail the run on steady-state allocations (ALLOC_CHECK builds)
+    RealtimeConfig realtime;  // Pinned, memory-locked stage threads, optionally SCHED_FIFO
+
+    VerifyConfig verify;      // Golden check of the filter engine against the reference
+    std::string shm_publish;  // Publish the batches to this shared-memory ring instead of filtering them
+    size_t shm_slots = 64;
+    long long shm_wait_ms = SHM_ATTACH_WAIT_MS; // "shm:<name>" sources: wait this long for the publisher
+};
+
+// Outcome of parse_command_line().
+enum class CommandLine {
+    Prompt, // No arguments: collect the settings interactively
+    Run,    // Settings complete, start without prompting
+    Help,   // --help was given; the usage has been printed
+    Error   // Bad argument; the message is in error
+};
+
+// Parse "random" or "synthetic", optionally with ":<seed>". Returns false for
+// anything else (a CSV filepath).
+bool parse_generated_source(const std::string& text, bool& synthetic, uint64_t& seed);
+
+// Load a kernel from a file when text names one, otherwise parse it as
+// inline taps (see parse_kernel_spec()).
+bool read_kernel_option(const std::string& text, KernelSpec& kernel, std::string& error);
+
+// Parse "<band>[,<min run>]" (see HysteresisConfig), e.g. "4" or "4,3".
+bool parse_hysteresis_option(const std::string& text, HysteresisConfig& hysteresis, std::string& error);
+
+// Set one option by its long name (without "--"), e.g. ("queue", "spsc").
+// Returns false with a message for an unknown key or an invalid value.
+bool set_option(RunOptions& options, const std::string& key, const std::string& value, std::string& error);
+
+// Apply a config file of "key = value" lines, with the same keys as the
+// command-line flags. Blank lines and lines starting with '#' are skipped;
+// "source" may be given once per lane.
+bool load_options_file(const std::string& path, RunOptions& options, std::string& error);
+
+// Parse --key=value / --key value flags (and --config <file>, applied where it
+// appears, so later flags override the file). "tv" must be given.
+CommandLine parse_command_line(int argc, char** argv, RunOptions& options, std::string& error);
+
+void print_usage(std::ostream& out, const char* program);
+
+// Fill in the defaults that depend on other settings (batch size from m,
+// benchmark pixel count, unpaced benchmarks, T >= 500ns, ...) and resolve the
+// per-lane sources. Prints a warning for each setting it had to change.
+void finish_options(RunOptions& options);
+
+#endif // RUN_OPTIONS_H
@@ -0,0 +1,382 @@
+#include "scan_file.h"
+#include <algorithm> // For std::min
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>    // For open
+#include <sys/mman.h> // For mmap, madvise
+#include <sys/stat.h> // For fstat
+#include <unistd.h>   // For close
+
+#if defined(HAVE_LZ4)
+#include <lz4.h>
+#endif
+
+namespace {
+
+const char MAGIC[4] = {'L', 'R', 'S', 'C'};
+
+template <typename T>
+void put_le(uint8_t* out, T v) {
+    for (size_t i = 0; i < sizeof(T); ++i) {
+        out[i] = static_cast<uint8_t>(static_cast<uint64_t>(v) >> (8 * i));
+    }
+}
+
+template <typename T>
+T get_le(const uint8_t* in) {
+    uint64_t v = 0;
+    for (size_t i = 0; i < sizeof(T); ++i) {
+        v |= static_cast<uint64_t>(in[i]) << (8 * i);
+    }
+    return static_cast<T>(v);
+}
+
+void decode_header(const uint8_t in[ScanHeader::SIZE], ScanHeader& header) {
+    header.version = get_le<uint32_t>(in + 4);
+    header.m = get_le<uint32_t>(in + 8);
+    header.flags = get_le<uint32_t>(in + 12);
+    header.rows = get_le<uint64_t>(in + 16);
+    header.pixels = get_le<uint64_t>(in + 24);
+    header.start_time_ns = get_le<int64_t>(in + 32);
+    header.end_time_ns = get_le<int64_t>(in + 40);
+    header.period_ns = get_le<int64_t>(in + 48);
+    header.item_pixels = get_le<uint32_t>(in + 56);
+    header.chunk_pixels = get_le<uint32_t>(in + 60);
+}
+
+void encode_header(const ScanHeader& header, uint8_t out[ScanHeader::SIZE]) {
+    std::memset(out, 0, ScanHeader::SIZE);
+    std::memcpy(out, MAGIC, 4);
+    put_le(out + 4, header.version);
+    put_le(out + 8, header.m);
+    put_le(out + 12, header.flags);
+    put_le(out + 16, header.rows);
+    put_le(out + 24, header.pixels);
+    put_le(out + 32, header.start_time_ns);
+    put_le(out + 40, header.end_time_ns);
+    put_le(out + 48, header.period_ns);
+    put_le(out + 56, header.item_pixels);
+    put_le(out + 60, header.chunk_pixels);
+}
+
+int64_t wall_clock_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+bool scan_lz4_available() {
+#if defined(HAVE_LZ4)
+    return true;
+#else
+    return false;
+#endif
+}
+
+ScanWriter::~ScanWriter() {
+    close();
+}
+
+bool ScanWriter::open(const std::string& path, int m, long long period_ns, size_t item_pixels, bool compress) {
+    if (compress && !scan_lz4_available()) {
+        std::cerr << "ScanWriter Error: LZ4 compression requested but not built in (make LZ4=1)." << std::endl;
+        return false;
+    }
+    path_ = path;
+    file_.open(path, std::ios::binary | std::ios::trunc);
+    if (!file_.is_open()) {
+        std::cerr << "ScanWriter Error: Could not open output file " << path << std::endl;
+        return false;
+    }
+    header_ = ScanHeader();
+    header_.m = m > 0 ? static_cast<uint32_t>(m) : 0;
+    header_.start_time_ns = wall_clock_ns();
+    header_.period_ns = period_ns;
+    header_.item_pixels = static_cast<uint32_t>(item_pixels);
+    if (compress) {
+        header_.flags |= ScanHeader::FLAG_LZ4;
+        // Whole rows per chunk, so a chunk never splits a row.
+        size_t chunk = CHUNK_PIXELS;
+        if (header_.m > 0 && header_.m < chunk) {
+            chunk -= chunk % header_.m;
+        }
+        header_.chunk_pixels = static_cast<uint32_t>(chunk);
+    }
+    chunk_.reserve(CHUNK_PIXELS);
+    uint8_t bytes[ScanHeader::SIZE];
+    encode_header(header_, bytes);
+    file_.write(reinterpret_cast<const char*>(bytes), ScanHeader::SIZE);
+    bytes_written_ = ScanHeader::SIZE;
+    return true;
+}
+
+void ScanWriter::write(const uint8_t* pixels, size_t count) {
+    if (!file_.is_open()) {
+        return;
+    }
+    header_.pixels += count;
+    const size_t limit = header_.compressed() ? header_.chunk_pixels : CHUNK_PIXELS;
+    while (count > 0) {
+        size_t taken = std::min(count, limit - chunk_.size());
+        chunk_.insert(chunk_.end(), pixels, pixels + taken);
+        pixels += taken;
+        count -= taken;
+        if (chunk_.size() == limit) {
+            flush_chunk();
+        }
+    }
+}
+
+void ScanWriter::flush_chunk() {
+    if (chunk_.empty()) {
+        return;
+    }
+#if defined(HAVE_LZ4)
+    if (header_.compressed()) {
+        int raw_size = static_cast<int>(chunk_.size());
+        compressed_.resize(static_cast<size_t>(LZ4_compressBound(raw_size)));
+        int packed = LZ4_compress_default(reinterpret_cast<const char*>(chunk_.data()), compressed_.data(),
+                                          raw_size, static_cast<int>(compressed_.size()));
+        uint8_t sizes[8];
+        put_le(sizes, static_cast<uint32_t>(raw_size));
+        put_le(sizes + 4, static_cast<uint32_t>(packed));
+        file_.write(reinterpret_cast<const char*>(sizes), sizeof(sizes));
+        file_.write(compressed_.data(), packed);
+        bytes_written_ += sizeof(sizes) + static_cast<uint64_t>(packed);
+        chunk_.clear();
+        return;
+    }
+#endif
+    file_.write(reinterpret_cast<const char*>(chunk_.data()), static_cast<std::streamsize>(chunk_.size()));
+    bytes_written_ += chunk_.size();
+    chunk_.clear();
+}
+
+void ScanWriter::close() {
+    if (!file_.is_open()) {
+        return;
+    }
+    flush_chunk();
+    header_.end_time_ns = wall_clock_ns();
+    header_.rows = header_.m > 0 ? header_.pixels / header_.m : 0;
+    uint8_t bytes[ScanHeader::SIZE];
+    encode_header(header_, bytes);
+    file_.seekp(0);
+    file_.write(reinterpret_cast<const char*>(bytes), ScanHeader::SIZE);
+    file_.close();
+}
+
+ScanReader::~ScanReader() {
+    close();
+}
+
+bool ScanReader::is_scan_file(const std::string& path) {
+    // Only regular files: peeking at a pipe would eat the start of its data.
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+        return false;
+    }
+    std::ifstream file(path, std::ios::binary);
+    char magic[4];
+    return file.read(magic, 4) && std::memcmp(magic, MAGIC, 4) == 0;
+}
+
+bool ScanReader::read_header(const std::string& path, ScanHeader& header) {
+    if (!is_scan_file(path)) {
+        return false;
+    }
+    std::ifstream file(path, std::ios::binary);
+    uint8_t bytes[ScanHeader::SIZE];
+    if (!file.read(reinterpret_cast<char*>(bytes), ScanHeader::SIZE) || std::memcmp(bytes, MAGIC, 4) != 0) {
+        return false;
+    }
+    decode_header(bytes, header);
+    return true;
+}
+
+bool ScanReader::open(const std::string& path) {
+    close();
+    size_t file_size = 0;
+    if (prefetch_config_.depth > 0) {
+        prefetch_ = std::make_unique<PrefetchReader>(prefetch_config_);
+        if (!prefetch_->open(path)) {
+            std::cerr << "ScanReader Error: Could not open " << path << std::endl;
+            prefetch_.reset();
+            return false;
+        }
+    } else {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            std::cerr << "ScanReader Error: Could not open " << path << std::endl;
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < ScanHeader::SIZE) {
+            std::cerr << "ScanReader Error: " << path << " is too short for a scan header." << std::endl;
+            ::close(fd);
+            return false;
+        }
+        // Private and writable: in-place stages write to copy-on-write pages,
+        // never to the file.
+        void* mapping = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        ::close(fd); // The mapping keeps the file referenced
+        if (mapping == MAP_FAILED) {
+            std::cerr << "ScanReader Error: Could not map " << path << std::endl;
+            return false;
+        }
+        mapped_ = static_cast<uint8_t*>(mapping);
+        mapped_size_ = static_cast<size_t>(st.st_size);
+        file_size = mapped_size_;
+        madvise(mapped_, mapped_size_, MADV_SEQUENTIAL);
+    }
+
+    offset_ = 0;
+    const uint8_t* bytes = take(ScanHeader::SIZE);
+    const char* problem = nullptr;
+    if (!bytes) {
+        problem = "too short for a scan header";
+    } else {
+        decode_header(bytes, header_);
+        if (std::memcmp(bytes, MAGIC, 4) != 0) {
+            problem = "not a scan file";
+        } else if (header_.version != 1) {
+            problem = "unsupported version";
+        } else if (header_.compressed() && !scan_lz4_available()) {
+            problem = "LZ4-compressed, but LZ4 support is not built in (make LZ4=1)";
+        } else if (mapped_ && !header_.compressed() && file_size - ScanHeader::SIZE < header_.pixels) {
+            problem = "truncated";
+        }
+    }
+    if (problem) {
+        std::cerr << "ScanReader Error: " << path << ": " << problem << "." << std::endl;
+        close();
+        return false;
+    }
+    pixels_read_ = 0;
+    chunk_.clear();
+    chunk_used_ = 0;
+    return true;
+}
+
+void ScanReader::close() {
+    prefetch_.reset(); // Stops the I/O thread
+    if (mapped_) {
+        munmap(mapped_, mapped_size_);
+        mapped_ = nullptr;
+        mapped_size_ = 0;
+    }
+}
+
+const uint8_t* ScanReader::take(size_t count) {
+    if (mapped_) {
+        if (count > mapped_size_ - offset_) {
+            return nullptr;
+        }
+        const uint8_t* bytes = mapped_ + offset_;
+        offset_ += count;
+        return bytes;
+    }
+    staging_.resize(count);
+    size_t got = 0;
+    while (got < count) {
+        size_t read = prefetch_->read(staging_.data() + got, count - got);
+        if (read == 0) {
+            return nullptr;
+        }
+        got += read;
+    }
+    return staging_.data();
+}
+
+bool ScanReader::load_chunk() {
+#if defined(HAVE_LZ4)
+    const uint8_t* sizes = take(8);
+    if (!sizes) {
+        return false;
+    }
+    uint32_t raw_size = get_le<uint32_t>(sizes);
+    uint32_t packed = get_le<uint32_t>(sizes + 4);
+    // Sizes come from the file: check them before anything is allocated.
+    uint64_t remaining = header_.pixels - pixels_read_;
+    if (raw_size == 0 || raw_size > header_.chunk_pixels || raw_size > remaining ||
+        packed > static_cast<uint32_t>(LZ4_compressBound(static_cast<int>(raw_size)))) {
+        std::cerr << "ScanReader Error: corrupt LZ4 chunk header (" << raw_size << " pixels in "
+                  << packed << " bytes, chunks hold " << header_.chunk_pixels << ")." << std::endl;
+        return false;
+    }
+    const uint8_t* payload = take(packed);
+    if (!payload) {
+        std::cerr << "ScanReader Error: truncated LZ4 chunk." << std::endl;
+        return false;
+    }
+    chunk_.resize(raw_size);
+    int unpacked = LZ4_decompress_safe(reinterpret_cast<const char*>(payload),
+                                       reinterpret_cast<char*>(chunk_.data()),
+                                       static_cast<int>(packed), static_cast<int>(raw_size));
+    if (unpacked != static_cast<int>(raw_size)) {
+        std::cerr << "ScanReader Error: corrupt LZ4 chunk." << std::endl;
+        return false;
+    }
+    chunk_used_ = 0;
+    return true;
+#else
+    return false;
+#endif
+}
+
+size_t ScanReader::next_span(uint8_t*& data, size_t max_count) {
+    if (!is_open()) {
+        return 0;
+    }
+    size_t count = static_cast<size_t>(std::min<uint64_t>(max_count, header_.pixels - pixels_read_));
+    if (count == 0) {
+        return 0;
+    }
+    if (header_.compressed()) {
+        if (chunk_used_ == chunk_.size() && !load_chunk()) {
+            return 0;
+        }
+        count = std::min(count, chunk_.size() - chunk_used_);
+        data = chunk_.data() + chunk_used_;
+        chunk_used_ += count;
+    } else if (mapped_) {
+        data = mapped_ + offset_;
+        offset_ += count;
+    } else {
+        chunk_.resize(count);
+        count = prefetch_->read(chunk_.data(), count);
+        data = chunk_.data();
+    }
+    pixels_read_ += count;
+    return count;
+}
+
+size_t ScanReader::read_pixels(uint8_t* out, size_t max_count) {
+    if (prefetch_ && !header_.compressed()) {
+        // Straight from the read-ahead chunks, without going through chunk_.
+        size_t count = static_cast<size_t>(std::min<uint64_t>(max_count, header_.pixels - pixels_read_));
+        size_t written = 0;
+        while (written < count) {
+            size_t got = prefetch_->read(out + written, count - written);
+            if (got == 0) {
+                break;
+            }
+            written += got;
+        }
+        pixels_read_ += written;
+        return written;
+    }
+    size_t written = 0;
+    while (written < max_count) {
+        uint8_t* span = nullptr;
+        size_t count = next_span(span, max_count - written);
+        if (count == 0) {
+            break;
+        }
+        std::memcpy(out + written, span, count);
+        written += count;
+    }
+    return written;
+}
@@ -0,0 +1,152 @@
+#ifndef SCAN_FILE_H
+#define SCAN_FILE_H
+
+#include "prefetch_reader.h"
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Binary scan recording ("LRSC").
+//
+// Little-endian 64-byte header, then the pixels row by row:
+//
+//   0  char[4] "LRSC"
+//   4  u32     version (1)
+//   8  u32     m, row width (0 = unstructured stream)
+//  12  u32     flags (bit 0: LZ4 chunks)
+//  16  u64     row count (complete rows; 0 when m = 0)
+//  24  u64     pixel count
+//  32  i64     recording start, ns since the Unix epoch
+//  40  i64     recording end, ns since the Unix epoch
+//  48  i64     T of the recording: ns between two items
+//  56  u32     pixels per item (2 for pairs, the batch size for batches)
+//  60  u32     pixels per LZ4 chunk (0 when uncompressed)
+//
+// Uncompressed, the pixels follow as raw bytes and can be memory-mapped and
+// used in place. With LZ4, they are stored as chunks of u32 raw size, u32
+// compressed size and the compressed bytes; LZ4 support is built with LZ4=1.
+struct ScanHeader {
+    uint32_t version = 1;
+    uint32_t m = 0;
+    uint32_t flags = 0;
+    uint64_t rows = 0;
+    uint64_t pixels = 0;
+    int64_t start_time_ns = 0;
+    int64_t end_time_ns = 0;
+    int64_t period_ns = 0;
+    uint32_t item_pixels = 0;
+    uint32_t chunk_pixels = 0;
+
+    static const uint32_t FLAG_LZ4 = 1;
+    static const size_t SIZE = 64;
+
+    bool compressed() const { return (flags & FLAG_LZ4) != 0; }
+};
+
+// Whether scan files can be written and read LZ4-compressed in this build.
+bool scan_lz4_available();
+
+// Records a pixel stream to a scan file. Not thread-safe: one writer thread.
+class ScanWriter {
+public:
+    ScanWriter() = default;
+    ~ScanWriter();
+
+    ScanWriter(const ScanWriter&) = delete;
+    ScanWriter& operator=(const ScanWriter&) = delete;
+
+    // Create path and write a placeholder header. compress needs LZ4 (see
+    // scan_lz4_available()). Returns false, with a message, on failure.
+    bool open(const std::string& path, int m, long long period_ns, size_t item_pixels, bool compress);
+    bool is_open() const { return file_.is_open(); }
+
+    void write(const uint8_t* pixels, size_t count);
+
+    // Flush, then rewrite the header with the counts and the end time.
+    void close();
+
+    const ScanHeader& header() const { return header_; }
+    const std::string& path() const { return path_; }
+    uint64_t bytes_written() const { return bytes_written_; }
+
+private:
+    void flush_chunk();
+
+    static const size_t CHUNK_PIXELS = 64 * 1024;
+
+    std::string path_;
+    std::ofstream file_;
+    ScanHeader header_;
+    std::vector<uint8_t> chunk_;      // Pending pixels (a whole LZ4 chunk, or a write buffer)
+    std::vector<char> compressed_;
+    uint64_t bytes_written_ = 0;
+};
+
+// Reads a scan file through a copy-on-write private mapping.
+//
+// Uncompressed files are served in place: next_span() returns pointers into
+// the mapping, so replaying costs no copy. The mapping is copy-on-write, so a
+// stage that corrects pixels in place only copies the pages it touches, and
+// the file is never modified. LZ4 files are decompressed one chunk at a time.
+//
+// With set_prefetch() the file is not mapped: a PrefetchReader reads it ahead
+// on an I/O thread and the pixels are copied out of its chunks instead, so a
+// page-cache miss stalls the I/O thread rather than the reader.
+class ScanReader {
+public:
+    ScanReader() = default;
+    ~ScanReader();
+
+    ScanReader(const ScanReader&) = delete;
+    ScanReader& operator=(const ScanReader&) = delete;
+
+    // True if path starts with the scan file magic.
+    static bool is_scan_file(const std::string& path);
+
+    // Read just the header of path; false if it is not a scan file.
+    static bool read_header(const std::string& path, ScanHeader& header);
+
+    // Read ahead on an I/O thread instead of mapping (depth 0 = off). Applies
+    // to the next open().
+    void set_prefetch(const PrefetchConfig& config) { prefetch_config_ = config; }
+    const PrefetchReader* prefetch() const { return prefetch_.get(); }
+
+    bool open(const std::string& path);
+    void close();
+    bool is_open() const { return mapped_ != nullptr || prefetch_ != nullptr; }
+
+    const ScanHeader& header() const { return header_; }
+
+    // Point data at up to max_count next pixels and return how many (0 at the
+    // end). The span stays valid until close() when zero_copy(), otherwise
+    // until the next call.
+    size_t next_span(uint8_t*& data, size_t max_count);
+
+    // Copy up to max_count next pixels to out.
+    size_t read_pixels(uint8_t* out, size_t max_count);
+
+    // True when next_span() returns pointers into the file mapping.
+    bool zero_copy() const { return mapped_ != nullptr && !header_.compressed(); }
+
+    uint64_t pixels_read() const { return pixels_read_; }
+
+private:
+    bool load_chunk();
+    const uint8_t* take(size_t count);
+
+    uint8_t* mapped_ = nullptr;
+    size_t mapped_size_ = 0;
+    ScanHeader header_;
+    size_t offset_ = 0;             // Next unread byte of the mapping
+    uint64_t pixels_read_ = 0;
+    std::vector<uint8_t> chunk_;    // Decompressed LZ4 chunk, or pixels copied from prefetch_
+    size_t chunk_used_ = 0;
+    PrefetchConfig prefetch_config_;
+    std::unique_ptr<PrefetchReader> prefetch_;
+    std::vector<uint8_t> staging_;  // Bytes taken from prefetch_ (headers, LZ4 payloads)
+};
+
+#endif // SCAN_FILE_H
@@ -0,0 +1,414 @@
+#include "shm_ring.h"
+#include "cpu_relax.h"
+#include <cerrno>
+#include <chrono>
+#include <climits>   // For INT_MAX
+#include <cstring>   // For std::memcpy, std::strerror
+#include <ctime>     // For timespec
+#include <fcntl.h>
+#include <iostream>  // For std::cerr
+#include <linux/futex.h>
+#include <new>       // For placement new
+#include <signal.h>  // For kill
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+
+const char SHM_MAGIC[4] = {'L', 'R', 'S', 'H'};
+const uint32_t SHM_VERSION = 1;
+const size_t HEADER_BYTES = 4096;
+const size_t SLOT_HEADER_BYTES = 64;
+const size_t SPIN_LIMIT = 4096;
+const long PARK_TIMEOUT_NS = 100 * 1000 * 1000; // Recheck a parked side (and the producer) every 100 ms
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free,
+              "the shared ring needs address-free atomics");
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "futex words are 32 bits");
+
+// Shared (cross-process) futex wait and wake on a word of the segment.
+void futex_wait(std::atomic<uint32_t>& word, uint32_t expected) {
+    timespec timeout;
+    timeout.tv_sec = 0;
+    timeout.tv_nsec = PARK_TIMEOUT_NS;
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT, expected, &timeout, nullptr, 0);
+}
+
+void futex_wake(std::atomic<uint32_t>& word) {
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+
+// Bump the signal word and wake whoever parked on it, if anyone did.
+void signal_parked(std::atomic<uint32_t>& parked, std::atomic<uint32_t>& signal) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (parked.load(std::memory_order_relaxed) != 0) {
+        signal.fetch_add(1, std::memory_order_release);
+        futex_wake(signal);
+    }
+}
+
+std::string segment_name(const std::string& name) {
+    return name.empty() || name[0] == '/' ? name : "/" + name;
+}
+
+} // namespace
+
+struct ShmRing::Header {
+    char magic[4];
+    uint32_t version;
+    uint32_t slot_count;
+    uint32_t slot_capacity;
+    uint64_t slot_stride;
+    int32_t m;
+    int32_t producer_pid;
+    int64_t t_ns;
+
+    alignas(64) std::atomic<uint64_t> head; // Slots published (producer)
+    std::atomic<uint32_t> closed;
+    std::atomic<uint32_t> data_signal;      // Futex: bumped to wake a parked consumer
+    std::atomic<uint32_t> consumer_parked;
+    uint64_t end_sequence; // Set by close(): sequence and stream index after the last batch
+    uint64_t end_index;
+
+    alignas(64) std::atomic<uint64_t> tail; // Slots freed (consumer)
+    std::atomic<uint64_t> expected_sequence; // Next sequence number the consumer expects
+    std::atomic<uint64_t> expected_index;    // Stream index that sequence starts at
+    std::atomic<uint32_t> space_signal;      // Futex: bumped to wake a parked producer
+    std::atomic<uint32_t> producer_parked;
+};
+
+struct ShmRing::SlotHeader {
+    uint64_t sequence;
+    uint64_t first_index;
+    uint64_t size;
+};
+
+ShmRing::ShmRing()
+    : header_(nullptr),
+      base_(nullptr),
+      bytes_(0),
+      owner_(false),
+      slot_count_(0),
+      slot_capacity_(0),
+      slot_stride_(0),
+      interrupted_(false),
+      head_(0),
+      cached_tail_(0),
+      next_sequence_(0),
+      next_index_(0),
+      batches_written_(0),
+      batches_dropped_(0),
+      tail_(0),
+      cached_head_(0),
+      slot_offset_(0),
+      expected_sequence_(0),
+      expected_index_(0),
+      batches_read_(0),
+      lost_batches_(0),
+      lost_pixels_(0),
+      ended_(false) {}
+
+ShmRing::~ShmRing() {
+    if (base_) {
+        munmap(base_, bytes_);
+    }
+    if (owner_) {
+        shm_unlink(segment_name(name_).c_str());
+    }
+}
+
+bool ShmRing::map_segment(int fd, size_t bytes) {
+    void* block = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (block == MAP_FAILED) {
+        std::cerr << "ShmRing Error: Could not map " << name_ << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    base_ = static_cast<uint8_t*>(block);
+    bytes_ = bytes;
+    header_ = reinterpret_cast<Header*>(base_);
+    return true;
+}
+
+bool ShmRing::create(const std::string& name, size_t slot_count, size_t slot_capacity, int m, long long t_ns) {
+    static_assert(sizeof(Header) <= HEADER_BYTES, "the ring header fits its page");
+    static_assert(sizeof(SlotHeader) <= SLOT_HEADER_BYTES, "the slot header fits its cache line");
+    name_ = name;
+    slot_count_ = 2;
+    while (slot_count_ < slot_count) {
+        slot_count_ <<= 1;
+    }
+    slot_capacity_ = slot_capacity;
+    slot_stride_ = (SLOT_HEADER_BYTES + slot_capacity + 63) / 64 * 64;
+    const std::string path = segment_name(name);
+    shm_unlink(path.c_str()); // A segment left behind by a producer that did not exit cleanly
+    int fd = shm_open(path.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+        std::cerr << "ShmRing Error: Could not create " << path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    size_t bytes = HEADER_BYTES + slot_count_ * slot_stride_;
+    if (ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+        std::cerr << "ShmRing Error: Could not size " << path << ": " << std::strerror(errno) << std::endl;
+        ::close(fd);
+        shm_unlink(path.c_str());
+        return false;
+    }
+    if (!map_segment(fd, bytes)) {
+        shm_unlink(path.c_str());
+        return false;
+    }
+    owner_ = true;
+    // The pages are fresh zeros, so every counter starts at 0. The magic is
+    // written last: a consumer only trusts a segment once it is there.
+    Header* header = new (base_) Header();
+    header->version = SHM_VERSION;
+    header->slot_count = static_cast<uint32_t>(slot_count_);
+    header->slot_capacity = static_cast<uint32_t>(slot_capacity_);
+    header->slot_stride = slot_stride_;
+    header->m = m;
+    header->producer_pid = static_cast<int32_t>(getpid());
+    header->t_ns = t_ns;
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(header->magic, SHM_MAGIC, sizeof(SHM_MAGIC));
+    return true;
+}
+
+bool ShmRing::attach(const std::string& name, long long wait_ms) {
+    name_ = name;
+    const std::string path = segment_name(name);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(wait_ms);
+    bool announced = false;
+    for (;;) {
+        int fd = shm_open(path.c_str(), O_RDWR, 0);
+        struct stat info;
+        if (fd >= 0 && fstat(fd, &info) == 0 && static_cast<size_t>(info.st_size) >= HEADER_BYTES) {
+            if (!map_segment(fd, static_cast<size_t>(info.st_size))) {
+                return false;
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (std::memcmp(header_->magic, SHM_MAGIC, sizeof(SHM_MAGIC)) == 0) {
+                break;
+            }
+            munmap(base_, bytes_); // Still being set up
+            base_ = nullptr;
+            header_ = nullptr;
+        } else if (fd >= 0) {
+            ::close(fd);
+        }
+        if (std::chrono::steady_clock::now() >= deadline) {
+            std::cerr << "ShmRing Error: No shared-memory ring " << path << " (is the publisher running?)" << std::endl;
+            return false;
+        }
+        if (!announced) {
+            std::cerr << "ShmRing: Waiting for the publisher of " << path << "..." << std::endl;
+            announced = true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    if (header_->version != SHM_VERSION ||
+        HEADER_BYTES + static_cast<size_t>(header_->slot_count) * header_->slot_stride > bytes_) {
+        std::cerr << "ShmRing Error: " << path << " has an unknown layout (version " << header_->version << ")." << std::endl;
+        munmap(base_, bytes_);
+        base_ = nullptr;
+        header_ = nullptr;
+        return false;
+    }
+    slot_count_ = header_->slot_count;
+    slot_capacity_ = header_->slot_capacity;
+    slot_stride_ = header_->slot_stride;
+    // Carry on where the previous consumer, if any, stopped.
+    tail_ = header_->tail.load(std::memory_order_acquire);
+    cached_head_ = tail_;
+    expected_sequence_ = header_->expected_sequence.load(std::memory_order_relaxed);
+    expected_index_ = header_->expected_index.load(std::memory_order_relaxed);
+    return true;
+}
+
+ShmRing::SlotHeader* ShmRing::slot(uint64_t position) const {
+    return reinterpret_cast<SlotHeader*>(base_ + HEADER_BYTES + (position & (slot_count_ - 1)) * slot_stride_);
+}
+
+uint8_t* ShmRing::slot_pixels(uint64_t position) const {
+    return reinterpret_cast<uint8_t*>(slot(position)) + SLOT_HEADER_BYTES;
+}
+
+int ShmRing::m() const {
+    return header_ ? header_->m : 0;
+}
+
+long long ShmRing::t_ns() const {
+    return header_ ? header_->t_ns : 0;
+}
+
+int ShmRing::producer_pid() const {
+    return header_ ? header_->producer_pid : 0;
+}
+
+size_t ShmRing::depth() const {
+    if (!header_) {
+        return 0;
+    }
+    if (owner_) {
+        return static_cast<size_t>(head_ - header_->tail.load(std::memory_order_acquire));
+    }
+    return static_cast<size_t>(header_->head.load(std::memory_order_acquire) - tail_);
+}
+
+bool ShmRing::producer_alive() const {
+    return kill(header_->producer_pid, 0) == 0 || errno != ESRCH;
+}
+
+bool ShmRing::wait_for_space(uint64_t head) {
+    for (size_t spins = 0; spins < SPIN_LIMIT; ++spins) {
+        cached_tail_ = header_->tail.load(std::memory_order_acquire);
+        if (head - cached_tail_ < slot_count_) {
+            return true;
+        }
+        cpu_relax();
+    }
+    while (!interrupted_.load(std::memory_order_relaxed)) {
+        header_->producer_parked.store(1, std::memory_order_relaxed);
+        uint32_t signal = header_->space_signal.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        cached_tail_ = header_->tail.load(std::memory_order_acquire);
+        if (head - cached_tail_ < slot_count_) {
+            header_->producer_parked.store(0, std::memory_order_relaxed);
+            return true;
+        }
+        futex_wait(header_->space_signal, signal);
+    }
+    header_->producer_parked.store(0, std::memory_order_relaxed);
+    return false;
+}
+
+bool ShmRing::write(const uint8_t* pixels, size_t count, uint64_t first_index, bool wait) {
+    uint64_t sequence = next_sequence_++;
+    next_index_ = first_index + count;
+    if (head_ - cached_tail_ >= slot_count_) {
+        cached_tail_ = header_->tail.load(std::memory_order_acquire);
+        if (head_ - cached_tail_ >= slot_count_ && (!wait || !wait_for_space(head_))) {
+            ++batches_dropped_;
+            return false;
+        }
+    }
+    SlotHeader* target = slot(head_);
+    target->sequence = sequence;
+    target->first_index = first_index;
+    target->size = count < slot_capacity_ ? count : slot_capacity_;
+    std::memcpy(slot_pixels(head_), pixels, target->size);
+    ++head_;
+    header_->head.store(head_, std::memory_order_release);
+    ++batches_written_;
+    signal_parked(header_->consumer_parked, header_->data_signal);
+    return true;
+}
+
+void ShmRing::close() {
+    if (!header_) {
+        return;
+    }
+    header_->end_sequence = next_sequence_;
+    header_->end_index = next_index_;
+    header_->closed.store(1, std::memory_order_release);
+    header_->data_signal.fetch_add(1, std::memory_order_release);
+    futex_wake(header_->data_signal);
+}
+
+void ShmRing::interrupt() {
+    interrupted_.store(true, std::memory_order_relaxed);
+    if (header_) {
+        std::atomic<uint32_t>& signal = owner_ ? header_->space_signal : header_->data_signal;
+        signal.fetch_add(1, std::memory_order_release);
+        futex_wake(signal);
+    }
+}
+
+bool ShmRing::wait_for_data(uint64_t tail) {
+    for (size_t spins = 0; spins < SPIN_LIMIT; ++spins) {
+        cached_head_ = header_->head.load(std::memory_order_acquire);
+        if (cached_head_ != tail) {
+            return true;
+        }
+        if (header_->closed.load(std::memory_order_acquire)) {
+            break;
+        }
+        cpu_relax();
+    }
+    while (!interrupted_.load(std::memory_order_relaxed)) {
+        header_->consumer_parked.store(1, std::memory_order_relaxed);
+        uint32_t signal = header_->data_signal.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        // closed is published after the last slot, so once it is seen one
+        // more look at head finds everything.
+        bool closed = header_->closed.load(std::memory_order_acquire) != 0;
+        cached_head_ = header_->head.load(std::memory_order_acquire);
+        if (cached_head_ != tail || closed) {
+            header_->consumer_parked.store(0, std::memory_order_relaxed);
+            return cached_head_ != tail;
+        }
+        futex_wait(header_->data_signal, signal);
+        if (header_->head.load(std::memory_order_acquire) == tail && !producer_alive()) {
+            std::cerr << "ShmRing: Publisher process " << header_->producer_pid << " of " << name_
+                      << " is gone." << std::endl;
+            break;
+        }
+    }
+    header_->consumer_parked.store(0, std::memory_order_relaxed);
+    return false;
+}
+
+size_t ShmRing::read_pixels(uint8_t* out, size_t max_count) {
+    size_t copied = 0;
+    while (copied < max_count && !ended_) {
+        if (tail_ == cached_head_ && !wait_for_data(tail_)) {
+            ended_ = true;
+            if (header_->closed.load(std::memory_order_acquire) && header_->end_sequence > expected_sequence_) {
+                // Dropped after the last slot that made it
+                lost_batches_ += header_->end_sequence - expected_sequence_;
+                lost_pixels_ += header_->end_index - expected_index_;
+            }
+            break;
+        }
+        const SlotHeader* source = slot(tail_);
+        if (slot_offset_ == 0) {
+            // A new slot: anything between it and the last one was dropped.
+            if (source->sequence != expected_sequence_) {
+                if (copied > 0) {
+                    break; // Return what precedes the gap; the next read starts after it
+                }
+                lost_batches_ += source->sequence - expected_sequence_;
+                lost_pixels_ += source->first_index - expected_index_;
+            }
+            expected_sequence_ = source->sequence + 1;
+            expected_index_ = source->first_index + source->size;
+        }
+        size_t available = static_cast<size_t>(source->size) - slot_offset_;
+        size_t taken = available < max_count - copied ? available : max_count - copied;
+        std::memcpy(out + copied, slot_pixels(tail_) + slot_offset_, taken);
+        copied += taken;
+        slot_offset_ += taken;
+        if (slot_offset_ == source->size) {
+            // Hand the slot back before the next wait.
+            slot_offset_ = 0;
+            ++tail_;
+            ++batches_read_;
+            header_->expected_sequence.store(expected_sequence_, std::memory_order_relaxed);
+            header_->expected_index.store(expected_index_, std::memory_order_relaxed);
+            header_->tail.store(tail_, std::memory_order_release);
+            signal_parked(header_->producer_parked, header_->space_signal);
+        }
+    }
+    return copied;
+}
+
+bool parse_shm_source(const std::string& source, std::string& name) {
+    if (source.compare(0, 4, "shm:") != 0 || source.size() == 4) {
+        return false;
+    }
+    name = source.substr(4);
+    return true;
+}
@@ -0,0 +1,170 @@
+#ifndef SHM_RING_H
+#define SHM_RING_H
+
+#include "pipeline_queue.h"
+#include "pixel_batch.h"
+#include "spsc_ring_queue.h" // For QueueFullPolicy
+#include <atomic>
+#include <cstddef> // For size_t
+#include <cstdint>
+#include <string>
+
+// Batch transport between two processes: a lock-free single-producer /
+// single-consumer ring of fixed-size pixel slots in a POSIX shared-memory
+// segment (/dev/shm/<name>), so acquisition and analysis can run (and be
+// restarted) separately.
+//
+// Segment layout: a one-page header, then slot_count slots of slot_stride
+// bytes. A slot is a 64-byte slot header (sequence, first_index, size) then up to
+// slot_capacity pixels. head (slots published) and tail (slots freed) are
+// 64-bit counters on their own cache lines. As in SpscRingQueue, each side
+// keeps a cached copy of the other's counter, so the fast path is a copy and
+// one release store; nothing locks. A side only makes a system call when the
+// other side has parked on a futex word in the segment (shared, not private,
+// futexes work across processes).
+//
+// Every batch the producer is given takes the next sequence number, written
+// or not. When the ring is full under the drop policy, the producer discards
+// the new batch, so the consumer finds the loss as a sequence gap (or, after
+// the last batch written, against the end close() records). The consumer
+// records the next sequence it expects in the header, so a restarted
+// consumer also counts what was dropped while none was attached.
+class ShmRing {
+public:
+    ShmRing();
+    ~ShmRing();
+
+    ShmRing(const ShmRing&) = delete;
+    ShmRing& operator=(const ShmRing&) = delete;
+
+    // Producer: create the segment, replacing a stale one of the same name.
+    // The name is removed again when the producer's ring is destroyed; a
+    // consumer that is attached keeps its mapping. Returns false, with a
+    // message, on failure.
+    bool create(const std::string& name, size_t slot_count, size_t slot_capacity, int m, long long t_ns);
+
+    // Consumer: map an existing segment, waiting up to wait_ms for the
+    // producer to create it.
+    bool attach(const std::string& name, long long wait_ms);
+
+    bool is_open() const { return header_ != nullptr; }
+
+    // Producer: copy count (<= slot_capacity) pixels, the first at stream
+    // index first_index, into the next slot. While the ring is full, wait
+    // spins and then parks until the consumer frees a slot; otherwise the
+    // batch is dropped. Returns false if it was dropped.
+    bool write(const uint8_t* pixels, size_t count, uint64_t first_index, bool wait);
+
+    // Producer: end of stream. The consumer drains the ring, then reads 0.
+    void close();
+
+    // Consumer: copy up to max_count pixels out of the ring, blocking until
+    // that many have arrived. Freed slots are handed back at once. Returns
+    // less at the end (the producer closed the ring or exited, or interrupt()
+    // was called) and before a gap, so the pixels of one read are contiguous
+    // in the stream; lost_pixels() then counts the gap on the next read.
+    size_t read_pixels(uint8_t* out, size_t max_count);
+
+    // Either side, any thread: wake a read_pixels() or a waiting write()
+    // and make it return.
+    void interrupt();
+
+    // Slots holding data, as seen from this process.
+    size_t depth() const;
+
+    const std::string& name() const { return name_; }
+    size_t slot_count() const { return slot_count_; }
+    size_t slot_capacity() const { return slot_capacity_; }
+    int m() const;
+    long long t_ns() const;
+    int producer_pid() const;
+
+    uint64_t batches_written() const { return batches_written_; } // Producer
+    uint64_t batches_dropped() const { return batches_dropped_; } // Producer, ring full
+    uint64_t batches_read() const { return batches_read_; }       // Consumer
+    uint64_t lost_batches() const { return lost_batches_; }       // Consumer, sequence gaps
+    uint64_t lost_pixels() const { return lost_pixels_; }
+
+private:
+    struct Header;
+    struct SlotHeader;
+
+    bool map_segment(int fd, size_t bytes);
+    SlotHeader* slot(uint64_t position) const;
+    uint8_t* slot_pixels(uint64_t position) const;
+    bool wait_for_space(uint64_t head);
+    bool wait_for_data(uint64_t tail);
+    bool producer_alive() const;
+
+    Header* header_;
+    uint8_t* base_;
+    size_t bytes_;
+    std::string name_;
+    bool owner_;            // Created the segment (producer)
+    size_t slot_count_;
+    size_t slot_capacity_;
+    size_t slot_stride_;
+    std::atomic<bool> interrupted_;
+
+    // Producer state
+    uint64_t head_;          // Next slot to publish
+    uint64_t cached_tail_;
+    uint64_t next_sequence_;
+    uint64_t next_index_;    // Stream index after the last batch given to write()
+    uint64_t batches_written_;
+    uint64_t batches_dropped_;
+
+    // Consumer state
+    uint64_t tail_;          // Slot being read
+    uint64_t cached_head_;
+    size_t slot_offset_;     // Pixels of the current slot already copied out
+    uint64_t expected_sequence_;
+    uint64_t expected_index_;
+    uint64_t batches_read_;
+    uint64_t lost_batches_;
+    uint64_t lost_pixels_;
+    bool ended_;
+};
+
+// "shm:<name>" as a source names a ring to read from. Returns false for
+// anything else.
+bool parse_shm_source(const std::string& source, std::string& name);
+
+// How long a consumer waits for the publisher to create its ring.
+const long long SHM_ATTACH_WAIT_MS = 10000;
+
+// Producer end of a ShmRing, as the generator's queue. push() copies the
+// batch into the ring and hands it straight back to the pool, so the
+// generator needs only a couple of batches. Block and spin wait for a free
+// slot; drop discards the new batch (the consumer sees the gap). There is no
+// consumer in this process, so the pops always report the queue closed.
+class ShmBatchQueue : public PipelineQueue<PixelBatch*> {
+public:
+    ShmBatchQueue(ShmRing& ring, BatchPool& pool, QueueFullPolicy policy)
+        : ring_(ring), pool_(pool), policy_(policy), closed_(false) {}
+
+    void push(PixelBatch* batch) override {
+        ring_.write(batch->data, batch->size, batch->first_index, policy_ != QueueFullPolicy::DropOldest);
+        pool_.release(batch);
+    }
+    PixelBatch* pop() override { return nullptr; }
+    bool pop(PixelBatch*&) override { return false; }
+    bool try_pop(PixelBatch*&) override { return false; }
+    bool empty() const override { return ring_.depth() == 0; }
+    size_t size() const override { return ring_.depth(); }
+    void close() override {
+        closed_ = true;
+        ring_.close();
+    }
+    bool closed() const override { return closed_; }
+
+    QueueFullPolicy policy() const { return policy_; }
+
+private:
+    ShmRing& ring_;
+    BatchPool& pool_;
+    QueueFullPolicy policy_;
+    bool closed_;
+};
+
+#endif // SHM_RING_H
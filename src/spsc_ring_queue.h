@@ -0,0 +1,275 @@
+#ifndef SPSC_RING_QUEUE_H
+#define SPSC_RING_QUEUE_H
+
+#include "pipeline_queue.h"
+#include "cpu_relax.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+// What SpscRingQueue::push does when the ring is full.
+enum class QueueFullPolicy {
+    Block,        // Park the producer until the consumer frees a slot.
+    SpinThenPark, // Spin for a bounded number of iterations, then park.
+    DropOldest    // Discard the oldest queued item and count it in dropped_count().
+};
+
+// Bounded, lock-free single-producer/single-consumer ring queue.
+//
+// Drop-in alternative to BlockingQueue for the DataGenerator -> FilterThreshold
+// link: exactly one thread may push and exactly one thread may pop.
+// Storage is allocated once in the constructor (capacity is rounded up to a
+// power of two) and the producer and consumer indices live on separate cache
+// lines, each side keeping a cached copy of the other's index so the shared
+// lines are only touched when the cached view says the ring is full/empty.
+//
+// The mutex and condition variables are only used to park a thread that has
+// nothing to do; the fast path never takes a lock.
+template <typename T>
+class SpscRingQueue : public PipelineQueue<T> {
+public:
+    explicit SpscRingQueue(size_t capacity,
+                           QueueFullPolicy policy = QueueFullPolicy::SpinThenPark,
+                           size_t spin_limit = 4096)
+        : capacity_(round_up_pow2(capacity < 2 ? 2 : capacity)),
+          mask_(capacity_ - 1),
+          policy_(policy),
+          spin_limit_(spin_limit),
+          slots_(new T[capacity_]) {}
+
+    SpscRingQueue(const SpscRingQueue&) = delete;
+    SpscRingQueue& operator=(const SpscRingQueue&) = delete;
+
+    // Push an item to the queue (producer thread only).
+    // When full, behaves according to the QueueFullPolicy given at construction.
+    void push(T item) override {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - cached_released_ >= capacity_) {
+            cached_released_ = released_.load(std::memory_order_acquire);
+            if (tail - cached_released_ >= capacity_) {
+                wait_for_space(tail);
+            }
+        }
+        slots_[tail & mask_] = std::move(item);
+        tail_.store(tail + 1, std::memory_order_release);
+        wake(consumer_waiting_, not_empty_);
+    }
+
+    // Pop an item from the queue (consumer thread only). Blocks if the queue is empty.
+    T pop() override {
+        T item;
+        for (size_t spins = 0; spins < spin_limit_; ++spins) {
+            if (try_pop(item)) {
+                return item;
+            }
+            cpu_relax();
+        }
+        while (!try_pop(item)) {
+            std::unique_lock<std::mutex> lock(park_mutex_);
+            consumer_waiting_.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            not_empty_.wait(lock, [this] { return !empty(); });
+            consumer_waiting_.store(false, std::memory_order_relaxed);
+        }
+        return item;
+    }
+
+    // Pop an item (consumer thread only), spinning briefly and then parking
+    // while the ring is empty. Returns false once the ring is closed and drained.
+    bool pop(T& item) override {
+        for (size_t spins = 0; spins < spin_limit_; ++spins) {
+            if (try_pop(item)) {
+                return true;
+            }
+            if (closed()) {
+                break;
+            }
+            cpu_relax();
+        }
+        while (!try_pop(item)) {
+            // close() is published after the producer's last push, so seeing
+            // it means one more try_pop finds every remaining item.
+            if (closed()) {
+                return try_pop(item);
+            }
+            std::unique_lock<std::mutex> lock(park_mutex_);
+            consumer_waiting_.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            not_empty_.wait(lock, [this] { return !empty() || closed(); });
+            consumer_waiting_.store(false, std::memory_order_relaxed);
+        }
+        return true;
+    }
+
+    // Try to pop an item from the queue without blocking (consumer thread only).
+    // Returns true if an item was popped, false otherwise.
+    bool try_pop(T& item) override {
+        size_t head = head_.load(std::memory_order_acquire);
+        if (policy_ != QueueFullPolicy::DropOldest) {
+            if (head == cached_tail_) {
+                cached_tail_ = tail_.load(std::memory_order_acquire);
+                if (head == cached_tail_) {
+                    return false;
+                }
+            }
+            item = std::move(slots_[head & mask_]);
+            head_.store(head + 1, std::memory_order_relaxed);
+            released_.store(head + 1, std::memory_order_release);
+        } else {
+            // In drop-oldest mode the producer may also advance head_ to discard
+            // an item, so the consumer claims its slot with a CAS first and only
+            // marks it released once the item has been moved out.
+            while (true) {
+                // head_ can move past our cached tail when the producer drops,
+                // hence >= rather than ==.
+                if (head >= cached_tail_) {
+                    cached_tail_ = tail_.load(std::memory_order_acquire);
+                    if (head == cached_tail_) {
+                        return false;
+                    }
+                }
+                if (head_.compare_exchange_weak(head, head + 1,
+                                                std::memory_order_acquire,
+                                                std::memory_order_acquire)) {
+                    break;
+                }
+            }
+            item = std::move(slots_[head & mask_]);
+            released_.fetch_add(1, std::memory_order_release);
+        }
+        wake(producer_waiting_, not_full_);
+        return true;
+    }
+
+    // Check if the queue is empty. Only a snapshot when called off the consumer thread.
+    bool empty() const override {
+        return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+    }
+
+    // Get the current number of queued items (approximate while both sides are running).
+    size_t size() const override {
+        const size_t released = released_.load(std::memory_order_acquire);
+        const size_t tail = tail_.load(std::memory_order_acquire);
+        return tail - released;
+    }
+
+    // Mark the end of the stream (producer side, after its last push).
+    void close() override {
+        closed_.store(true, std::memory_order_release);
+        wake(consumer_waiting_, not_empty_);
+    }
+
+    bool closed() const override { return closed_.load(std::memory_order_acquire); }
+
+    size_t capacity() const { return capacity_; }
+    QueueFullPolicy policy() const { return policy_; }
+
+    // Number of items discarded by the DropOldest policy so far.
+    uint64_t dropped_count() const { return dropped_.load(std::memory_order_relaxed); }
+
+    // Called on the producer thread with each item discarded by DropOldest,
+    // e.g. to hand a dropped batch back to its pool. Set before pushing.
+    void set_drop_handler(std::function<void(T&&)> handler) { drop_handler_ = std::move(handler); }
+
+private:
+    static constexpr size_t CACHE_LINE_SIZE = 64;
+
+    static size_t round_up_pow2(size_t value) {
+        size_t result = 1;
+        while (result < value) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    // Slow path of push(): the ring is full as seen from index `tail`.
+    // Returns once there is room for one more item.
+    void wait_for_space(size_t tail) {
+        if (policy_ == QueueFullPolicy::DropOldest) {
+            while (true) {
+                cached_released_ = released_.load(std::memory_order_acquire);
+                if (tail - cached_released_ < capacity_) {
+                    return;
+                }
+                size_t head = head_.load(std::memory_order_acquire);
+                if (head != cached_released_) {
+                    // The consumer is in the middle of moving the oldest item out.
+                    cpu_relax();
+                    continue;
+                }
+                if (head_.compare_exchange_strong(head, head + 1,
+                                                  std::memory_order_acq_rel,
+                                                  std::memory_order_acquire)) {
+                    // We own the oldest slot now; it is overwritten by the caller.
+                    if (drop_handler_) {
+                        drop_handler_(std::move(slots_[head & mask_]));
+                    }
+                    dropped_.fetch_add(1, std::memory_order_relaxed);
+                    released_.fetch_add(1, std::memory_order_release);
+                    return;
+                }
+            }
+        }
+
+        if (policy_ == QueueFullPolicy::SpinThenPark) {
+            for (size_t spins = 0; spins < spin_limit_; ++spins) {
+                cpu_relax();
+                cached_released_ = released_.load(std::memory_order_acquire);
+                if (tail - cached_released_ < capacity_) {
+                    return;
+                }
+            }
+        }
+
+        std::unique_lock<std::mutex> lock(park_mutex_);
+        producer_waiting_.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        not_full_.wait(lock, [this, tail] {
+            cached_released_ = released_.load(std::memory_order_acquire);
+            return tail - cached_released_ < capacity_;
+        });
+        producer_waiting_.store(false, std::memory_order_relaxed);
+    }
+
+    // Wake the other side if it has parked. The seq_cst fence pairs with the
+    // one taken by the parking thread after it publishes its waiting flag, so
+    // either we see the flag or the parked thread sees our index update.
+    void wake(std::atomic<bool>& waiting_flag, std::condition_variable& cond_var) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiting_flag.load(std::memory_order_relaxed)) {
+            std::lock_guard<std::mutex> lock(park_mutex_);
+            cond_var.notify_one();
+        }
+    }
+
+    const size_t capacity_;
+    const size_t mask_;
+    const QueueFullPolicy policy_;
+    const size_t spin_limit_;
+    std::unique_ptr<T[]> slots_;
+    std::function<void(T&&)> drop_handler_;
+
+    // Producer-owned cache line.
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> tail_{0}; // Next slot to write
+    size_t cached_released_ = 0;                            // Producer's view of released_
+
+    // Consumer-owned cache line.
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> head_{0}; // Next slot to read
+    std::atomic<size_t> released_{0};                       // Slots handed back to the producer
+    size_t cached_tail_ = 0;                                // Consumer's view of tail_
+
+    // Rarely touched state: parking and drop statistics.
+    alignas(CACHE_LINE_SIZE) std::atomic<bool> producer_waiting_{false};
+    std::atomic<bool> consumer_waiting_{false};
+    std::atomic<uint64_t> dropped_{0};
+    std::atomic<bool> closed_{false};
+    std::mutex park_mutex_;
+    std::condition_variable not_full_;
+    std::condition_variable not_empty_;
+};
+
+#endif // SPSC_RING_QUEUE_H
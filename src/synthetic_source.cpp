@@ -0,0 +1,127 @@
+#include "synthetic_source.h"
+#include <algorithm> // For std::min, std::max
+#include <cmath>
+#include <cstring>
+
+SyntheticSource::SyntheticSource(RandomPixelSource& random, int width, const SyntheticConfig& config)
+    : random_(random),
+      config_(config),
+      row_(static_cast<size_t>(width > 0 ? width : 1)),
+      row_used_(row_.size()), // Generate the first row on first use
+      noise_(row_.size()),
+      row_index_(static_cast<uint64_t>(-1)), // generate_row() advances to row 0
+      defects_per_row_(config.defects_per_mpixel * static_cast<double>(row_.size()) / 1e6),
+      defects_started_(0) {
+    config_.noise = std::max(0, std::min(config_.noise, 127));
+    config_.defect_radius = std::max(1, config_.defect_radius);
+    // Room for several times the defects expected to overlap one row (the
+    // tallest shape covers 8r rows), so draw_defects() does not grow the list
+    // mid-run.
+    double overlapping = defects_per_row_ * 8.0 * config_.defect_radius;
+    active_.reserve(static_cast<size_t>(4.0 * overlapping) + 16);
+}
+
+uint32_t SyntheticSource::random_u32() {
+    uint8_t bytes[4];
+    random_.fill(bytes, sizeof(bytes));
+    uint32_t value;
+    std::memcpy(&value, bytes, sizeof(value));
+    return value;
+}
+
+void SyntheticSource::start_defects() {
+    // New defects this row: the whole part of the expected count, plus one
+    // more with the probability of the fractional part.
+    int count = static_cast<int>(defects_per_row_);
+    double fraction = defects_per_row_ - count;
+    if (fraction > 0.0 && random_u32() < fraction * 4294967296.0) {
+        ++count;
+    }
+    const int radius = config_.defect_radius;
+    for (int i = 0; i < count; ++i) {
+        Defect defect;
+        defect.column = static_cast<int>(random_u32() % row_.size());
+        defect.top = row_index_;
+        switch (config_.shape) {
+        case DefectShape::Round:
+            defect.half_width = radius;
+            defect.height = 2 * radius + 1;
+            break;
+        case DefectShape::Streak:
+            defect.half_width = radius / 2;
+            defect.height = 8 * radius;
+            break;
+        case DefectShape::Scratch:
+            defect.half_width = 4 * radius;
+            defect.height = 1;
+            break;
+        }
+        active_.push_back(defect);
+        ++defects_started_;
+    }
+}
+
+void SyntheticSource::draw_defects() {
+    const int width = static_cast<int>(row_.size());
+    size_t kept = 0;
+    for (const Defect& defect : active_) {
+        int dy = static_cast<int>(row_index_ - defect.top);
+        int half_width = defect.half_width;
+        if (config_.shape == DefectShape::Round) {
+            // Disc: the chord at distance |dy - r| from the centre row.
+            int from_centre = dy - config_.defect_radius;
+            int radius = config_.defect_radius;
+            half_width = static_cast<int>(std::sqrt(static_cast<double>(radius * radius - from_centre * from_centre)));
+        }
+        int first = std::max(0, defect.column - half_width);
+        int last = std::min(width - 1, defect.column + half_width);
+        for (int x = first; x <= last; ++x) {
+            int value = row_[x] + config_.contrast;
+            row_[x] = static_cast<uint8_t>(std::max(0, std::min(255, value)));
+        }
+        if (dy + 1 < defect.height) {
+            active_[kept++] = defect; // Still being drawn on the next row
+        }
+    }
+    active_.resize(kept);
+}
+
+void SyntheticSource::generate_row() {
+    ++row_index_;
+    // Background plus uniform noise in [-noise, noise]: a random byte scaled
+    // to 2 * noise + 1 steps.
+    random_.fill(noise_.data(), noise_.size());
+    const int steps = 2 * config_.noise + 1;
+    const int base = config_.background - config_.noise;
+    for (size_t x = 0; x < row_.size(); ++x) {
+        int value = base + ((noise_[x] * steps) >> 8);
+        row_[x] = static_cast<uint8_t>(value < 0 ? 0 : (value > 255 ? 255 : value));
+    }
+    start_defects();
+    draw_defects();
+    row_used_ = 0;
+}
+
+void SyntheticSource::fill(uint8_t* out, size_t count) {
+    while (count > 0) {
+        if (row_used_ == row_.size()) {
+            generate_row();
+        }
+        size_t taken = std::min(count, row_.size() - row_used_);
+        std::memcpy(out, row_.data() + row_used_, taken);
+        row_used_ += taken;
+        out += taken;
+        count -= taken;
+    }
+}
+
+const char* SyntheticSource::shape_name(DefectShape shape) {
+    switch (shape) {
+    case DefectShape::Streak:
+        return "streak";
+    case DefectShape::Scratch:
+        return "scratch";
+    default:
+        return "round";
+    }
+}
@@ -0,0 +1,77 @@
+#ifndef SYNTHETIC_SOURCE_H
+#define SYNTHETIC_SOURCE_H
+
+#include "random_source.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Outline of the synthetic defects.
+enum class DefectShape {
+    Round,  // Disc of the given radius
+    Streak, // Along the web (down the rows): narrow and 8 radii long
+    Scratch // Across the web (along a row): one row high and 8 radii wide
+};
+
+struct SyntheticConfig {
+    int background = 40;           // Clean web level
+    int noise = 6;                 // Uniform noise amplitude, +/- around the background
+    double defects_per_mpixel = 2.0; // Mean number of defects started per million pixels
+    int defect_radius = 3;         // Blob size in pixels
+    DefectShape shape = DefectShape::Round;
+    int contrast = 120;            // Added to the background inside a defect (negative = dark defect)
+};
+
+// Row-structured synthetic web: a noisy background with rare defect blobs.
+//
+// Rows are width pixels wide. Every row, a random number of new defects
+// (mean defects_per_mpixel * width / 1e6) start at random columns; a defect
+// covers several rows, so the source keeps the defects that are still being
+// drawn. Like RandomPixelSource, the output is a byte stream that does not
+// depend on how fill()/next() cut it up.
+class SyntheticSource {
+public:
+    // random supplies the noise and the defect placement and must outlive the
+    // source; seed it for reproducible output.
+    SyntheticSource(RandomPixelSource& random, int width, const SyntheticConfig& config);
+
+    void fill(uint8_t* out, size_t count);
+
+    uint8_t next() {
+        if (row_used_ == row_.size()) {
+            generate_row();
+        }
+        return row_[row_used_++];
+    }
+
+    int width() const { return static_cast<int>(row_.size()); }
+    const SyntheticConfig& config() const { return config_; }
+    uint64_t defects_started() const { return defects_started_; }
+
+    static const char* shape_name(DefectShape shape);
+
+private:
+    struct Defect {
+        int column;     // Centre column
+        uint64_t top;   // First row
+        int half_width; // Horizontal extent at the widest row
+        int height;     // Rows covered
+    };
+
+    void generate_row();
+    uint32_t random_u32();
+    void start_defects();
+    void draw_defects();
+
+    RandomPixelSource& random_;
+    SyntheticConfig config_;
+    std::vector<uint8_t> row_;   // Current row
+    size_t row_used_;            // Pixels of row_ already handed out
+    std::vector<uint8_t> noise_; // Random bytes for one row of noise
+    std::vector<Defect> active_;
+    uint64_t row_index_;         // Index of the row in row_
+    double defects_per_row_;
+    uint64_t defects_started_;
+};
+
+#endif // SYNTHETIC_SOURCE_H
@@ -0,0 +1,141 @@
+#include "thread_affinity.h"
+#include <iostream> // For std::cerr
+#include <fstream>
+#include <sstream>
+#include <cstring>  // For std::strerror
+#include <pthread.h>
+#include <sched.h>
+
+#ifdef HAVE_LIBNUMA
+#include <numa.h>
+#endif
+
+namespace {
+
+bool apply_affinity(const std::vector<int>& cpus, const std::string& what) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+        if (cpu >= 0 && cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &set);
+        }
+    }
+    int rc = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (rc != 0) {
+        std::cerr << "Affinity Warning: Could not pin thread to " << what << ": " << std::strerror(rc) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+std::vector<int> parse_cpu_list(const std::string& list) {
+    std::vector<int> cpus;
+    std::stringstream ss(list);
+    std::string range;
+    while (std::getline(ss, range, ',')) {
+        if (range.empty() || range == "\n") {
+            continue;
+        }
+        size_t dash = range.find('-');
+        try {
+            int first = std::stoi(range.substr(0, dash));
+            int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+            for (int cpu = first; cpu <= last; ++cpu) {
+                cpus.push_back(cpu);
+            }
+        } catch (const std::exception&) {
+            // Not a cpulist entry; ignore it.
+        }
+    }
+    return cpus;
+}
+
+int available_cpu_count() {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) != 0) {
+        return 1;
+    }
+    int count = CPU_COUNT(&set);
+    return count > 0 ? count : 1;
+}
+
+int numa_node_count() {
+#ifdef HAVE_LIBNUMA
+    if (numa_available() >= 0) {
+        return numa_max_node() + 1;
+    }
+    return 1;
+#else
+    int nodes = 0;
+    while (std::ifstream("/sys/devices/system/node/node" + std::to_string(nodes) + "/cpulist")) {
+        ++nodes;
+    }
+    return nodes > 0 ? nodes : 1;
+#endif
+}
+
+std::vector<int> numa_node_cpus(int node) {
+    std::vector<int> cpus;
+#ifdef HAVE_LIBNUMA
+    if (numa_available() >= 0) {
+        struct bitmask* mask = numa_allocate_cpumask();
+        if (numa_node_to_cpus(node, mask) == 0) {
+            for (unsigned int cpu = 0; cpu < mask->size; ++cpu) {
+                if (numa_bitmask_isbitset(mask, cpu)) {
+                    cpus.push_back(static_cast<int>(cpu));
+                }
+            }
+        }
+        numa_free_cpumask(mask);
+    }
+#else
+    std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+    std::string list;
+    if (file && std::getline(file, list)) {
+        cpus = parse_cpu_list(list);
+    }
+#endif
+    if (cpus.empty() && node == 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+            for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+                if (CPU_ISSET(cpu, &set)) {
+                    cpus.push_back(cpu);
+                }
+            }
+        }
+    }
+    return cpus;
+}
+
+std::vector<int> isolated_cpus() {
+    std::ifstream file("/sys/devices/system/cpu/isolated");
+    std::string list;
+    if (file && std::getline(file, list)) {
+        return parse_cpu_list(list);
+    }
+    return std::vector<int>();
+}
+
+bool pin_current_thread_to_cpu(int cpu) {
+    return apply_affinity(std::vector<int>(1, cpu), "CPU " + std::to_string(cpu));
+}
+
+bool bind_current_thread_to_node(int node) {
+    std::vector<int> cpus = numa_node_cpus(node);
+    if (cpus.empty()) {
+        std::cerr << "Affinity Warning: NUMA node " << node << " has no CPUs." << std::endl;
+        return false;
+    }
+    bool ok = apply_affinity(cpus, "NUMA node " + std::to_string(node));
+#ifdef HAVE_LIBNUMA
+    if (numa_available() >= 0) {
+        numa_set_preferred(node);
+    }
+#endif
+    return ok;
+}
@@ -0,0 +1,39 @@
+#ifndef THREAD_AFFINITY_H
+#define THREAD_AFFINITY_H
+
+#include <vector>
+#include <string>
+
+// CPU and NUMA placement for pipeline threads (Linux).
+//
+// Node topology is taken from libnuma when the build enables it (NUMA=1 in the
+// Makefile, defines HAVE_LIBNUMA), otherwise from /sys/devices/system/node.
+// Memory locality relies on the kernel's first-touch policy: a thread bound to
+// a node before it initializes a buffer gets that buffer's pages on the node.
+
+// Number of CPUs this process may run on.
+int available_cpu_count();
+
+// Number of NUMA nodes (1 on non-NUMA machines).
+int numa_node_count();
+
+// CPUs belonging to a NUMA node; all available CPUs for node 0 when the
+// topology cannot be read.
+std::vector<int> numa_node_cpus(int node);
+
+// CPUs the kernel keeps the scheduler off (isolcpus= on the kernel command
+// line, from /sys/devices/system/cpu/isolated); empty when there are none.
+std::vector<int> isolated_cpus();
+
+// Restrict the calling thread to one CPU. Returns false (and prints a
+// warning) if the kernel refuses.
+bool pin_current_thread_to_cpu(int cpu);
+
+// Restrict the calling thread to the CPUs of a node and prefer that node for
+// its allocations.
+bool bind_current_thread_to_node(int node);
+
+// Parse a Linux cpulist such as "0-3,8,10-11".
+std::vector<int> parse_cpu_list(const std::string& list);
+
+#endif // THREAD_AFFINITY_H
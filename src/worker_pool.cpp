@@ -0,0 +1,90 @@
+#include "worker_pool.h"
+#include "alloc_check.h"
+
+WorkerPool::WorkerPool(size_t thread_count)
+    : next_queue_(0),
+      pending_(0),
+      stopping_(false),
+      steals_(0) {
+    if (thread_count == 0) {
+        thread_count = 1;
+    }
+    for (size_t i = 0; i < thread_count; ++i) {
+        queues_.push_back(std::make_unique<WorkerQueue>());
+    }
+    for (size_t i = 0; i < thread_count; ++i) {
+        workers_.emplace_back(&WorkerPool::worker_loop, this, i);
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        stopping_ = true;
+    }
+    work_available_.notify_all();
+    for (std::thread& worker : workers_) {
+        worker.join();
+    }
+}
+
+void WorkerPool::submit(std::function<void()> task) {
+    WorkerQueue& queue = *queues_[next_queue_];
+    next_queue_ = (next_queue_ + 1) % queues_.size();
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(std::move(task));
+    }
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        ++pending_;
+    }
+    work_available_.notify_one();
+}
+
+bool WorkerPool::take_task(size_t index, std::function<void()>& task) {
+    {
+        WorkerQueue& own = *queues_[index];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+    for (size_t offset = 1; offset < queues_.size(); ++offset) {
+        WorkerQueue& victim = *queues_[(index + offset) % queues_.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            steals_.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkerPool::worker_loop(size_t index) {
+    std::function<void()> task;
+    SteadyStateScope steady_state;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(sleep_mutex_);
+            work_available_.wait(lock, [this] { return pending_ > 0 || stopping_; });
+            if (pending_ == 0) {
+                return; // Stopping and nothing left to run
+            }
+            --pending_; // Reserve one task; it is in some deque
+        }
+        // Only workers holding a reservation take tasks, so the deques hold at
+        // least one task for us; the scan can still miss it while another
+        // worker is moving one out, hence the retry.
+        while (!take_task(index, task)) {
+            std::this_thread::yield();
+        }
+        task();
+        task = nullptr;
+        steady_state.tick();
+    }
+}
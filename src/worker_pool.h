@@ -0,0 +1,56 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef> // For size_t
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "ring_buffer.h"
+
+// Small work-stealing thread pool.
+//
+// Every worker owns a deque. submit() deals tasks round-robin onto the
+// deques; a worker takes from the back of its own deque and, when that is
+// empty, steals from the front of the others, so one slow task does not hold
+// up the tasks queued behind it. Idle workers sleep on a condition variable.
+// Tasks must not throw.
+class WorkerPool {
+public:
+    explicit WorkerPool(size_t thread_count);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    void submit(std::function<void()> task);
+
+    size_t thread_count() const { return workers_.size(); }
+
+    // Tasks that were taken from another worker's deque.
+    size_t steal_count() const { return steals_.load(std::memory_order_relaxed); }
+
+private:
+    struct WorkerQueue {
+        std::mutex mutex;
+        RingBuffer<std::function<void()>> tasks; // Used as a deque, without per-chunk allocation
+    };
+
+    void worker_loop(size_t index);
+    bool take_task(size_t index, std::function<void()>& task);
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues_;
+    std::vector<std::thread> workers_;
+    size_t next_queue_;            // Round-robin cursor, used by submit() only
+
+    std::mutex sleep_mutex_;
+    std::condition_variable work_available_;
+    size_t pending_;               // Submitted but not yet taken; guarded by sleep_mutex_
+    bool stopping_;
+    std::atomic<size_t> steals_;
+};
+
+#endif // WORKER_POOL_H
@@ -0,0 +1,74 @@
+// Convert a CSV pixel file to the binary scan format (src/scan_file.h), so it
+// can be replayed without reparsing the text every run.
+//
+// Usage: csv_to_scan <in.csv> <out.scan> <m> [--lz4] [--period-ns N]
+//
+// m is the row width written in the header (0 = unstructured stream); cells
+// past the first m of a row are dropped, exactly as the live CSV reader does.
+// --period-ns records a T (ns per row) to pace replays at; the default 0
+// leaves the T entered at replay time in charge.
+#include "csv_source.h"
+#include "scan_file.h"
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+void usage() {
+    std::cerr << "Usage: csv_to_scan <in.csv> <out.scan> <m> [--lz4] [--period-ns N]" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 4) {
+        usage();
+        return 2;
+    }
+    const std::string input_path = argv[1];
+    const std::string output_path = argv[2];
+    const int m = std::atoi(argv[3]);
+    bool compress = false;
+    long long period_ns = 0;
+    for (int i = 4; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--lz4") == 0) {
+            compress = true;
+        } else if (std::strcmp(argv[i], "--period-ns") == 0 && i + 1 < argc) {
+            period_ns = std::atoll(argv[++i]);
+        } else {
+            usage();
+            return 2;
+        }
+    }
+
+    CsvSource csv(m);
+    if (!csv.open(input_path)) {
+        std::cerr << "Error: Could not open CSV file: " << input_path << std::endl;
+        return 1;
+    }
+    ScanWriter writer;
+    // One item per row, so --period-ns is the line period.
+    if (!writer.open(output_path, m, period_ns, m > 0 ? static_cast<size_t>(m) : 1, compress)) {
+        return 1;
+    }
+    std::vector<uint8_t> buffer(64 * 1024);
+    size_t count;
+    while ((count = csv.read_pixels(buffer.data(), buffer.size())) > 0) {
+        writer.write(buffer.data(), count);
+    }
+    if (csv.error_count() > 0) {
+        std::cerr << "CSV Info: " << csv.error_count() << " malformed cell(s) skipped." << std::endl;
+    }
+    writer.close();
+    const ScanHeader& header = writer.header();
+    std::cout << "Wrote " << header.pixels << " pixels";
+    if (header.m > 0) {
+        std::cout << " (" << header.rows << " rows of " << header.m << ")";
+    }
+    std::cout << " to " << output_path << ", " << writer.bytes_written() << " bytes"
+              << (header.compressed() ? " (LZ4)" : "") << std::endl;
+    return 0;
+}